@@ -5,6 +5,7 @@
 
 #include "adddialog.h"
 #include "./ui_adddialog.h"
+#include "contactvalidator.h"
 #include <QMessageBox>
 #include <QRegularExpressionValidator>
 
@@ -46,41 +47,6 @@ void AddDialog::setupValidators() {
     ui->emailLineEdit->setPlaceholderText("e.g., example@email.com");
 }
 
-bool AddDialog::isValidPhone(const QString& phone) {
-    // Remove all non-digit characters for validation
-    QString digitsOnly = phone;
-    digitsOnly.remove(QRegularExpression("[^0-9]"));
-
-    // Indian phone number validation
-    // Must have 10 digits, or 12 digits with country code (91)
-    if (digitsOnly.length() == 10) {
-        // Valid 10-digit Indian number
-        return true;
-    } else if (digitsOnly.length() == 12 && digitsOnly.startsWith("91")) {
-        // Valid with country code
-        return true;
-    } else if (digitsOnly.length() >= 7 && digitsOnly.length() <= 15) {
-        // International numbers can be 7-15 digits
-        return true;
-    }
-
-    return false;
-}
-
-bool AddDialog::isValidEmail(const QString& email) {
-    if (email.trimmed().isEmpty()) {
-        return true; // Email is optional
-    }
-
-    // Comprehensive email validation regex
-    QRegularExpression emailRegex(
-        "^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\\.[a-zA-Z]{2,}$"
-        );
-
-    QRegularExpressionMatch match = emailRegex.match(email.trimmed());
-    return match.hasMatch();
-}
-
 void AddDialog::onPhoneTextChanged(const QString& text) {
     // Real-time visual feedback
     if (text.isEmpty()) {
@@ -88,7 +54,7 @@ void AddDialog::onPhoneTextChanged(const QString& text) {
         return;
     }
 
-    if (isValidPhone(text)) {
+    if (ContactValidator::isValidPhone(text)) {
         ui->phoneLineEdit->setStyleSheet(
             "QLineEdit { border: 2px solid #34C759; }"
             );
@@ -106,7 +72,7 @@ void AddDialog::onEmailTextChanged(const QString& text) {
         return;
     }
 
-    if (isValidEmail(text)) {
+    if (ContactValidator::isValidEmail(text)) {
         ui->emailLineEdit->setStyleSheet(
             "QLineEdit { border: 2px solid #34C759; }"
             );
@@ -128,8 +94,7 @@ bool AddDialog::validateInput() {
 
     // Check if name contains at least some letters
     QString name = ui->nameLineEdit->text().trimmed();
-    QRegularExpression nameRegex("[a-zA-Z]+");
-    if (!nameRegex.match(name).hasMatch()) {
+    if (!ContactValidator::isValidName(name)) {
         QMessageBox::warning(this, "Validation Error",
                              "Name must contain at least some letters!");
         ui->nameLineEdit->setFocus();
@@ -145,7 +110,7 @@ bool AddDialog::validateInput() {
         return false;
     }
 
-    if (!isValidPhone(phone)) {
+    if (!ContactValidator::isValidPhone(phone)) {
         QMessageBox::warning(this, "Invalid Phone Number",
                              "Please enter a valid phone number.\n\n"
                              "Accepted formats:\n"
@@ -159,7 +124,7 @@ bool AddDialog::validateInput() {
 
     // Validate Email (if provided)
     QString email = ui->emailLineEdit->text().trimmed();
-    if (!email.isEmpty() && !isValidEmail(email)) {
+    if (!email.isEmpty() && !ContactValidator::isValidEmail(email)) {
         QMessageBox::warning(this, "Invalid Email",
                              "Please enter a valid email address.\n\n"
                              "Example: example@domain.com");
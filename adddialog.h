@@ -36,8 +36,6 @@ private:
     bool editMode;
 
     bool validateInput();
-    bool isValidPhone(const QString& phone);
-    bool isValidEmail(const QString& email);
     void setupValidators();
 };
 
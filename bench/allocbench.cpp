@@ -0,0 +1,137 @@
+/**
+ * @file allocbench.cpp
+ * @brief Counts heap allocations of the insert and update paths
+ *
+ * Replaces the global operator new so every allocation in the process is
+ * counted, including the ones Qt makes for QString data. Each step reports
+ * allocations per contact, so a copy that sneaks back into the move paths
+ * shows up as a higher count.
+ *
+ * Usage: allocbench [contacts]
+ */
+
+#include "bench.h"
+#include "contactfields.h"
+#include "contactmanager.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<quint64> allocations{0};
+
+void* allocate(std::size_t size) {
+    ++allocations;
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+/**
+ * @brief Counts allocations made between construction and report()
+ */
+class AllocationScope {
+public:
+    AllocationScope() : start(allocations.load()) {}
+
+    void report(QTextStream& out, const QString& label, int count) const {
+        const quint64 made = allocations.load() - start;
+        Bench::report(out, label, QString("%1 allocations, %2 per contact")
+                                      .arg(made)
+                                      .arg(static_cast<double>(made) / count, 0, 'f', 2));
+    }
+
+private:
+    quint64 start;
+};
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+int main(int argc, char *argv[]) {
+    const int count = argc > 1 ? std::atoi(argv[1]) : 100000;
+    QTextStream out(stdout);
+    if (count <= 0) {
+        out << "Usage: allocbench [contacts]\n";
+        return 1;
+    }
+
+    const std::vector<Contact> source = Bench::makeContacts(count);
+    out << "== inserts (" << count << " contacts)\n";
+
+    {
+        ContactManager manager;
+        AllocationScope scope;
+        for (const Contact& contact : source) {
+            manager.addContact(contact);
+        }
+        scope.report(out, "addContact(const&)", count);
+    }
+    {
+        ContactManager manager;
+        std::vector<Contact> batch = source;
+        AllocationScope scope;
+        for (Contact& contact : batch) {
+            manager.addContact(std::move(contact));
+        }
+        scope.report(out, "addContact(&&)", count);
+    }
+    {
+        ContactManager manager;
+        AllocationScope scope;
+        for (const Contact& contact : source) {
+            manager.emplaceContact(contact.getName(), contact.getPhone(), contact.getEmail(),
+                                   contact.getAddress(), contact.getNotes());
+        }
+        scope.report(out, "emplaceContact", count);
+    }
+
+    out << "== updates (" << count << " contacts)\n";
+
+    ContactManager manager;
+    manager.addContacts(source);
+    const std::vector<Contact> stored = manager.getAllContactsSorted();
+    Timestamp::Batch clock;
+
+    {
+        AllocationScope scope;
+        for (const Contact& contact : stored) {
+            manager.updateContact(contact.getId(), contact);
+        }
+        scope.report(out, "updateContact(const&)", count);
+    }
+    {
+        std::vector<Contact> edits = stored;
+        AllocationScope scope;
+        for (Contact& contact : edits) {
+            const int id = contact.getId();
+            manager.updateContact(id, std::move(contact));
+        }
+        scope.report(out, "updateContact(&&)", count);
+    }
+    {
+        const QString notes = "Follow up next week";
+        AllocationScope scope;
+        for (const Contact& contact : stored) {
+            manager.updateField<ContactFields::Notes>(contact.getId(), notes);
+        }
+        scope.report(out, "updateField<Notes>", count);
+    }
+    {
+        const QString email = "shared@example.org";
+        AllocationScope scope;
+        for (const Contact& contact : stored) {
+            manager.updateField<ContactFields::Email>(contact.getId(), email);
+        }
+        scope.report(out, "updateField<Email>", count);
+    }
+    return 0;
+}
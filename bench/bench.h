@@ -0,0 +1,53 @@
+/**
+ * @file bench.h
+ * @brief Shared helpers of the contactbench benchmarks
+ *
+ * Each benchmark is one function run by benchmain.cpp. They print plain
+ * "label: value" lines so runs can be diffed, and take the dataset size
+ * from the command line.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "contact.h"
+#include <QElapsedTimer>
+#include <QString>
+#include <QTextStream>
+#include <vector>
+
+namespace Bench {
+
+/**
+ * @brief Generates realistic contacts with unique phone numbers
+ * The same count and seed always give the same contacts.
+ * Time Complexity: O(count)
+ */
+std::vector<Contact> makeContacts(int count, quint32 seed = 1);
+
+/**
+ * @brief Rate in items per second
+ */
+double perSecond(qint64 items, qint64 nanoseconds);
+
+/**
+ * @brief Prints one aligned "label: value" line
+ */
+void report(QTextStream& out, const QString& label, const QString& value);
+
+/**
+ * @brief Prints elapsed time and throughput of a timed step
+ */
+void reportTimed(QTextStream& out, const QString& label, qint64 items, qint64 nanoseconds);
+
+// Benchmarks; each returns 0 on success
+int storageFormats(QTextStream& out, int count);    ///< Size and save/load speed per StorageFormat
+int validators(QTextStream& out, int count);        ///< ContactValidator single and batch throughput
+int queryCache(QTextStream& out, int count);        ///< Repeated searches with and without the result cache
+int savePath(QTextStream& out, int count);          ///< Timestamp-heavy save and bulk field updates
+int diskStore(QTextStream& out, int count);         ///< DiskContactStore with a cache of a quarter of the file
+int shardedStore(QTextStream& out, int count);      ///< Cold and resident fan-out searches over hash shards
+
+} // namespace Bench
+
+#endif // BENCH_H
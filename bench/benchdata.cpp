@@ -0,0 +1,94 @@
+/**
+ * @file benchdata.cpp
+ * @brief Dataset generation and reporting for the benchmarks
+ */
+
+#include "bench.h"
+#include <QStringList>
+#include <random>
+
+namespace {
+
+const QStringList kFirstNames = {
+    "Aarav", "Vivaan", "Aditya", "Ananya", "Diya", "Ishaan", "Kavya", "Meera",
+    "Rohan", "Saanvi", "Arjun", "Priya", "Rahul", "Sneha", "Vikram", "Neha",
+    "John", "Maria", "David", "Sarah", "Michael", "Laura", "James", "Emma"
+};
+
+const QStringList kLastNames = {
+    "Sharma", "Verma", "Iyer", "Nair", "Patel", "Reddy", "Gupta", "Mehta",
+    "Kulkarni", "Desai", "Singh", "Das", "Smith", "Garcia", "Brown", "Miller"
+};
+
+const QStringList kStreets = {
+    "MG Road", "Park Street", "Linking Road", "Brigade Road", "Anna Salai",
+    "FC Road", "Main Street", "Station Road"
+};
+
+const QStringList kCities = {
+    "Pune, Maharashtra 411001, India", "Mumbai, Maharashtra 400001, India",
+    "Bengaluru, Karnataka 560001, India", "Chennai, Tamil Nadu 600002, India",
+    "Kolkata, West Bengal 700016, India", "Delhi 110001", "Hyderabad",
+    "Springfield, IL 62701, USA"
+};
+
+const QStringList kDomains = {
+    "gmail.com", "yahoo.co.in", "outlook.com", "example.org"
+};
+
+} // namespace
+
+namespace Bench {
+
+std::vector<Contact> makeContacts(int count, quint32 seed) {
+    std::mt19937 random(seed);
+    auto pick = [&random](const QStringList& list) -> const QString& {
+        return list[random() % list.size()];
+    };
+
+    std::vector<Contact> contacts;
+    contacts.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QString first = pick(kFirstNames);
+        const QString last = pick(kLastNames);
+
+        // The index keeps phone numbers unique; the layout varies like user input
+        const QString number = QString::number(9000000000LL + i);
+        QString phone;
+        switch (i % 3) {
+        case 0:
+            phone = "+91 " + number.left(5) + " " + number.mid(5);
+            break;
+        case 1:
+            phone = number.left(5) + "-" + number.mid(5);
+            break;
+        default:
+            phone = number;
+            break;
+        }
+
+        contacts.emplace_back(first + " " + last, phone,
+                              first.toLower() + "." + last.toLower() + QString::number(i) + "@" +
+                                  pick(kDomains),
+                              QString::number(1 + random() % 200) + " " + pick(kStreets) + ", " +
+                                  pick(kCities),
+                              i % 4 == 0 ? QString("Met at conference %1").arg(i % 50) : QString());
+    }
+    return contacts;
+}
+
+double perSecond(qint64 items, qint64 nanoseconds) {
+    return nanoseconds > 0 ? items * 1e9 / nanoseconds : 0.0;
+}
+
+void report(QTextStream& out, const QString& label, const QString& value) {
+    out << (label + ":").leftJustified(28) << value << "\n";
+}
+
+void reportTimed(QTextStream& out, const QString& label, qint64 items, qint64 nanoseconds) {
+    report(out, label, QString("%1 ms, %2/s")
+                           .arg(nanoseconds / 1e6, 0, 'f', 1)
+                           .arg(qRound64(perSecond(items, nanoseconds))));
+}
+
+} // namespace Bench
@@ -0,0 +1,62 @@
+/**
+ * @file benchmain.cpp
+ * @brief Runs the contactbench benchmarks named on the command line
+ *
+ * Usage: contactbench [--contacts N] [storage] [validator] [cache] [save] [disk] [shards]
+ * With no names every benchmark runs.
+ */
+
+#include "bench.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <functional>
+#include <map>
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("contactbench");
+
+    const std::map<QString, std::function<int(QTextStream&, int)>> benchmarks = {
+        {"storage", Bench::storageFormats},
+        {"validator", Bench::validators},
+        {"cache", Bench::queryCache},
+        {"save", Bench::savePath},
+        {"disk", Bench::diskStore},
+        {"shards", Bench::shardedStore},
+    };
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Contact Management System benchmarks");
+    parser.addHelpOption();
+    QCommandLineOption contactsOption("contacts", "Contacts in the generated dataset.", "count", "200000");
+    parser.addOption(contactsOption);
+    parser.addPositionalArgument("benchmark", "storage, validator, cache, save, disk or shards; all if omitted.");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    const int count = parser.value(contactsOption).toInt();
+    if (count <= 0) {
+        out << "--contacts must be positive\n";
+        return 1;
+    }
+
+    QStringList names = parser.positionalArguments();
+    if (names.isEmpty()) {
+        for (const auto& entry : benchmarks) {
+            names.append(entry.first);
+        }
+    }
+
+    int status = 0;
+    for (const QString& name : names) {
+        auto it = benchmarks.find(name);
+        if (it == benchmarks.end()) {
+            out << "Unknown benchmark " << name << "\n";
+            return 1;
+        }
+        out << "== " << name << " (" << count << " contacts)\n";
+        status |= it->second(out, count);
+        out.flush();
+    }
+    return status;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file cachebench.cpp
+ * @brief Repeated searches with the query result cache off and on
+ *
+ * Mimics a user toggling the sort combo over a handful of searches: the
+ * same (query, sort) pairs come back again and again.
+ */
+
+#include "bench.h"
+#include "contactmanager.h"
+#include "contactquery.h"
+#include <iterator>
+
+namespace Bench {
+
+int queryCache(QTextStream& out, int count) {
+    ContactManager manager;
+    manager.addContacts(makeContacts(count));
+
+    const QStringList texts = {
+        "sharma", "name:pri*", "city:pune", "domain:gmail.com", "email:@outlook.com -city:mumbai"
+    };
+    const ContactManager::SortOrder orders[] = {
+        ContactManager::SortByNameAsc, ContactManager::SortByNameDesc,
+        ContactManager::SortByIDAsc, ContactManager::SortByModifiedDesc
+    };
+    const int rounds = 20;
+
+    std::vector<ContactQuery> queries;
+    for (const QString& text : texts) {
+        queries.push_back(ContactQuery::parse(text));
+    }
+
+    for (size_t budget : {size_t(0), size_t(64) * 1024 * 1024}) {
+        manager.setCacheBudget(budget);
+        const ContactManager::CacheStats before = manager.getCacheStats();
+
+        size_t results = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int round = 0; round < rounds; ++round) {
+            for (const ContactQuery& query : queries) {
+                for (ContactManager::SortOrder order : orders) {
+                    results += manager.search(query, order).size();
+                }
+            }
+        }
+        const qint64 elapsedNs = timer.nsecsElapsed();
+        const qint64 searches = rounds * queries.size() * std::size(orders);
+
+        const ContactManager::CacheStats stats = manager.getCacheStats();
+        out << (budget == 0 ? "cache off" : "cache on") << "\n";
+        reportTimed(out, "  searches", searches, elapsedNs);
+        report(out, "  results", QString::number(results));
+        report(out, "  hits / misses", QString("%1 / %2")
+                                           .arg(stats.hits - before.hits)
+                                           .arg(stats.misses - before.misses));
+        report(out, "  cached bytes", QString::number(stats.bytes));
+    }
+    return 0;
+}
+
+} // namespace Bench
@@ -0,0 +1,124 @@
+/**
+ * @file diskbench.cpp
+ * @brief DiskContactStore with a page cache a quarter of the file size
+ *
+ * The store is imported from a CompressedBlocks snapshot, then its cache
+ * budget is cut to a quarter of the store file, so most of the data is
+ * never resident at once. Random lookups, prefix scans and deep paging
+ * then show what the page cache costs when the working set does not fit.
+ */
+
+#include "bench.h"
+#include "contactmanager.h"
+#include "diskcontactstore.h"
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <random>
+
+namespace Bench {
+
+namespace {
+
+// The file is this many times larger than the cache budget
+const qint64 kFileToBudget = 4;
+
+const int kLookups = 20000;
+const int kPages = 200;
+const int kPageSize = 50;
+
+/**
+ * @brief Prints the cache hits and misses since a snapshot of the stats
+ */
+void reportCache(QTextStream& out, const PageCache::Stats& before, const PageCache::Stats& after) {
+    const quint64 hits = after.hits - before.hits;
+    const quint64 misses = after.misses - before.misses;
+    const double rate = hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0;
+    report(out, "  hit rate", QString("%1% (%2 hits, %3 misses)")
+                                  .arg(rate, 0, 'f', 1).arg(hits).arg(misses));
+    report(out, "  resident pages", QString("%1 of %2").arg(after.residentPages).arg(after.budgetPages));
+}
+
+} // namespace
+
+int diskStore(QTextStream& out, int count) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create a temporary directory\n";
+        return 1;
+    }
+
+    const QString snapshot = dir.filePath("contacts.cmz");
+    const QString storePath = dir.filePath(QString("contacts") + DiskContactStore::kFileSuffix);
+    {
+        ContactManager manager;
+        manager.addContacts(makeContacts(count));
+        if (!manager.saveToFile(snapshot, ContactManager::CompressedBlocks)) {
+            out << "Cannot save the snapshot\n";
+            return 1;
+        }
+    }
+
+    DiskContactStore store;
+    QElapsedTimer timer;
+    timer.start();
+    if (!store.open(storePath) || !store.importFile(snapshot).complete || !store.flush()) {
+        out << "Cannot import into " << storePath << "\n";
+        return 1;
+    }
+    reportTimed(out, "import", count, timer.nsecsElapsed());
+
+    const qint64 fileBytes = QFileInfo(storePath).size();
+    const size_t budget = static_cast<size_t>(fileBytes / kFileToBudget);
+    store.setCacheBudget(budget);
+    report(out, "store file", QString("%1 KiB").arg(fileBytes / 1024));
+    report(out, "cache budget", QString("%1 KiB").arg(budget / 1024));
+
+    const int maxId = store.getMaxId();
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> anyId(1, maxId);
+
+    PageCache::Stats before = store.getCacheStats();
+    int found = 0;
+    timer.restart();
+    for (int i = 0; i < kLookups; ++i) {
+        found += store.getContactById(anyId(random)).has_value();
+    }
+    out << "random lookups\n";
+    reportTimed(out, "  getContactById", kLookups, timer.nsecsElapsed());
+    report(out, "  found", QString::number(found));
+    reportCache(out, before, store.getCacheStats());
+
+    const QStringList prefixes = {"a", "an", "pri", "ra", "sh", "vik", "z"};
+    before = store.getCacheStats();
+    size_t matches = 0;
+    timer.restart();
+    for (const QString& prefix : prefixes) {
+        matches += store.searchByNamePrefix(prefix, kPageSize).size();
+    }
+    out << "prefix scans (first " << kPageSize << ")\n";
+    reportTimed(out, "  searchByNamePrefix", prefixes.size(), timer.nsecsElapsed());
+    report(out, "  results", QString::number(matches));
+    reportCache(out, before, store.getCacheStats());
+
+    std::uniform_int_distribution<int> anyRow(0, std::max(0, store.getContactCount() - kPageSize));
+    before = store.getCacheStats();
+    size_t rows = 0;
+    timer.restart();
+    for (int i = 0; i < kPages; ++i) {
+        rows += store.getContactsSorted(anyRow(random), kPageSize).size();
+    }
+    out << "random pages (" << kPageSize << " rows)\n";
+    reportTimed(out, "  getContactsSorted", kPages, timer.nsecsElapsed());
+    report(out, "  rows", QString::number(rows));
+    reportCache(out, before, store.getCacheStats());
+
+    timer.restart();
+    if (!store.compact()) {
+        out << "Cannot compact\n";
+        return 1;
+    }
+    reportTimed(out, "compact", count, timer.nsecsElapsed());
+    return 0;
+}
+
+} // namespace Bench
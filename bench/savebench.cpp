@@ -0,0 +1,75 @@
+/**
+ * @file savebench.cpp
+ * @brief Timestamp formatting, the save path and bulk field updates
+ */
+
+#include "bench.h"
+#include "contactfields.h"
+#include "contactmanager.h"
+#include "timestamp.h"
+#include <QDateTime>
+#include <QTemporaryDir>
+
+namespace Bench {
+
+int savePath(QTextStream& out, int count) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create a temporary directory\n";
+        return 1;
+    }
+
+    ContactManager manager;
+    manager.addContacts(makeContacts(count));
+    const std::vector<Contact> contacts = manager.getAllContactsSorted();
+    QElapsedTimer timer;
+
+    // Two timestamps per contact, as saveToFile() writes them
+    qsizetype length = 0;
+    timer.start();
+    for (const Contact& contact : contacts) {
+        length += contact.getCreatedDate().toUTC().toString(Qt::ISODateWithMs).size();
+        length += contact.getModifiedDate().toUTC().toString(Qt::ISODateWithMs).size();
+    }
+    reportTimed(out, "QDateTime ISO", 2 * count, timer.nsecsElapsed());
+
+    timer.restart();
+    for (const Contact& contact : contacts) {
+        length += Timestamp::toIso(contact.getCreated()).size();
+        length += Timestamp::toIso(contact.getModified()).size();
+    }
+    reportTimed(out, "Timestamp::toIso", 2 * count, timer.nsecsElapsed());
+
+    timer.restart();
+    if (!manager.saveToFile(dir.filePath("contacts.json"), ContactManager::CompactJson)) {
+        out << "Cannot save\n";
+        return 1;
+    }
+    reportTimed(out, "save compact JSON", count, timer.nsecsElapsed());
+
+    // One clock read for the whole batch instead of one per setter
+    timer.restart();
+    {
+        Timestamp::Batch clock;
+        for (const Contact& contact : contacts) {
+            manager.updateField<ContactFields::Notes>(contact.getId(), "Bulk note");
+        }
+    }
+    reportTimed(out, "bulk updateField", count, timer.nsecsElapsed());
+
+    timer.restart();
+    {
+        Timestamp::Batch clock;
+        for (const Contact& contact : contacts) {
+            Contact updated = contact;
+            updated.setEmail("bulk." + contact.getEmail());
+            manager.updateContact(contact.getId(), std::move(updated));
+        }
+    }
+    reportTimed(out, "bulk updateContact", count, timer.nsecsElapsed());
+
+    report(out, "formatted characters", QString::number(length));
+    return 0;
+}
+
+} // namespace Bench
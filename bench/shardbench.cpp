@@ -0,0 +1,86 @@
+/**
+ * @file shardbench.cpp
+ * @brief Fan-out searches over a phone-hashed ShardedContactStore
+ *
+ * The dataset is spread over hash shards and saved, then every shard is
+ * unloaded. Searches across all shards, across a few named shards and
+ * across shards already in memory show the cost of loading on demand, and
+ * the resident shard count shows that a cold fan-out does not keep them.
+ */
+
+#include "bench.h"
+#include "contactquery.h"
+#include "shardedcontactstore.h"
+#include <QTemporaryDir>
+
+namespace Bench {
+
+namespace {
+
+const int kShards = 32;
+const int kSubsetShards = 4;
+const int kRounds = 5;
+
+/**
+ * @brief Times kRounds fan-outs of each query and prints hits and residency
+ */
+void timeSearches(QTextStream& out, ShardedContactStore& store, const QString& label,
+                  const std::vector<ContactQuery>& queries, const QStringList& subset) {
+    size_t hits = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < kRounds; ++round) {
+        for (const ContactQuery& query : queries) {
+            hits += subset.isEmpty() ? store.searchAll(query).size()
+                                     : store.searchAll(query, subset).size();
+        }
+    }
+    out << label << "\n";
+    reportTimed(out, "  searchAll", kRounds * queries.size(), timer.nsecsElapsed());
+    report(out, "  hits", QString::number(hits));
+    report(out, "  resident shards", QString("%1 of %2").arg(store.loadedShardCount()).arg(kShards));
+}
+
+} // namespace
+
+int shardedStore(QTextStream& out, int count) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create a temporary directory\n";
+        return 1;
+    }
+
+    ShardedContactStore store(dir.path(), kShards);
+    QElapsedTimer timer;
+    timer.start();
+    for (const Contact& contact : makeContacts(count)) {
+        store.addContact(ShardedContactStore::hashShardKey(contact.getPhone(), kShards), contact);
+    }
+    if (!store.saveAll()) {
+        out << "Cannot save the shards\n";
+        return 1;
+    }
+    reportTimed(out, "add and save", count, timer.nsecsElapsed());
+
+    const QStringList tenants = store.tenants();
+    for (const QString& tenant : tenants) {
+        store.unload(tenant);
+    }
+
+    std::vector<ContactQuery> queries;
+    for (const QString& text : {QString("name:pri*"), QString("city:pune"), QString("domain:gmail.com")}) {
+        queries.push_back(ContactQuery::parse(text));
+    }
+
+    timeSearches(out, store, "all shards, cold", queries, {});
+    timeSearches(out, store, QString("%1 shards, cold").arg(kSubsetShards), queries,
+                 tenants.mid(0, kSubsetShards));
+
+    for (const QString& tenant : tenants) {
+        store.getContactCount(tenant);
+    }
+    timeSearches(out, store, "all shards, resident", queries, {});
+    return 0;
+}
+
+} // namespace Bench
@@ -0,0 +1,61 @@
+/**
+ * @file storagebench.cpp
+ * @brief File size and save/load throughput of each storage format
+ */
+
+#include "bench.h"
+#include "contactmanager.h"
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+namespace Bench {
+
+int storageFormats(QTextStream& out, int count) {
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Cannot create a temporary directory\n";
+        return 1;
+    }
+
+    ContactManager manager;
+    manager.addContacts(makeContacts(count));
+
+    const struct {
+        ContactManager::StorageFormat format;
+        const char* name;
+    } formats[] = {
+        {ContactManager::IndentedJson, "indented-json"},
+        {ContactManager::CompactJson, "compact-json"},
+        {ContactManager::CompressedBlocks, "compressed-blocks"},
+    };
+
+    for (const auto& entry : formats) {
+        const QString path = dir.filePath(QString(entry.name) + ".dat");
+        QElapsedTimer timer;
+
+        timer.start();
+        if (!manager.saveToFile(path, entry.format)) {
+            out << "Cannot save " << entry.name << "\n";
+            return 1;
+        }
+        const qint64 saveNs = timer.nsecsElapsed();
+
+        ContactManager loaded;
+        timer.restart();
+        if (!loaded.loadFromFile(path) || loaded.getContactCount() != count) {
+            out << "Cannot load " << entry.name << "\n";
+            return 1;
+        }
+        const qint64 loadNs = timer.nsecsElapsed();
+
+        const qint64 bytes = QFileInfo(path).size();
+        out << entry.name << "\n";
+        report(out, "  size", QString("%1 bytes, %2 per contact")
+                                  .arg(bytes).arg(bytes / qMax(count, 1)));
+        reportTimed(out, "  save", count, saveNs);
+        reportTimed(out, "  load", count, loadNs);
+    }
+    return 0;
+}
+
+} // namespace Bench
@@ -0,0 +1,45 @@
+/**
+ * @file validatorbench.cpp
+ * @brief Throughput of the single-record and batch validators
+ */
+
+#include "bench.h"
+#include "contactvalidator.h"
+
+namespace Bench {
+
+int validators(QTextStream& out, int count) {
+    const std::vector<Contact> contacts = makeContacts(count);
+    QElapsedTimer timer;
+
+    // Sum the results so the calls cannot be optimized away
+    size_t valid = 0;
+    timer.start();
+    for (const Contact& contact : contacts) {
+        valid += ContactValidator::isValidPhone(contact.getPhone());
+    }
+    reportTimed(out, "isValidPhone", count, timer.nsecsElapsed());
+
+    timer.restart();
+    for (const Contact& contact : contacts) {
+        valid += ContactValidator::isValidEmail(contact.getEmail());
+    }
+    reportTimed(out, "isValidEmail", count, timer.nsecsElapsed());
+
+    timer.restart();
+    for (const Contact& contact : contacts) {
+        valid += ContactValidator::validate(contact.getName(), contact.getPhone(),
+                                            contact.getEmail()) == ContactValidator::Valid;
+    }
+    reportTimed(out, "validate", count, timer.nsecsElapsed());
+
+    std::vector<ContactValidator::Result> results;
+    timer.restart();
+    valid += ContactValidator::validateBatch(contacts, results);
+    reportTimed(out, "validateBatch", count, timer.nsecsElapsed());
+
+    report(out, "valid results", QString::number(valid));
+    return valid == 4 * contacts.size() ? 0 : 1;
+}
+
+} // namespace Bench
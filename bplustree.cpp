@@ -0,0 +1,290 @@
+/**
+ * @file bplustree.cpp
+ * @brief Implementation of the disk-resident B+tree
+ */
+
+#include "bplustree.h"
+#include <QDebug>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Leaf flag, entry count, next leaf or first child
+const int kNodeHeaderSize = 1 + 2 + 4;
+
+bool keyLess(const QByteArray& a, const QByteArray& b) {
+    const int common = static_cast<int>(std::min(a.size(), b.size()));
+    const int cmp = memcmp(a.constData(), b.constData(), common);
+    return cmp < 0 || (cmp == 0 && a.size() < b.size());
+}
+
+} // namespace
+
+BPlusTree::BPlusTree(PageCache& cache, quint32 root)
+    : cache(cache)
+    , rootPage(root) {
+}
+
+int BPlusTree::encodedSize(const Node& node, size_t first, size_t last) {
+    int size = kNodeHeaderSize;
+    for (size_t i = first; i < last; ++i) {
+        size += 2 + node.keys[i].size() + (node.leaf ? 2 + node.values[i].size() : 4);
+    }
+    return size;
+}
+
+bool BPlusTree::readNode(quint32 page, Node& node) const {
+    const PageCache::Page data = cache.read(page);
+    if (!data) {
+        return false;
+    }
+
+    const char *p = data->constData();
+    const char *end = p + PageCache::kPageSize;
+    node.leaf = p[0] != 0;
+    const quint16 count = qFromBigEndian<quint16>(p + 1);
+    node.link = qFromBigEndian<quint32>(p + 3);
+    p += kNodeHeaderSize;
+
+    node.keys.resize(count);
+    node.values.resize(node.leaf ? count : 0);
+    node.children.resize(node.leaf ? 0 : count);
+
+    for (quint16 i = 0; i < count; ++i) {
+        if (end - p < 2) {
+            return false;
+        }
+        const quint16 keySize = qFromBigEndian<quint16>(p);
+        p += 2;
+        if (end - p < keySize + (node.leaf ? 2 : 4)) {
+            return false;
+        }
+        node.keys[i] = QByteArray(p, keySize);
+        p += keySize;
+
+        if (node.leaf) {
+            const quint16 valueSize = qFromBigEndian<quint16>(p);
+            p += 2;
+            if (end - p < valueSize) {
+                return false;
+            }
+            node.values[i] = QByteArray(p, valueSize);
+            p += valueSize;
+        } else {
+            node.children[i] = qFromBigEndian<quint32>(p);
+            p += 4;
+        }
+    }
+    return true;
+}
+
+bool BPlusTree::writeNode(quint32 page, const Node& node) {
+    const PageCache::Page data = cache.modify(page);
+    if (!data) {
+        return false;
+    }
+
+    char *p = data->data();
+    p[0] = node.leaf ? 1 : 0;
+    qToBigEndian(static_cast<quint16>(node.keys.size()), p + 1);
+    qToBigEndian(node.link, p + 3);
+    p += kNodeHeaderSize;
+
+    for (size_t i = 0; i < node.keys.size(); ++i) {
+        qToBigEndian(static_cast<quint16>(node.keys[i].size()), p);
+        memcpy(p + 2, node.keys[i].constData(), node.keys[i].size());
+        p += 2 + node.keys[i].size();
+
+        if (node.leaf) {
+            qToBigEndian(static_cast<quint16>(node.values[i].size()), p);
+            memcpy(p + 2, node.values[i].constData(), node.values[i].size());
+            p += 2 + node.values[i].size();
+        } else {
+            qToBigEndian(node.children[i], p);
+            p += 4;
+        }
+    }
+    return true;
+}
+
+quint32 BPlusTree::childFor(const Node& node, const QByteArray& key) {
+    auto it = std::upper_bound(node.keys.begin(), node.keys.end(), key, keyLess);
+    const size_t index = it - node.keys.begin();
+    return index == 0 ? node.link : node.children[index - 1];
+}
+
+bool BPlusTree::find(const QByteArray& key, QByteArray& value) const {
+    Node node;
+    for (quint32 page = rootPage; page != 0; page = childFor(node, key)) {
+        if (!readNode(page, node)) {
+            return false;
+        }
+        if (node.leaf) {
+            auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key, keyLess);
+            if (it == node.keys.end() || *it != key) {
+                return false;
+            }
+            value = node.values[it - node.keys.begin()];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BPlusTree::splitNode(quint32 page, Node& node, Split& split) {
+    // Split by bytes, not entries, so both halves fit a page even when key
+    // sizes vary
+    const int half = encodedSize(node, 0, node.keys.size()) / 2;
+    size_t middle = 1;
+    while (middle < node.keys.size() - 1 && encodedSize(node, 0, middle) < half) {
+        ++middle;
+    }
+
+    Node right;
+    right.leaf = node.leaf;
+    if (node.leaf) {
+        right.keys.assign(node.keys.begin() + middle, node.keys.end());
+        right.values.assign(node.values.begin() + middle, node.values.end());
+        right.link = node.link;
+        split.key = right.keys.front();
+        node.keys.resize(middle);
+        node.values.resize(middle);
+    } else {
+        // The middle key moves up; its child becomes the right node's first
+        split.key = node.keys[middle];
+        right.link = node.children[middle];
+        right.keys.assign(node.keys.begin() + middle + 1, node.keys.end());
+        right.children.assign(node.children.begin() + middle + 1, node.children.end());
+        node.keys.resize(middle);
+        node.children.resize(middle);
+    }
+
+    split.page = cache.allocate();
+    split.happened = true;
+    if (node.leaf) {
+        node.link = split.page;
+    }
+    return writeNode(split.page, right) && writeNode(page, node);
+}
+
+bool BPlusTree::insertInto(quint32 page, const QByteArray& key, const QByteArray& value,
+                           Split& split) {
+    Node node;
+    if (!readNode(page, node)) {
+        return false;
+    }
+
+    auto it = std::upper_bound(node.keys.begin(), node.keys.end(), key, keyLess);
+    const size_t index = it - node.keys.begin();
+
+    if (node.leaf) {
+        if (index > 0 && node.keys[index - 1] == key) {
+            node.values[index - 1] = value;
+        } else {
+            node.keys.insert(node.keys.begin() + index, key);
+            node.values.insert(node.values.begin() + index, value);
+        }
+    } else {
+        Split childSplit;
+        const quint32 child = index == 0 ? node.link : node.children[index - 1];
+        if (!insertInto(child, key, value, childSplit)) {
+            return false;
+        }
+        if (!childSplit.happened) {
+            return true;
+        }
+        node.keys.insert(node.keys.begin() + index, childSplit.key);
+        node.children.insert(node.children.begin() + index, childSplit.page);
+    }
+
+    if (encodedSize(node, 0, node.keys.size()) > PageCache::kPageSize) {
+        return splitNode(page, node, split);
+    }
+    return writeNode(page, node);
+}
+
+bool BPlusTree::insert(const QByteArray& key, const QByteArray& value) {
+    if (key.size() > kMaxKeySize || value.size() > kMaxValueSize) {
+        return false;
+    }
+
+    if (rootPage == 0) {
+        rootPage = cache.allocate();
+        if (!writeNode(rootPage, Node())) {
+            return false;
+        }
+    }
+
+    Split split;
+    if (!insertInto(rootPage, key, value, split)) {
+        return false;
+    }
+
+    if (split.happened) {
+        Node root;
+        root.leaf = false;
+        root.link = rootPage;
+        root.keys.push_back(split.key);
+        root.children.push_back(split.page);
+        rootPage = cache.allocate();
+        return writeNode(rootPage, root);
+    }
+    return true;
+}
+
+bool BPlusTree::remove(const QByteArray& key) {
+    Node node;
+    quint32 page = rootPage;
+    while (page != 0) {
+        if (!readNode(page, node)) {
+            return false;
+        }
+        if (node.leaf) {
+            break;
+        }
+        page = childFor(node, key);
+    }
+    if (page == 0) {
+        return false;
+    }
+
+    auto it = std::lower_bound(node.keys.begin(), node.keys.end(), key, keyLess);
+    if (it == node.keys.end() || *it != key) {
+        return false;
+    }
+    const size_t index = it - node.keys.begin();
+    node.keys.erase(node.keys.begin() + index);
+    node.values.erase(node.values.begin() + index);
+    return writeNode(page, node);
+}
+
+void BPlusTree::scan(const QByteArray& from, const Visitor& visit) const {
+    Node node;
+    quint32 page = rootPage;
+    while (page != 0) {
+        if (!readNode(page, node)) {
+            return;
+        }
+        if (node.leaf) {
+            break;
+        }
+        page = childFor(node, from);
+    }
+
+    size_t index = std::lower_bound(node.keys.begin(), node.keys.end(), from, keyLess) -
+                   node.keys.begin();
+    while (page != 0) {
+        for (; index < node.keys.size(); ++index) {
+            if (!visit(node.keys[index], node.values[index])) {
+                return;
+            }
+        }
+        page = node.link;
+        index = 0;
+        if (page != 0 && !readNode(page, node)) {
+            return;
+        }
+    }
+}
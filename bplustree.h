@@ -0,0 +1,109 @@
+/**
+ * @file bplustree.h
+ * @brief Disk-resident B+tree over the pages of a PageCache
+ *
+ * Keys and values are byte strings compared with memcmp, so composite keys
+ * are built by concatenating big-endian fields. Each node is one page:
+ *   leaf:     1 | entry count | next leaf | (key length | key | value length | value)*
+ *   internal: 0 | entry count | child 0   | (key length | key | child)*
+ * Child i + 1 of an internal node holds the keys >= key i. Nodes split when
+ * their encoding outgrows the page; removal leaves underfull nodes in place,
+ * which costs space but never correctness.
+ *
+ * Page 0 is reserved by the owner of the file, so 0 means "no page".
+ */
+
+#ifndef BPLUSTREE_H
+#define BPLUSTREE_H
+
+#include "pagecache.h"
+#include <QByteArray>
+#include <functional>
+#include <vector>
+
+class BPlusTree {
+public:
+    static const int kMaxKeySize = 256;
+    static const int kMaxValueSize = 64;
+
+    /**
+     * @brief Receives one entry of a scan; return false to stop
+     */
+    using Visitor = std::function<bool(const QByteArray& key, const QByteArray& value)>;
+
+    /**
+     * @param cache Pages of the file the tree lives in
+     * @param root Root page of an existing tree, or 0 for an empty tree
+     */
+    BPlusTree(PageCache& cache, quint32 root = 0);
+
+    /**
+     * @brief Root page to persist; changes when the root splits
+     */
+    quint32 root() const { return rootPage; }
+
+    /**
+     * @brief Looks up a key
+     * Time Complexity: O(log n) page reads
+     */
+    bool find(const QByteArray& key, QByteArray& value) const;
+
+    /**
+     * @brief Inserts a key or replaces its value
+     * @return false if the key or value is too long or a page failed
+     * Time Complexity: O(log n) page reads and writes
+     */
+    bool insert(const QByteArray& key, const QByteArray& value);
+
+    /**
+     * @brief Removes a key
+     * @return false if the key was not present
+     * Time Complexity: O(log n)
+     */
+    bool remove(const QByteArray& key);
+
+    /**
+     * @brief Visits entries with keys >= from in key order
+     * Time Complexity: O(log n + k) for k visited entries
+     */
+    void scan(const QByteArray& from, const Visitor& visit) const;
+
+private:
+    struct Node {
+        bool leaf = true;
+        quint32 link = 0;                   ///< Next leaf, or child 0 of an internal node
+        std::vector<QByteArray> keys;
+        std::vector<QByteArray> values;     ///< Leaves only
+        std::vector<quint32> children;      ///< Internal nodes only, child i + 1 per key i
+    };
+
+    /**
+     * @brief Separator and new right sibling produced by a split
+     */
+    struct Split {
+        bool happened = false;
+        QByteArray key;
+        quint32 page = 0;
+    };
+
+    PageCache& cache;
+    quint32 rootPage;
+
+    bool readNode(quint32 page, Node& node) const;
+    bool writeNode(quint32 page, const Node& node);
+    static int encodedSize(const Node& node, size_t first, size_t last);
+
+    /**
+     * @brief Child of an internal node that may hold key
+     */
+    static quint32 childFor(const Node& node, const QByteArray& key);
+
+    bool insertInto(quint32 page, const QByteArray& key, const QByteArray& value, Split& split);
+
+    /**
+     * @brief Moves the upper half of an oversized node to a new page
+     */
+    bool splitNode(quint32 page, Node& node, Split& split);
+};
+
+#endif // BPLUSTREE_H
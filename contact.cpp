@@ -6,25 +6,36 @@
 #include "contact.h"
 
 // Initialize static member
-int Contact::nextId = 1;
+std::atomic<int> Contact::nextId{1};
 
 Contact::Contact()
     : id(nextId++),
-    createdDate(QDateTime::currentDateTime()),
-    modifiedDate(QDateTime::currentDateTime()) {
+    created(Timestamp::now()),
+    modified(created) {
 }
 
-Contact::Contact(const QString& name, const QString& phone,
-                 const QString& email, const QString& address,
-                 const QString& notes)
+Contact::Contact(QString name, QString phone, QString email, QString address,
+                 QString notes)
     : id(nextId++),
-    name(name),
-    phone(phone),
-    email(email),
-    address(address),
-    notes(notes),
-    createdDate(QDateTime::currentDateTime()),
-    modifiedDate(QDateTime::currentDateTime()) {
+    name(std::move(name)),
+    phone(std::move(phone)),
+    email(std::move(email)),
+    address(std::move(address)),
+    notes(std::move(notes)),
+    created(Timestamp::now()),
+    modified(created) {
+}
+
+Contact::Contact(int id, QString name, QString phone, QString email, QString address,
+                 QString notes, qint64 created, qint64 modified)
+    : id(id),
+    name(std::move(name)),
+    phone(std::move(phone)),
+    email(std::move(email)),
+    address(std::move(address)),
+    notes(std::move(notes)),
+    created(created),
+    modified(modified) {
 }
 
 QString Contact::toString() const {
@@ -11,8 +11,11 @@
 #ifndef CONTACT_H
 #define CONTACT_H
 
+#include "timestamp.h"
 #include <QString>
 #include <QDateTime>
+#include <atomic>
+#include <utility>
 
 class Contact {
 public:
@@ -28,28 +31,74 @@ public:
      * @param email Contact's email address
      * @param address Contact's physical address
      * @param notes Additional notes about the contact
+     *
+     * Arguments are taken by value and moved into place, so temporaries
+     * (e.g. text read from a form) are stored without another copy.
      */
-    Contact(const QString& name, const QString& phone,
-            const QString& email, const QString& address,
-            const QString& notes = "");
+    Contact(QString name, QString phone, QString email, QString address,
+            QString notes = QString());
 
-    // Getters
+    /**
+     * @brief Restores a stored contact with its ID and timestamps
+     * Unlike the other constructors this does not draw an ID from the
+     * shared counter; call reserveId() if the ID must never be handed out
+     * again.
+     */
+    Contact(int id, QString name, QString phone, QString email, QString address,
+            QString notes, qint64 created, qint64 modified);
+
+    // Getters return references to the stored fields; copy the result if
+    // the contact may change or go away while it is in use
     int getId() const { return id; }
-    QString getName() const { return name; }
-    QString getPhone() const { return phone; }
-    QString getEmail() const { return email; }
-    QString getAddress() const { return address; }
-    QString getNotes() const { return notes; }
-    QDateTime getCreatedDate() const { return createdDate; }
-    QDateTime getModifiedDate() const { return modifiedDate; }
-
-    // Setters
+    const QString& getName() const { return name; }
+    const QString& getPhone() const { return phone; }
+    const QString& getEmail() const { return email; }
+    const QString& getAddress() const { return address; }
+    const QString& getNotes() const { return notes; }
+
+    /**
+     * @brief Timestamps in UTC milliseconds since the epoch
+     */
+    qint64 getCreated() const { return created; }
+    qint64 getModified() const { return modified; }
+
+    /**
+     * @brief Timestamps as local QDateTime, for display
+     */
+    QDateTime getCreatedDate() const { return Timestamp::toDateTime(created); }
+    QDateTime getModifiedDate() const { return Timestamp::toDateTime(modified); }
+
+    // Setters take the new value by value and move it into place
     void setId(int newId) { id = newId; }
-    void setName(const QString& newName) { name = newName; updateModifiedDate(); }
-    void setPhone(const QString& newPhone) { phone = newPhone; updateModifiedDate(); }
-    void setEmail(const QString& newEmail) { email = newEmail; updateModifiedDate(); }
-    void setAddress(const QString& newAddress) { address = newAddress; updateModifiedDate(); }
-    void setNotes(const QString& newNotes) { notes = newNotes; updateModifiedDate(); }
+    void setName(QString newName) { name = std::move(newName); updateModifiedDate(); }
+    void setPhone(QString newPhone) { phone = std::move(newPhone); updateModifiedDate(); }
+    void setEmail(QString newEmail) { email = std::move(newEmail); updateModifiedDate(); }
+    void setAddress(QString newAddress) { address = std::move(newAddress); updateModifiedDate(); }
+    void setNotes(QString newNotes) { notes = std::move(newNotes); updateModifiedDate(); }
+
+    /**
+     * @brief Restores timestamps, e.g. when loading from a file
+     * Unlike the other setters these do not touch the modified date.
+     */
+    void setCreated(qint64 msecs) { created = msecs; }
+    void setModified(qint64 msecs) { modified = msecs; }
+
+    /**
+     * @brief Makes sure future contacts never reuse an ID that was restored
+     * from a file or a sync delta
+     * @param usedId An ID that is already taken
+     */
+    static void reserveId(int usedId) {
+        int current = nextId.load();
+        while (usedId >= current && !nextId.compare_exchange_weak(current, usedId + 1)) {
+        }
+    }
+
+    /**
+     * @brief Hands out an ID no contact has used, e.g. to re-ID a contact
+     * whose ID turned out to be taken
+     */
+    static int allocateId() { return nextId++; }
 
     /**
      * @brief Comparison operator for sorting contacts by name
@@ -71,15 +120,16 @@ private:
     QString email;               ///< Email address
     QString address;             ///< Physical address
     QString notes;               ///< Additional notes
-    QDateTime createdDate;       ///< Date and time when contact was created
-    QDateTime modifiedDate;      ///< Date and time when contact was last modified
+    qint64 created;              ///< When the contact was created, UTC epoch msecs
+    qint64 modified;             ///< When the contact was last modified, UTC epoch msecs
 
-    static int nextId;           ///< Static counter for generating unique IDs
+    static std::atomic<int> nextId; ///< Shared ID counter, atomic so shards can load in parallel
 
     /**
-     * @brief Updates the modified date to current date/time
+     * @brief Stamps the modified time; inside a Timestamp::Batch this is
+     * the batch's pinned time, not another clock read
      */
-    void updateModifiedDate() { modifiedDate = QDateTime::currentDateTime(); }
+    void updateModifiedDate() { modified = Timestamp::now(); }
 };
 
 #endif // CONTACT_H
@@ -0,0 +1,315 @@
+/**
+ * @file contactclient.cpp
+ * @brief Implementation of the blocking protocol client and load generator
+ */
+
+#include "contactclient.h"
+#include <QDataStream>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+bool ContactClient::connectTo(const QString& name, int timeoutMs) {
+    socket.connectToServer(name);
+    if (!socket.waitForConnected(timeoutMs)) {
+        lastError = socket.errorString();
+        return false;
+    }
+    input.clear();
+    return true;
+}
+
+void ContactClient::disconnect() {
+    socket.disconnectFromServer();
+}
+
+quint32 ContactClient::send(ContactProtocol::Opcode opcode, const QByteArray& arguments) {
+    const quint32 requestId = nextRequestId++;
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << requestId << static_cast<quint8>(opcode);
+    payload.append(arguments);
+
+    if (socket.write(ContactProtocol::frame(payload)) < 0) {
+        lastError = socket.errorString();
+        return 0;
+    }
+    return requestId;
+}
+
+bool ContactClient::receive(Response& response, int timeoutMs) {
+    QByteArray payload;
+    bool error = false;
+    while (!ContactProtocol::takeFrame(input, payload, error)) {
+        if (error) {
+            lastError = "Oversized response frame";
+            return false;
+        }
+        // Flush queued requests first, the server may be waiting for them
+        socket.flush();
+        if (!socket.waitForReadyRead(timeoutMs)) {
+            lastError = socket.errorString();
+            return false;
+        }
+        input.append(socket.readAll());
+    }
+
+    QDataStream in(payload);
+    quint8 status = 0;
+    in >> response.requestId >> status;
+    if (in.status() != QDataStream::Ok) {
+        lastError = "Truncated response header";
+        return false;
+    }
+
+    response.status = static_cast<ContactProtocol::Status>(status);
+    response.payload = payload.mid(sizeof(quint32) + sizeof(quint8));
+    response.error.clear();
+    if (!response.ok()) {
+        in >> response.error;
+        lastError = response.error;
+    }
+    return true;
+}
+
+bool ContactClient::call(ContactProtocol::Opcode opcode, const QByteArray& arguments,
+                         Response& response) {
+    if (!send(opcode, arguments)) {
+        return false;
+    }
+    return receive(response) && response.ok();
+}
+
+bool ContactClient::ping() {
+    Response response;
+    return call(ContactProtocol::Ping, QByteArray(), response);
+}
+
+int ContactClient::count() {
+    Response response;
+    if (!call(ContactProtocol::Count, QByteArray(), response)) {
+        return -1;
+    }
+    quint32 total = 0;
+    QDataStream(response.payload) >> total;
+    return static_cast<int>(total);
+}
+
+int ContactClient::maxId() {
+    Response response;
+    if (!call(ContactProtocol::MaxId, QByteArray(), response)) {
+        return -1;
+    }
+    qint32 id = 0;
+    QDataStream(response.payload) >> id;
+    return id;
+}
+
+bool ContactClient::getContact(int id, Contact& contact, int& storedId) {
+    QByteArray arguments;
+    QDataStream(&arguments, QIODevice::WriteOnly) << static_cast<qint32>(id);
+
+    Response response;
+    if (!call(ContactProtocol::GetContact, arguments, response)) {
+        return false;
+    }
+    QDataStream in(response.payload);
+    return ContactProtocol::readContact(in, contact, storedId);
+}
+
+std::vector<Contact> ContactClient::search(const QString& query, quint32 limit) {
+    QByteArray arguments;
+    QDataStream(&arguments, QIODevice::WriteOnly) << query << limit;
+
+    std::vector<Contact> results;
+    Response response;
+    if (!call(ContactProtocol::Search, arguments, response)) {
+        return results;
+    }
+
+    QDataStream in(response.payload);
+    quint32 total = 0, count = 0;
+    in >> total >> count;
+    results.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        Contact contact;
+        int storedId;
+        if (!ContactProtocol::readContact(in, contact, storedId)) {
+            break;
+        }
+        contact.setId(storedId);
+        results.push_back(contact);
+    }
+    return results;
+}
+
+int ContactClient::addContact(const Contact& contact) {
+    QByteArray arguments;
+    QDataStream out(&arguments, QIODevice::WriteOnly);
+    ContactProtocol::writeContact(out, contact);
+
+    Response response;
+    if (!call(ContactProtocol::AddContact, arguments, response)) {
+        return -1;
+    }
+    qint32 id = -1;
+    QDataStream(response.payload) >> id;
+    return id;
+}
+
+bool ContactClient::updateContact(int id, const Contact& contact) {
+    QByteArray arguments;
+    QDataStream out(&arguments, QIODevice::WriteOnly);
+    out << static_cast<qint32>(id);
+    ContactProtocol::writeContact(out, contact);
+
+    Response response;
+    return call(ContactProtocol::UpdateContact, arguments, response);
+}
+
+bool ContactClient::removeContact(int id) {
+    QByteArray arguments;
+    QDataStream(&arguments, QIODevice::WriteOnly) << static_cast<qint32>(id);
+
+    Response response;
+    return call(ContactProtocol::RemoveContact, arguments, response);
+}
+
+std::vector<std::pair<QString, int>> ContactClient::facetCounts(Facets::Kind facet,
+                                                               const QString& query,
+                                                               quint32 limit) {
+    QByteArray arguments;
+    QDataStream(&arguments, QIODevice::WriteOnly) << static_cast<quint8>(facet) << query << limit;
+
+    std::vector<std::pair<QString, int>> groups;
+    Response response;
+    if (!call(ContactProtocol::FacetCounts, arguments, response)) {
+        return groups;
+    }
+
+    QDataStream in(response.payload);
+    quint32 count = 0;
+    in >> count;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString key;
+        quint32 size;
+        in >> key >> size;
+        groups.emplace_back(key, static_cast<int>(size));
+    }
+    return groups;
+}
+
+ContactClient::LoadReport ContactClient::runLoad(const QString& name, int connections,
+                                                 int requestsPerConnection, int pipelineDepth) {
+    using Clock = std::chrono::steady_clock;
+
+    connections = std::max(1, connections);
+    pipelineDepth = std::max(1, pipelineDepth);
+
+    // Random IDs are drawn from the range the server actually holds
+    int maxId = 1;
+    {
+        ContactClient probe;
+        if (probe.connectTo(name)) {
+            maxId = std::max(maxId, probe.maxId());
+        }
+    }
+
+    std::mutex reportMutex;
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(connections) * std::max(0, requestsPerConnection));
+    quint64 errors = 0;
+
+    auto worker = [&](int seed) {
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<int> ids(1, maxId);
+        const char* const prefixes[] = {"a", "e", "j", "m", "r", "s"};
+
+        std::vector<double> local;
+        local.reserve(std::max(0, requestsPerConnection));
+        quint64 localErrors = 0;
+
+        ContactClient client;
+        if (!client.connectTo(name)) {
+            std::lock_guard<std::mutex> lock(reportMutex);
+            errors += std::max(0, requestsPerConnection);
+            return;
+        }
+
+        std::deque<std::pair<quint32, Clock::time_point>> inFlight;
+        int sent = 0;
+        while (sent < requestsPerConnection || !inFlight.empty()) {
+            while (sent < requestsPerConnection && static_cast<int>(inFlight.size()) < pipelineDepth) {
+                QByteArray arguments;
+                QDataStream out(&arguments, QIODevice::WriteOnly);
+                ContactProtocol::Opcode opcode;
+                if (sent % 5 == 4) {
+                    opcode = ContactProtocol::Search;
+                    out << QString("name:%1*").arg(prefixes[sent % 6]) << quint32(20);
+                } else {
+                    opcode = ContactProtocol::GetContact;
+                    out << static_cast<qint32>(ids(random));
+                }
+
+                const quint32 requestId = client.send(opcode, arguments);
+                ++sent;
+                if (!requestId) {
+                    ++localErrors;
+                    continue;
+                }
+                inFlight.emplace_back(requestId, Clock::now());
+            }
+
+            Response response;
+            if (!client.receive(response)) {
+                // The connection is gone; everything outstanding failed
+                localErrors += inFlight.size() + (requestsPerConnection - sent);
+                break;
+            }
+
+            // Responses arrive in request order
+            const auto started = inFlight.front().second;
+            inFlight.pop_front();
+            local.push_back(std::chrono::duration<double, std::milli>(Clock::now() - started).count());
+            if (!response.ok() && response.status != ContactProtocol::NotFound) {
+                ++localErrors;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(reportMutex);
+        latencies.insert(latencies.end(), local.begin(), local.end());
+        errors += localErrors;
+    };
+
+    const Clock::time_point start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < connections; ++i) {
+        threads.emplace_back(worker, i + 1);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    LoadReport report;
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    report.requests = latencies.size();
+    report.errors = errors;
+    report.requestsPerSecond = report.seconds > 0 ? report.requests / report.seconds : 0;
+
+    if (!latencies.empty()) {
+        auto percentile = [&latencies](double p) {
+            const size_t rank = std::min(latencies.size() - 1,
+                                         static_cast<size_t>(p * latencies.size()));
+            std::nth_element(latencies.begin(), latencies.begin() + rank, latencies.end());
+            return latencies[rank];
+        };
+        report.p50Ms = percentile(0.50);
+        report.p99Ms = percentile(0.99);
+        report.maxMs = *std::max_element(latencies.begin(), latencies.end());
+    }
+    return report;
+}
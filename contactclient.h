@@ -0,0 +1,111 @@
+/**
+ * @file contactclient.h
+ * @brief Blocking client for ContactServer and a pipelined load generator
+ *
+ * ContactClient speaks the protocol in contactprotocol.h over one
+ * QLocalSocket. The calls block, so a client is meant for command line
+ * tools and worker threads, not the GUI thread. send()/receive() expose
+ * pipelining: several requests may be sent before reading the first
+ * response.
+ */
+
+#ifndef CONTACTCLIENT_H
+#define CONTACTCLIENT_H
+
+#include "contact.h"
+#include "contactprotocol.h"
+#include "facets.h"
+#include <QByteArray>
+#include <QLocalSocket>
+#include <QString>
+#include <utility>
+#include <vector>
+
+class ContactClient {
+public:
+    /**
+     * @brief A decoded response; the opcode's result is left in payload
+     */
+    struct Response {
+        quint32 requestId = 0;
+        ContactProtocol::Status status = ContactProtocol::Ok;
+        QByteArray payload;     ///< Result bytes after the header
+        QString error;          ///< Message of a failed request
+
+        bool ok() const { return status == ContactProtocol::Ok; }
+    };
+
+    /**
+     * @brief Throughput and latency measured by runLoad()
+     */
+    struct LoadReport {
+        quint64 requests = 0;
+        quint64 errors = 0;         ///< Connection failures and responses other than Ok/NotFound
+        double seconds = 0;
+        double requestsPerSecond = 0;
+        double p50Ms = 0;
+        double p99Ms = 0;
+        double maxMs = 0;
+    };
+
+    /**
+     * @brief Connects to a server
+     * @param timeoutMs How long to wait for the connection
+     * @return false if no server answers on name
+     */
+    bool connectTo(const QString& name, int timeoutMs = 3000);
+
+    void disconnect();
+
+    /**
+     * @brief Sends a request without waiting for its response
+     * @param arguments Opcode arguments encoded with QDataStream
+     * @return The request id its response will carry, 0 on failure
+     */
+    quint32 send(ContactProtocol::Opcode opcode, const QByteArray& arguments = QByteArray());
+
+    /**
+     * @brief Waits for the next response
+     * @return false on timeout, disconnect or a malformed frame
+     */
+    bool receive(Response& response, int timeoutMs = 30000);
+
+    // Convenience calls: one request, wait for its response
+    bool ping();
+    int count();
+    int maxId();
+    bool getContact(int id, Contact& contact, int& storedId);
+    std::vector<Contact> search(const QString& query, quint32 limit = 0);
+    int addContact(const Contact& contact);
+    bool updateContact(int id, const Contact& contact);
+    bool removeContact(int id);
+    std::vector<std::pair<QString, int>> facetCounts(Facets::Kind facet, const QString& query = QString(),
+                                                     quint32 limit = 0);
+
+    QString errorString() const { return lastError; }
+
+    /**
+     * @brief Drives a server with a read-heavy request mix
+     * Each connection runs on its own thread and keeps pipelineDepth
+     * requests in flight. Most requests fetch a random contact, every fifth
+     * is a name search.
+     * @param connections Concurrent clients
+     * @param requestsPerConnection Requests each client sends
+     * @param pipelineDepth Outstanding requests per client
+     */
+    static LoadReport runLoad(const QString& name, int connections,
+                              int requestsPerConnection, int pipelineDepth);
+
+private:
+    QLocalSocket socket;
+    QByteArray input;
+    quint32 nextRequestId = 1;
+    QString lastError;
+
+    /**
+     * @brief Sends one request and waits for its response
+     */
+    bool call(ContactProtocol::Opcode opcode, const QByteArray& arguments, Response& response);
+};
+
+#endif // CONTACTCLIENT_H
@@ -0,0 +1,264 @@
+/**
+ * @file contactfields.h
+ * @brief Compile-time descriptors of the Contact fields
+ *
+ * Each field of Contact is described once: its JSON key, column label,
+ * getter and setter. Serialization, sort comparators, table columns and
+ * index keys are instantiated per field from these descriptors, so there
+ * is no string-keyed dispatch or virtual call left on the hot paths and a
+ * new field only needs a new descriptor plus an entry in the lists below.
+ *
+ * Usage:
+ *     ContactFields::All::forEach([&](auto field) {
+ *         decltype(field)::write(contact, obj);
+ *     });
+ */
+
+#ifndef CONTACTFIELDS_H
+#define CONTACTFIELDS_H
+
+#include "contact.h"
+#include "timestamp.h"
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLatin1String>
+#include <QString>
+
+namespace ContactFields {
+
+/**
+ * @brief Conversions shared by every field of one value type
+ */
+template <typename T>
+struct ValueTraits;
+
+template <>
+struct ValueTraits<int> {
+    static QJsonValue toJson(int value) { return value; }
+    static int fromJson(const QJsonValue& value) { return value.toInt(); }
+    static QString display(int value) { return QString::number(value); }
+    static int compare(int a, int b) { return (a > b) - (a < b); }
+    static int indexKey(int value) { return value; }
+};
+
+template <>
+struct ValueTraits<QString> {
+    static QJsonValue toJson(const QString& value) { return value; }
+    static QString fromJson(const QJsonValue& value) { return value.toString(); }
+    static QString display(const QString& value) { return value; }
+    static int compare(const QString& a, const QString& b) {
+        return QString::compare(a, b, Qt::CaseInsensitive);
+    }
+    static QString indexKey(const QString& value) { return value.toLower(); }
+};
+
+/**
+ * @brief Epoch millisecond timestamps
+ * Stored as UTC ISO 8601 text; numbers are accepted when reading too.
+ * Missing or unparsable values read as Timestamp::kInvalid.
+ */
+struct TimestampTraits {
+    static QJsonValue toJson(qint64 value) { return Timestamp::toIso(value); }
+    static qint64 fromJson(const QJsonValue& value) {
+        if (value.isDouble()) {
+            return value.toInteger();
+        }
+        return value.isString() ? Timestamp::fromIso(value.toString()) : Timestamp::kInvalid;
+    }
+    static QString display(qint64 value) {
+        return Timestamp::toDateTime(value).toString("yyyy-MM-dd hh:mm");
+    }
+    static int compare(qint64 a, qint64 b) { return (a > b) - (a < b); }
+    static qint64 indexKey(qint64 value) { return value; }
+};
+
+/**
+ * @brief Operations every descriptor gets from its key, get() and set()
+ */
+template <typename Descriptor, typename T, typename Traits = ValueTraits<T>>
+struct Field {
+    using Type = T;
+
+    static void write(const Contact& contact, QJsonObject& obj) {
+        obj.insert(QLatin1String(Descriptor::key), Traits::toJson(Descriptor::get(contact)));
+    }
+
+    static T fromJson(const QJsonValue& value) {
+        return Traits::fromJson(value);
+    }
+
+    static void read(const QJsonObject& obj, Contact& contact) {
+        auto it = obj.constFind(QLatin1String(Descriptor::key));
+        if (it != obj.constEnd()) {
+            Descriptor::set(contact, Traits::fromJson(*it));
+        }
+    }
+
+    static QString display(const Contact& contact) {
+        return Traits::display(Descriptor::get(contact));
+    }
+
+    static int compare(const Contact& a, const Contact& b) {
+        return Traits::compare(Descriptor::get(a), Descriptor::get(b));
+    }
+
+    /**
+     * @brief Normalized key used by the secondary indexes and queries
+     */
+    static auto indexKey(const Contact& contact) {
+        return Traits::indexKey(Descriptor::get(contact));
+    }
+};
+
+struct Id : Field<Id, int> {
+    static constexpr const char* key = "id";
+    static constexpr const char* label = "ID";
+    static int get(const Contact& c) { return c.getId(); }
+    static void set(Contact& c, int value) { c.setId(value); }
+};
+
+struct Name : Field<Name, QString> {
+    static constexpr const char* key = "name";
+    static constexpr const char* label = "Name";
+    static const QString& get(const Contact& c) { return c.getName(); }
+    static void set(Contact& c, QString value) { c.setName(std::move(value)); }
+};
+
+struct Phone : Field<Phone, QString> {
+    static constexpr const char* key = "phone";
+    static constexpr const char* label = "Phone";
+    static const QString& get(const Contact& c) { return c.getPhone(); }
+    static void set(Contact& c, QString value) { c.setPhone(std::move(value)); }
+
+    // Phone numbers are matched exactly, as entered
+    static const QString& indexKey(const Contact& c) { return c.getPhone(); }
+};
+
+struct Email : Field<Email, QString> {
+    static constexpr const char* key = "email";
+    static constexpr const char* label = "Email";
+    static const QString& get(const Contact& c) { return c.getEmail(); }
+    static void set(Contact& c, QString value) { c.setEmail(std::move(value)); }
+};
+
+struct Address : Field<Address, QString> {
+    static constexpr const char* key = "address";
+    static constexpr const char* label = "Address";
+    static const QString& get(const Contact& c) { return c.getAddress(); }
+    static void set(Contact& c, QString value) { c.setAddress(std::move(value)); }
+};
+
+struct Notes : Field<Notes, QString> {
+    static constexpr const char* key = "notes";
+    static constexpr const char* label = "Notes";
+    static const QString& get(const Contact& c) { return c.getNotes(); }
+    static void set(Contact& c, QString value) { c.setNotes(std::move(value)); }
+};
+
+// Timestamps keep the value already set when the stored one is invalid
+
+struct Created : Field<Created, qint64, TimestampTraits> {
+    static constexpr const char* key = "created";
+    static constexpr const char* label = "Created";
+    static qint64 get(const Contact& c) { return c.getCreated(); }
+    static void set(Contact& c, qint64 value) {
+        if (value != Timestamp::kInvalid) {
+            c.setCreated(value);
+        }
+    }
+};
+
+struct Modified : Field<Modified, qint64, TimestampTraits> {
+    static constexpr const char* key = "modified";
+    static constexpr const char* label = "Modified";
+    static qint64 get(const Contact& c) { return c.getModified(); }
+    static void set(Contact& c, qint64 value) {
+        if (value != Timestamp::kInvalid) {
+            c.setModified(value);
+        }
+    }
+};
+
+/**
+ * @brief An ordered list of descriptors, expanded at compile time
+ */
+template <typename... Fields>
+struct FieldList {
+    static constexpr int size = sizeof...(Fields);
+
+    /**
+     * @brief Calls fn(Descriptor()) for every field in order
+     */
+    template <typename Fn>
+    static void forEach(Fn&& fn) {
+        (fn(Fields()), ...);
+    }
+};
+
+/// Every stored field, in file order
+using All = FieldList<Id, Name, Phone, Email, Address, Notes, Created, Modified>;
+
+/// Columns of the contact table
+using Columns = FieldList<Id, Name, Phone, Email, Address>;
+
+/**
+ * @brief Strict weak ordering of contacts by one field
+ */
+template <typename Descriptor, bool Descending = false>
+struct Less {
+    bool operator()(const Contact& a, const Contact& b) const {
+        return Descending ? Descriptor::compare(b, a) < 0 : Descriptor::compare(a, b) < 0;
+    }
+};
+
+template <typename Descriptor>
+using Greater = Less<Descriptor, true>;
+
+/**
+ * @brief Serializes every field of a contact
+ */
+inline QJsonObject toJson(const Contact& contact) {
+    QJsonObject obj;
+    All::forEach([&](auto field) { decltype(field)::write(contact, obj); });
+    return obj;
+}
+
+/**
+ * @brief Reads one field's value from a JSON object (default if absent)
+ */
+template <typename Descriptor>
+typename Descriptor::Type value(const QJsonObject& obj) {
+    return Descriptor::fromJson(obj.value(QLatin1String(Descriptor::key)));
+}
+
+/**
+ * @brief Builds a contact from its serialized fields
+ * The text fields go through the constructor rather than the setters so
+ * the modified date is not re-stamped per field. The contact gets a fresh
+ * ID; callers that restore stored IDs read Id separately.
+ */
+inline Contact fromJson(const QJsonObject& obj) {
+    Contact contact(value<Name>(obj), value<Phone>(obj), value<Email>(obj),
+                    value<Address>(obj), value<Notes>(obj));
+    Created::read(obj, contact);
+    Modified::read(obj, contact);
+    return contact;
+}
+
+/**
+ * @brief Builds a contact that keeps a stored ID
+ * No ID is drawn from the shared counter; missing timestamps read as the
+ * current time, as they do for fromJson(obj).
+ */
+inline Contact fromJson(const QJsonObject& obj, int id) {
+    const qint64 now = Timestamp::now();
+    Contact contact(id, value<Name>(obj), value<Phone>(obj), value<Email>(obj),
+                    value<Address>(obj), value<Notes>(obj), now, now);
+    Created::read(obj, contact);
+    Modified::read(obj, contact);
+    return contact;
+}
+
+} // namespace ContactFields
+
+#endif // CONTACTFIELDS_H
@@ -0,0 +1,371 @@
+/**
+ * @file contactimporter.cpp
+ * @brief Implementation of the pipelined contact importer
+ */
+
+#include "contactimporter.h"
+#include "contactfields.h"
+#include "contactvalidator.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace {
+
+// Contacts handed to ContactManager::addContacts() at a time
+const size_t kInsertBatchSize = 4096;
+
+/**
+ * @brief Blocking FIFO with a fixed capacity
+ * push() waits while the queue is full, pop() waits while it is empty and
+ * returns false once the queue is closed and drained.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+};
+
+/**
+ * @brief Raw bytes of consecutive records, as produced by the reader
+ */
+struct RawChunk {
+    int sequence = 0;
+    int firstRow = 0;
+    int rowCount = 0;
+    bool compressed = false;    ///< zlib block from a CompressedBlocks file
+    QByteArray data;            ///< JSON array text (after decompression)
+};
+
+/**
+ * @brief A normalized, validated record
+ * Contacts are only constructed by the inserter because the Contact
+ * constructor hands out IDs from a shared counter.
+ */
+struct ImportRow {
+    int row = 0;
+    QString name;
+    QString phone;
+    QString email;
+    QString address;
+    QString notes;
+    qint64 created = Timestamp::kInvalid;
+    qint64 modified = Timestamp::kInvalid;
+};
+
+struct ParsedChunk {
+    int sequence = 0;
+    std::vector<ImportRow> rows;
+    std::vector<ImportReport::RejectedRow> rejected;
+};
+
+/**
+ * @return Reason a normalized row is invalid, or an empty string
+ */
+QString checkRow(const ImportRow& row) {
+    const ContactValidator::Result result =
+        ContactValidator::validate(row.name, row.phone, row.email);
+
+    switch (result) {
+    case ContactValidator::Valid:
+        return QString();
+    case ContactValidator::InvalidPhoneCharacters:
+    case ContactValidator::InvalidPhoneLength:
+        return QString("%1 (\"%2\")").arg(ContactValidator::message(result), row.phone);
+    case ContactValidator::InvalidEmail:
+        return QString("%1 (\"%2\")").arg(ContactValidator::message(result), row.email);
+    default:
+        return ContactValidator::message(result);
+    }
+}
+
+/**
+ * @brief Splits a top-level JSON array into chunks of whole objects
+ * Only tracks nesting and string state, no values are parsed here.
+ * @param onChunk Called with the JSON text of each chunk and its object count
+ * @return false if the data is not a JSON array
+ */
+template <typename OnChunk>
+bool splitJsonArray(const QByteArray& data, int chunkSize, OnChunk onChunk) {
+    qsizetype pos = 0;
+    while (pos < data.size() && QChar::isSpace(static_cast<uchar>(data[pos]))) {
+        ++pos;
+    }
+    if (pos == data.size() || data[pos] != '[') {
+        return false;
+    }
+
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    qsizetype chunkStart = -1;
+    int objects = 0;
+
+    for (; pos < data.size(); ++pos) {
+        const char ch = data[pos];
+
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (ch == '\\') {
+                escaped = true;
+            } else if (ch == '"') {
+                inString = false;
+            }
+            continue;
+        }
+
+        if (ch == '"') {
+            inString = true;
+        } else if (ch == '[' || ch == '{') {
+            if (depth == 1 && chunkStart < 0) {
+                chunkStart = pos;
+            }
+            ++depth;
+        } else if (ch == ']' || ch == '}') {
+            --depth;
+            if (depth == 1 && ++objects == chunkSize) {
+                onChunk("[" + data.mid(chunkStart, pos + 1 - chunkStart) + "]", objects);
+                chunkStart = -1;
+                objects = 0;
+            } else if (depth == 0) {
+                break;
+            }
+        }
+    }
+
+    if (objects > 0) {
+        onChunk("[" + data.mid(chunkStart, pos - chunkStart) + "]", objects);
+    }
+    return true;
+}
+
+ParsedChunk parseChunk(const RawChunk& chunk) {
+    ParsedChunk parsed;
+    parsed.sequence = chunk.sequence;
+
+    const QByteArray json = chunk.compressed ? qUncompress(chunk.data) : chunk.data;
+    const QJsonDocument doc = QJsonDocument::fromJson(json);
+
+    if (!doc.isArray()) {
+        for (int i = 0; i < chunk.rowCount; ++i) {
+            parsed.rejected.push_back({chunk.firstRow + i, "Malformed record"});
+        }
+        return parsed;
+    }
+
+    const QJsonArray array = doc.array();
+    parsed.rows.reserve(array.size());
+
+    for (qsizetype i = 0; i < array.size(); ++i) {
+        const QJsonObject obj = array[i].toObject();
+        ImportRow row;
+        row.row = chunk.firstRow + static_cast<int>(i);
+        row.name = ContactFields::value<ContactFields::Name>(obj).simplified();
+        row.phone = ContactFields::value<ContactFields::Phone>(obj).trimmed();
+        row.email = ContactFields::value<ContactFields::Email>(obj).trimmed();
+        row.address = ContactFields::value<ContactFields::Address>(obj).trimmed();
+        row.notes = ContactFields::value<ContactFields::Notes>(obj).trimmed();
+        row.created = ContactFields::value<ContactFields::Created>(obj);
+        row.modified = ContactFields::value<ContactFields::Modified>(obj);
+
+        const QString reason = checkRow(row);
+        if (reason.isEmpty()) {
+            parsed.rows.push_back(std::move(row));
+        } else {
+            parsed.rejected.push_back({row.row, reason});
+        }
+    }
+
+    return parsed;
+}
+
+} // namespace
+
+ContactImporter::ContactImporter(ContactManager& manager)
+    : manager(manager),
+    workerCount(std::max(1, QThread::idealThreadCount() - 1)) {
+}
+
+ImportReport ContactImporter::importFile(const QString& filename) {
+    ImportReport report;
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        report.error = QString("Cannot open %1").arg(filename);
+        return report;
+    }
+
+    const QByteArray data = file.readAll();
+    file.close();
+
+    // Compressed files are already chunked; read the block table up front
+    const bool compressed = ContactManager::isCompressedBlocks(data);
+    QList<QByteArray> blocks;
+    QList<quint32> blockCounts;
+    if (compressed && !ContactManager::readBlocks(data, blocks, blockCounts)) {
+        report.error = "The compressed file is damaged";
+        return report;
+    }
+
+    BoundedQueue<RawChunk> rawQueue(queueCapacity);
+    BoundedQueue<ParsedChunk> parsedQueue(queueCapacity);
+    bool isArray = true;
+
+    // Stage 1: reader
+    std::thread reader([&]() {
+        int sequence = 0;
+        int nextRow = 1;
+        auto emitChunk = [&](QByteArray bytes, int rows, bool isCompressed) {
+            RawChunk chunk;
+            chunk.sequence = sequence++;
+            chunk.firstRow = nextRow;
+            chunk.rowCount = rows;
+            chunk.compressed = isCompressed;
+            chunk.data = std::move(bytes);
+            nextRow += rows;
+            rawQueue.push(std::move(chunk));
+        };
+
+        if (compressed) {
+            for (qsizetype i = 0; i < blocks.size(); ++i) {
+                emitChunk(blocks[i], static_cast<int>(blockCounts[i]), true);
+            }
+        } else {
+            isArray = splitJsonArray(data, chunkSize, [&](QByteArray bytes, int rows) {
+                emitChunk(std::move(bytes), rows, false);
+            });
+        }
+        rawQueue.close();
+    });
+
+    // Stage 2: parse, normalize and validate in parallel
+    std::mutex workersMutex;
+    int activeWorkers = workerCount;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < workerCount; ++i) {
+        workers.emplace_back([&]() {
+            RawChunk chunk;
+            while (rawQueue.pop(chunk)) {
+                parsedQueue.push(parseChunk(chunk));
+            }
+
+            std::lock_guard<std::mutex> lock(workersMutex);
+            if (--activeWorkers == 0) {
+                parsedQueue.close();
+            }
+        });
+    }
+
+    // Stage 3: restore file order, drop duplicates and insert in batches.
+    // The whole import becomes one undo step.
+    Timestamp::Batch clock;
+    manager.beginUndoGroup(QString("Import %1").arg(QFileInfo(filename).fileName()));
+    std::map<int, ParsedChunk> pending;
+    std::set<QString> seenPhones;
+    std::vector<Contact> batch;
+    int nextSequence = 0;
+    ParsedChunk parsed;
+
+    while (parsedQueue.pop(parsed)) {
+        pending.emplace(parsed.sequence, std::move(parsed));
+
+        for (auto it = pending.find(nextSequence); it != pending.end();
+             it = pending.find(++nextSequence)) {
+            ParsedChunk& chunk = it->second;
+            report.invalid += static_cast<int>(chunk.rejected.size());
+            report.rejected.insert(report.rejected.end(),
+                                   chunk.rejected.begin(), chunk.rejected.end());
+
+            for (ImportRow& row : chunk.rows) {
+                if (manager.phoneExists(row.phone) || !seenPhones.insert(row.phone).second) {
+                    ++report.duplicates;
+                    report.rejected.push_back(
+                        {row.row, QString("Duplicate phone number \"%1\"").arg(row.phone)});
+                    continue;
+                }
+
+                // The chunk is discarded after this pass, so its strings can be moved
+                Contact contact(std::move(row.name), std::move(row.phone), std::move(row.email),
+                                std::move(row.address), std::move(row.notes));
+                if (row.created != Timestamp::kInvalid) {
+                    contact.setCreated(row.created);
+                }
+                if (row.modified != Timestamp::kInvalid) {
+                    contact.setModified(row.modified);
+                }
+                batch.push_back(std::move(contact));
+
+                if (batch.size() >= kInsertBatchSize) {
+                    report.imported += static_cast<int>(batch.size());
+                    manager.addContacts(std::move(batch));
+                    batch.clear();
+                }
+            }
+
+            pending.erase(it);
+        }
+    }
+
+    reader.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (!batch.empty()) {
+        report.imported += static_cast<int>(batch.size());
+        manager.addContacts(std::move(batch));
+    }
+    manager.endUndoGroup();
+
+    if (!isArray) {
+        report.error = "The file does not contain a list of contacts";
+        return report;
+    }
+
+    std::sort(report.rejected.begin(), report.rejected.end(),
+              [](const ImportReport::RejectedRow& a, const ImportReport::RejectedRow& b) {
+                  return a.row < b.row;
+              });
+    return report;
+}
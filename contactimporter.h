@@ -0,0 +1,74 @@
+/**
+ * @file contactimporter.h
+ * @brief Multi-threaded bulk importer with validation and duplicate detection
+ *
+ * An import runs as a pipeline of stages connected by bounded queues:
+ * 1. Reader: splits the file into chunks of whole contact records
+ * 2. Workers: parse, normalize and validate chunks in parallel
+ * 3. Inserter: drops duplicate phone numbers and inserts rows in batches
+ *
+ * Imported contacts are merged into the existing address book.
+ */
+
+#ifndef CONTACTIMPORTER_H
+#define CONTACTIMPORTER_H
+
+#include "contactmanager.h"
+#include <QString>
+#include <algorithm>
+#include <vector>
+
+/**
+ * @brief Outcome of an import
+ */
+struct ImportReport {
+    struct RejectedRow {
+        int row;            ///< 1-based position of the record in the file
+        QString reason;
+    };
+
+    int imported = 0;
+    int duplicates = 0;
+    int invalid = 0;
+    std::vector<RejectedRow> rejected;  ///< Invalid and duplicate rows in file order
+    QString error;                      ///< Set if the file could not be imported at all
+
+    bool succeeded() const { return error.isEmpty(); }
+};
+
+class ContactImporter {
+public:
+    explicit ContactImporter(ContactManager& manager);
+
+    /**
+     * @brief Sets how many records the reader puts into one chunk
+     */
+    void setChunkSize(int rows) { chunkSize = std::max(1, rows); }
+
+    /**
+     * @brief Sets how many chunks may wait between two stages
+     * Bounds memory use when parsing outruns insertion.
+     */
+    void setQueueCapacity(int chunks) { queueCapacity = std::max(1, chunks); }
+
+    /**
+     * @brief Sets the number of parse/validate worker threads
+     */
+    void setWorkerCount(int workers) { workerCount = std::max(1, workers); }
+
+    /**
+     * @brief Imports a JSON or CompressedBlocks contacts file
+     * @param filename Path to the file
+     * @return Counts of imported, duplicate and invalid rows
+     * Time Complexity: O(n log n), parsing spread over the worker threads
+     */
+    ImportReport importFile(const QString& filename);
+
+private:
+    ContactManager& manager;
+    int chunkSize = 512;
+    int queueCapacity = 8;
+    int workerCount;
+};
+
+#endif // CONTACTIMPORTER_H
@@ -4,7 +4,72 @@
  */
 
 #include "contactmanager.h"
+#include "contactfields.h"
+#include "crc32c.h"
+#include "phonetic.h"
 #include <QDebug>
+#include <QDataStream>
+#include <QDir>
+#include <QSaveFile>
+#include <QtEndian>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Header of the CompressedBlocks format:
+//   "CMZB" | version | block count | block*
+// Version 1 block: contact count | size | zlib data
+// Version 2 block: "CMBK" | contact count | size | crc32c | zlib data
+// The CRC-32C covers count, size and data. The marker lets a damaged file
+// be rescanned for the blocks that are still intact.
+const char kBlockMagic[4] = {'C', 'M', 'Z', 'B'};
+const char kBlockMarker[4] = {'C', 'M', 'B', 'K'};
+const quint32 kBlockFormatVersion = 2;
+const qsizetype kFileHeaderSize = sizeof(kBlockMagic) + 2 * sizeof(quint32);
+const qsizetype kBlockHeaderSize = sizeof(kBlockMarker) + 3 * sizeof(quint32);
+
+// Small enough to spread a load over many cores, large enough that repeated
+// keys inside a block still compress well.
+const size_t kContactsPerBlock = 1024;
+
+// Header of the page file:
+//   "CMPG" | version | contact count | page size | page count |
+//   (page count + 1) x quint64 offsets | page data
+const char kPageMagic[4] = {'C', 'M', 'P', 'G'};
+const quint32 kPageFormatVersion = 1;
+const qint64 kPageHeaderSize = sizeof(kPageMagic) + 4 * sizeof(quint32);
+
+// Delta files written by exportChangesSince()
+const char kDeltaFormat[] = "contact-delta";
+const int kDeltaFormatVersion = 1;
+
+// Address book file in the data directory, and its name before CompressedBlocks
+const char kDataFileName[] = "contacts_data.cmz";
+const char kLegacyDataFileName[] = "contacts_data.json";
+
+// Batches of at least this many removals update the text index in one pass
+const size_t kTextBatchRemoval = 64;
+
+// How often loadFromFile() reports progress
+const int kProgressInterval = 4096;
+
+// Orders groups by descending count, then key, keeping the first limit
+void rankFacetCounts(std::vector<ContactManager::FacetCount>& groups, size_t limit) {
+    auto larger = [](const ContactManager::FacetCount& a, const ContactManager::FacetCount& b) {
+        return a.count != b.count ? a.count > b.count : a.key < b.key;
+    };
+    if (limit > 0 && limit < groups.size()) {
+        std::partial_sort(groups.begin(), groups.begin() + limit, groups.end(), larger);
+        groups.resize(limit);
+    } else {
+        std::sort(groups.begin(), groups.end(), larger);
+    }
+}
+
+} // namespace
 
 ContactManager::ContactManager() {
 }
@@ -14,9 +79,17 @@ ContactManager::~ContactManager() {
 }
 
 bool ContactManager::addContact(const Contact& contact) {
+    return addContact(Contact(contact));
+}
+
+bool ContactManager::addContact(Contact&& contact) {
     try {
-        contacts.push_back(contact);
-        rebuildIndexMap();
+        contacts.push_back(std::move(contact));
+        const Contact& added = contacts.back();
+        idToIndex[added.getId()] = contacts.size() - 1;
+        indexContact(added);
+        recordChange(added.getId());
+        recordUndo(UndoStep::Added, added);
         return true;
     } catch (const std::exception& e) {
         qDebug() << "Error adding contact:" << e.what();
@@ -29,6 +102,9 @@ bool ContactManager::removeContact(int id) {
                            [id](const Contact& c) { return c.getId() == id; });
 
     if (it != contacts.end()) {
+        recordUndo(UndoStep::Removed, *it);
+        unindexContact(*it);
+        recordRemoval(*it);
         contacts.erase(it);
         rebuildIndexMap();
         return true;
@@ -37,20 +113,47 @@ bool ContactManager::removeContact(int id) {
 }
 
 bool ContactManager::updateContact(int id, const Contact& updatedContact) {
-    auto it = std::find_if(contacts.begin(), contacts.end(),
-                           [id](const Contact& c) { return c.getId() == id; });
+    return updateContact(id, Contact(updatedContact));
+}
+
+bool ContactManager::updateContact(int id, Contact&& updatedContact) {
+    auto mapIt = idToIndex.find(id);
+
+    if (mapIt != idToIndex.end()) {
+        Contact& existing = contacts[mapIt->second];
+        recordUndo(UndoStep::Updated, existing);
+        unindexContact(existing);
 
-    if (it != contacts.end()) {
         // Preserve the original ID and created date
-        Contact temp = updatedContact;
-        temp.setId(id);
-        *it = temp;
+        updatedContact.setId(id);
+        updatedContact.setCreated(existing.getCreated());
+        existing = std::move(updatedContact);
+
+        indexContact(existing);
+        recordChange(id);
         return true;
     }
     return false;
 }
 
-Contact* ContactManager::getContactById(int id) {
+Contact* ContactManager::beginFieldUpdate(int id, unsigned indexes) {
+    auto mapIt = idToIndex.find(id);
+    if (mapIt == idToIndex.end()) {
+        return nullptr;
+    }
+
+    Contact& existing = contacts[mapIt->second];
+    recordUndo(UndoStep::Updated, existing);
+    unindexContact(existing, indexes);
+    return &existing;
+}
+
+void ContactManager::endFieldUpdate(Contact& contact, unsigned indexes) {
+    indexContact(contact, indexes);
+    recordChange(contact.getId());
+}
+
+const Contact* ContactManager::getContactById(int id) const {
     auto mapIt = idToIndex.find(id);
     if (mapIt != idToIndex.end() && mapIt->second < contacts.size()) {
         return &contacts[mapIt->second];
@@ -74,6 +177,13 @@ std::vector<Contact> ContactManager::searchByName(const QString& searchTerm) con
 std::vector<Contact> ContactManager::searchByPhone(const QString& phoneNumber) const {
     std::vector<Contact> results;
 
+    if (PhoneDigits::pack(phoneNumber).length > 0) {
+        for (int id : phoneDigitIndex.search(phoneNumber, PhoneDigits::Substring)) {
+            results.push_back(contacts[idToIndex.at(id)]);
+        }
+        return results;
+    }
+
     for (const auto& contact : contacts) {
         if (contact.getPhone().contains(phoneNumber)) {
             results.push_back(contact);
@@ -83,42 +193,640 @@ std::vector<Contact> ContactManager::searchByPhone(const QString& phoneNumber) c
     return results;
 }
 
+std::vector<Contact> ContactManager::searchByPhonePrefix(const QString& prefix) const {
+    std::vector<Contact> results;
+    for (int id : phoneDigitIndex.search(prefix, PhoneDigits::Prefix)) {
+        results.push_back(contacts[idToIndex.at(id)]);
+    }
+    return results;
+}
+
+std::vector<Contact> ContactManager::getContactsInTimeRange(TimeField field, const QDateTime& from,
+                                                            const QDateTime& to) const {
+    const auto& index = timeIndex(field);
+    std::vector<Contact> results;
+
+    auto first = index.lower_bound({from.toMSecsSinceEpoch(), std::numeric_limits<int>::min()});
+    auto last = index.lower_bound({to.toMSecsSinceEpoch(), std::numeric_limits<int>::min()});
+    for (auto it = first; it != last; ++it) {
+        results.push_back(contacts[idToIndex.at(it->second)]);
+    }
+
+    return results;
+}
+
+std::vector<Contact> ContactManager::getMostRecent(TimeField field, size_t count) const {
+    const auto& index = timeIndex(field);
+    std::vector<Contact> results;
+
+    for (auto it = index.rbegin(); it != index.rend() && results.size() < count; ++it) {
+        results.push_back(contacts[idToIndex.at(it->second)]);
+    }
+
+    return results;
+}
+
+std::vector<Contact> ContactManager::search(const ContactQuery& query) const {
+    std::vector<Contact> results;
+
+    for (int id : QueryPlanner(*this).execute(query)) {
+        results.push_back(contacts[idToIndex.at(id)]);
+    }
+
+    return results;
+}
+
+std::vector<Contact> ContactManager::search(const ContactQuery& query, const SortKeys& keys) const {
+    const QString key = ContactSorter::describe(keys) + '|' + query.toString();
+    std::vector<int> ids;
+    bool cached = false;
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+
+        // Any mutation makes every entry stale; drop them all at once
+        if (cacheGeneration != changeSequence) {
+            dropCachedResults();
+            cacheGeneration = changeSequence;
+        }
+
+        auto it = resultCacheIndex.find(key);
+        if (it != resultCacheIndex.end()) {
+            resultCache.splice(resultCache.begin(), resultCache, it->second);
+            ids = it->second->ids;
+            cached = true;
+            ++cacheStats.hits;
+        } else {
+            ++cacheStats.misses;
+        }
+    }
+
+    if (!cached) {
+        ids = sortedIds(query, keys);
+
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (cacheGeneration == changeSequence && !resultCacheIndex.count(key)) {
+            size_t bytes = sizeof(CachedResult) + ids.size() * sizeof(int) +
+                           static_cast<size_t>(key.size()) * sizeof(QChar);
+            resultCache.push_front({key, ids, bytes});
+            resultCacheIndex[key] = resultCache.begin();
+            cacheStats.bytes += bytes;
+            trimCache();
+        }
+    }
+
+    std::vector<Contact> results;
+    results.reserve(ids.size());
+    for (int id : ids) {
+        results.push_back(contacts[idToIndex.at(id)]);
+    }
+    return results;
+}
+
+ContactManager::SortKeys ContactManager::sortKeysFor(SortOrder order) {
+    switch (order) {
+    case SortByNameAsc:      return {{ContactSorter::NameColumn, false}};
+    case SortByNameDesc:     return {{ContactSorter::NameColumn, true}};
+    case SortByIDAsc:        return {{ContactSorter::IdColumn, false}};
+    case SortByIDDesc:       return {{ContactSorter::IdColumn, true}};
+    case SortByModifiedDesc: return {{ContactSorter::ModifiedColumn, true}};
+    }
+    return SortKeys();
+}
+
+std::vector<int> ContactManager::sortedIds(const ContactQuery& query, const SortKeys& keys) const {
+    const ContactSorter::Key modifiedDesc{ContactSorter::ModifiedColumn, true};
+    const ContactSorter::Key idAsc{ContactSorter::IdColumn, false};
+    const ContactSorter::Key idDesc{ContactSorter::IdColumn, true};
+    std::vector<int> ids;
+
+    // The unfiltered newest-first ordering is already kept by the time index.
+    // Walking it backwards would put equal times in descending ID order, so
+    // each run of equal times is emitted forwards to keep the sorter's
+    // ascending-ID tie-break. (nameIndex has no such path: its toLower() keys
+    // do not order like the sorter's case-folded ones.)
+    if (query.predicates().empty() && keys.size() == 1 && keys.front() == modifiedDesc) {
+        auto runEnd = modifiedIndex.end();
+        while (runEnd != modifiedIndex.begin()) {
+            const qint64 msecs = std::prev(runEnd)->first;
+            auto runBegin = modifiedIndex.lower_bound({msecs, std::numeric_limits<int>::min()});
+            for (auto it = runBegin; it != runEnd; ++it) {
+                ids.push_back(it->second);
+            }
+            runEnd = runBegin;
+        }
+        return ids;
+    }
+
+    ids = QueryPlanner(*this).execute(query);  // Ascending IDs
+
+    if (keys.empty() || keys.front() == idAsc) {
+        return ids;  // IDs are unique, later keys cannot matter
+    }
+    if (keys.front() == idDesc) {
+        std::reverse(ids.begin(), ids.end());
+        return ids;
+    }
+
+    std::vector<const Contact*> rows;
+    rows.reserve(ids.size());
+    for (int id : ids) {
+        rows.push_back(&contacts[idToIndex.at(id)]);
+    }
+
+    std::vector<int> sorted;
+    sorted.reserve(ids.size());
+    for (size_t position : ContactSorter::order(rows, keys)) {
+        sorted.push_back(ids[position]);
+    }
+    return sorted;
+}
+
+void ContactManager::trimCache() const {
+    while (cacheStats.bytes > cacheBudget && !resultCache.empty()) {
+        const CachedResult& oldest = resultCache.back();
+        cacheStats.bytes -= oldest.bytes;
+        ++cacheStats.evictions;
+        resultCacheIndex.erase(oldest.key);
+        resultCache.pop_back();
+    }
+}
+
+void ContactManager::dropCachedResults() const {
+    cacheStats.invalidations += resultCache.size();
+    resultCache.clear();
+    resultCacheIndex.clear();
+    cacheStats.bytes = 0;
+}
+
+void ContactManager::setCacheBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cacheBudget = bytes;
+    trimCache();
+}
+
+ContactManager::CacheStats ContactManager::getCacheStats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    CacheStats stats = cacheStats;
+    stats.entries = resultCache.size();
+    return stats;
+}
+
+std::vector<ContactManager::TextHit> ContactManager::searchText(const QString& text,
+                                                                size_t limit) const {
+    std::vector<TextHit> results;
+    for (const TextIndex::Hit& hit : textIndex.search(text, limit)) {
+        results.push_back({contacts[idToIndex.at(hit.id)], hit.score});
+    }
+    return results;
+}
+
+std::vector<ContactManager::FacetCount> ContactManager::facetCounts(Facets::Kind kind,
+                                                                   size_t limit) const {
+    std::vector<FacetCount> groups;
+    groups.reserve(facetIndex[kind].size());
+    for (const auto& entry : facetIndex[kind]) {
+        groups.push_back({entry.first, static_cast<int>(entry.second.size())});
+    }
+    rankFacetCounts(groups, limit);
+    return groups;
+}
+
+std::vector<ContactManager::FacetCount> ContactManager::facetCounts(Facets::Kind kind,
+                                                                   const ContactQuery& query,
+                                                                   size_t limit) const {
+    if (query.predicates().empty()) {
+        return facetCounts(kind, limit);
+    }
+
+    std::unordered_map<QString, int> counts;
+    for (int id : QueryPlanner(*this).execute(query)) {
+        const QString key = Facets::key(kind, contacts[idToIndex.at(id)]);
+        if (!key.isEmpty()) {
+            ++counts[key];
+        }
+    }
+
+    std::vector<FacetCount> groups;
+    groups.reserve(counts.size());
+    for (const auto& entry : counts) {
+        groups.push_back({entry.first, entry.second});
+    }
+    rankFacetCounts(groups, limit);
+    return groups;
+}
+
+int ContactManager::facetCount(Facets::Kind kind, const QString& key) const {
+    auto it = facetIndex[kind].find(key);
+    return it == facetIndex[kind].end() ? 0 : static_cast<int>(it->second.size());
+}
+
+QString ContactManager::explain(const ContactQuery& query) const {
+    return QueryPlanner(*this).plan(query).toString(query);
+}
+
 std::vector<Contact> ContactManager::getAllContactsSorted() const {
     std::vector<Contact> sortedContacts = contacts;
     std::sort(sortedContacts.begin(), sortedContacts.end());
     return sortedContacts;
 }
 
-bool ContactManager::saveToFile(const QString& filename) const {
-    QJsonArray contactArray;
+QJsonObject ContactManager::contactToJson(const Contact& contact) {
+    return ContactFields::toJson(contact);
+}
 
-    for (const auto& contact : contacts) {
-        QJsonObject contactObj;
-        contactObj["id"] = contact.getId();
-        contactObj["name"] = contact.getName();
-        contactObj["phone"] = contact.getPhone();
-        contactObj["email"] = contact.getEmail();
-        contactObj["address"] = contact.getAddress();
-        contactObj["notes"] = contact.getNotes();
-        contactObj["created"] = contact.getCreatedDate().toString(Qt::ISODate);
-        contactObj["modified"] = contact.getModifiedDate().toString(Qt::ISODate);
+Contact ContactManager::contactFromJson(const QJsonObject& obj) {
+    // Keeps the original timestamps so the time indexes stay meaningful
+    return ContactFields::fromJson(obj);
+}
+
+QJsonArray ContactManager::toJsonArray(size_t first, size_t last) const {
+    QJsonArray contactArray;
 
+    for (size_t i = first; i < last; ++i) {
+        QJsonObject contactObj = contactToJson(contacts[i]);
+        contactObj["seq"] = static_cast<qint64>(changeOfId.at(contacts[i].getId()));
         contactArray.append(contactObj);
     }
 
-    QJsonDocument doc(contactArray);
-    QFile file(filename);
+    return contactArray;
+}
+
+QByteArray ContactManager::encodeBlocks() const {
+    QList<size_t> blockStarts;
+    for (size_t first = 0; first < contacts.size(); first += kContactsPerBlock) {
+        blockStarts.append(first);
+    }
+
+    // Compression and checksums both run per block on the pool
+    const QList<QByteArray> blocks = QtConcurrent::blockingMapped<QList<QByteArray>>(
+        blockStarts, [this](const size_t& first) {
+            size_t last = std::min(first + kContactsPerBlock, contacts.size());
+            return encodeBlock(qCompress(QJsonDocument(toJsonArray(first, last)).toJson(QJsonDocument::Compact)),
+                               static_cast<quint32>(last - first));
+        });
+
+    QByteArray data = blockFileHeader(static_cast<quint32>(blocks.size()));
+    for (const QByteArray& block : blocks) {
+        data.append(block);
+    }
+    return data;
+}
+
+QByteArray ContactManager::blockFileHeader(quint32 blockCount) {
+    QByteArray header(kFileHeaderSize, Qt::Uninitialized);
+    memcpy(header.data(), kBlockMagic, sizeof(kBlockMagic));
+    qToBigEndian(kBlockFormatVersion, header.data() + 4);
+    qToBigEndian(blockCount, header.data() + 8);
+    return header;
+}
+
+QByteArray ContactManager::encodeBlock(const QByteArray& payload, quint32 count) {
+    QByteArray block(kBlockHeaderSize, Qt::Uninitialized);
+    char *header = block.data();
+    memcpy(header, kBlockMarker, sizeof(kBlockMarker));
+    qToBigEndian(count, header + 4);
+    qToBigEndian(static_cast<quint32>(payload.size()), header + 8);
+    qToBigEndian(Crc32c::compute(payload, Crc32c::compute(header + 4, 8)), header + 12);
+    block.append(payload);
+    return block;
+}
 
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+bool ContactManager::isCompressedBlocks(const QByteArray& data) {
+    return data.startsWith(QByteArray(kBlockMagic, sizeof(kBlockMagic)));
+}
+
+bool ContactManager::scanBlocks(const QByteArray& data, QList<StoredBlock>& blocks) {
+    if (!isCompressedBlocks(data) || data.size() < kFileHeaderSize) {
+        return false;
+    }
+
+    const quint32 version = qFromBigEndian<quint32>(data.constData() + 4);
+    const quint32 blockCount = qFromBigEndian<quint32>(data.constData() + 8);
+    if (version != 1 && version != kBlockFormatVersion) {
+        return false;
+    }
+
+    // Version 1 blocks have no marker and no checksum
+    const qsizetype headerSize = version == 1 ? 2 * sizeof(quint32) : kBlockHeaderSize;
+    const qsizetype fieldsAt = version == 1 ? 0 : sizeof(kBlockMarker);
+
+    qsizetype pos = kFileHeaderSize;
+    for (quint32 i = 0; i < blockCount; ++i) {
+        if (data.size() - pos < headerSize ||
+            (version != 1 && memcmp(data.constData() + pos, kBlockMarker, sizeof(kBlockMarker)) != 0)) {
+            return false;
+        }
+
+        StoredBlock block;
+        block.start = pos;
+        block.payload = pos + headerSize;
+        block.count = qFromBigEndian<quint32>(data.constData() + pos + fieldsAt);
+        block.size = qFromBigEndian<quint32>(data.constData() + pos + fieldsAt + 4);
+        block.checked = version != 1;
+        block.checksum = block.checked ? qFromBigEndian<quint32>(data.constData() + pos + 12) : 0;
+        if (block.size > data.size() - block.payload) {
+            return false;
+        }
+
+        blocks.append(block);
+        pos = block.payload + block.size;
+    }
+    return true;
+}
+
+bool ContactManager::checksumMatches(const QByteArray& data, const StoredBlock& block) {
+    if (!block.checked) {
         return true;
     }
+    const quint32 header = Crc32c::compute(data.constData() + block.start + sizeof(kBlockMarker), 8);
+    return Crc32c::compute(data.constData() + block.payload, block.size, header) == block.checksum;
+}
 
-    return false;
+bool ContactManager::readBlocks(const QByteArray& data, QList<QByteArray>& compressed,
+                                QList<quint32>& counts) {
+    QList<StoredBlock> blocks;
+    if (!scanBlocks(data, blocks)) {
+        return false;
+    }
+
+    // The headers are walked sequentially, the checksums verified in parallel
+    const QList<bool> valid = QtConcurrent::blockingMapped<QList<bool>>(
+        blocks, [&data](const StoredBlock& block) { return checksumMatches(data, block); });
+    if (valid.contains(false)) {
+        return false;
+    }
+
+    for (const StoredBlock& block : blocks) {
+        compressed.append(data.mid(block.payload, block.size));
+        counts.append(block.count);
+    }
+    return true;
+}
+
+bool ContactManager::decodeBlocks(const QByteArray& data, QList<QJsonArray>& blocks) {
+    // Walk the headers sequentially, then decode the payloads in parallel
+    QList<QByteArray> compressed;
+    QList<quint32> counts;
+    if (!readBlocks(data, compressed, counts)) {
+        return false;
+    }
+
+    blocks = QtConcurrent::blockingMapped<QList<QJsonArray>>(
+        compressed, [](const QByteArray& block) {
+            return QJsonDocument::fromJson(qUncompress(block)).array();
+        });
+
+    for (qsizetype i = 0; i < blocks.size(); ++i) {
+        if (static_cast<quint32>(blocks[i].size()) != counts[i]) {
+            return false;
+        }
+    }
+    return true;
 }
 
-bool ContactManager::loadFromFile(const QString& filename) {
+bool ContactManager::readFileBlocks(const QString& filename, const BlockVisitor& visit) {
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Cannot open" << filename;
+        return false;
+    }
+
+    // Mapped rather than read, so only the pages of the current block are resident
+    const qint64 size = file.size();
+    const uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    if (!mapped) {
+        qDebug() << "Cannot map" << filename;
+        return false;
+    }
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), size);
+
+    if (!isCompressedBlocks(data)) {
+        const QJsonDocument doc = QJsonDocument::fromJson(data);
+        return doc.isArray() && visit(doc.array());
+    }
+
+    QList<StoredBlock> blocks;
+    if (!scanBlocks(data, blocks)) {
+        qDebug() << "Invalid or truncated block file" << filename;
+        return false;
+    }
+    for (const StoredBlock& block : blocks) {
+        if (!checksumMatches(data, block)) {
+            qDebug() << "Checksum mismatch in block at offset" << block.start;
+            return false;
+        }
+        const QJsonArray contacts = QJsonDocument::fromJson(
+            qUncompress(mapped + block.payload, block.size)).array();
+        if (static_cast<quint32>(contacts.size()) != block.count || !visit(contacts)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QList<ContactManager::StoredBlock> ContactManager::salvageBlocks(const QByteArray& data,
+                                                                 IntegrityReport& report) {
+    QList<StoredBlock> blocks;
+    if (!isCompressedBlocks(data) || data.size() < kFileHeaderSize) {
+        report.error = "Not a CompressedBlocks file";
+        return blocks;
+    }
+
+    const quint32 version = qFromBigEndian<quint32>(data.constData() + 4);
+    report.readable = true;
+    report.checksummed = version == kBlockFormatVersion;
+    report.blocks = static_cast<int>(qFromBigEndian<quint32>(data.constData() + 8));
+
+    // Without markers a damaged version 1 file cannot be resynchronized
+    if (!report.checksummed) {
+        if (!scanBlocks(data, blocks)) {
+            report.error = "The file is truncated or its block table is damaged";
+            blocks.clear();
+        }
+        return blocks;
+    }
+
+    // Every marker is a candidate, so blocks after a damaged length field
+    // are still found; a marker inside a payload fails its checksum
+    QList<StoredBlock> candidates;
+    const QByteArray marker(kBlockMarker, sizeof(kBlockMarker));
+    for (qsizetype pos = data.indexOf(marker, kFileHeaderSize); pos >= 0;
+         pos = data.indexOf(marker, pos + 1)) {
+        if (data.size() - pos < kBlockHeaderSize) {
+            break;
+        }
+        StoredBlock block;
+        block.start = pos;
+        block.payload = pos + kBlockHeaderSize;
+        block.count = qFromBigEndian<quint32>(data.constData() + pos + 4);
+        block.size = qFromBigEndian<quint32>(data.constData() + pos + 8);
+        block.checksum = qFromBigEndian<quint32>(data.constData() + pos + 12);
+        block.checked = true;
+        if (block.size <= data.size() - block.payload) {
+            candidates.append(block);
+        }
+    }
+
+    const QList<bool> valid = QtConcurrent::blockingMapped<QList<bool>>(
+        candidates, [&data](const StoredBlock& block) { return checksumMatches(data, block); });
+
+    qsizetype end = kFileHeaderSize;
+    for (qsizetype i = 0; i < candidates.size(); ++i) {
+        if (valid[i] && candidates[i].start >= end) {
+            blocks.append(candidates[i]);
+            end = candidates[i].payload + candidates[i].size;
+        }
+    }
+    if (end != data.size()) {
+        report.error = "The file has damaged or trailing data";
+    }
+    return blocks;
+}
+
+ContactManager::IntegrityReport ContactManager::verifyFile(const QString& filename) {
+    IntegrityReport report;
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        report.error = QString("Cannot open %1").arg(filename);
+        return report;
+    }
+    const QByteArray data = file.readAll();
+    file.close();
+
+    if (!isCompressedBlocks(data)) {
+        // JSON has no checksums; a full parse is the only check
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
+        report.readable = doc.isArray();
+        report.blocks = 1;
+        if (doc.isArray()) {
+            report.intactBlocks = 1;
+            report.contacts = static_cast<int>(doc.array().size());
+        } else {
+            report.error = parseError.error != QJsonParseError::NoError
+                               ? parseError.errorString() : QString("Not a list of contacts");
+        }
+        return report;
+    }
+
+    for (const StoredBlock& block : salvageBlocks(data, report)) {
+        ++report.intactBlocks;
+        report.contacts += static_cast<int>(block.count);
+    }
+    if (report.error.isEmpty() && report.intactBlocks != report.blocks) {
+        report.error = QString("%1 of %2 blocks are damaged")
+                           .arg(report.blocks - report.intactBlocks).arg(report.blocks);
+    }
+    return report;
+}
+
+ContactManager::IntegrityReport ContactManager::repairFile(const QString& filename,
+                                                           const QString& output) {
+    IntegrityReport report;
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        report.error = QString("Cannot open %1").arg(filename);
+        return report;
+    }
+    const QByteArray data = file.readAll();
+    file.close();
+
+    if (!isCompressedBlocks(data)) {
+        report.error = "Only CompressedBlocks files can be repaired";
+        return report;
+    }
+
+    // Intact blocks are copied as they are, nothing is decompressed
+    const QList<StoredBlock> blocks = salvageBlocks(data, report);
+    if (!report.readable) {
+        return report;
+    }
+    // A file with an unreadable block table can still be "readable"; an
+    // empty output would only replace it with nothing
+    if (blocks.isEmpty()) {
+        report.error = "No intact blocks to recover";
+        return report;
+    }
+
+    QByteArray repaired = blockFileHeader(static_cast<quint32>(blocks.size()));
+    for (const StoredBlock& block : blocks) {
+        if (block.checked) {
+            repaired.append(data.constData() + block.start, block.payload + block.size - block.start);
+        } else {
+            repaired.append(encodeBlock(data.mid(block.payload, block.size), block.count));
+        }
+        ++report.intactBlocks;
+        report.contacts += static_cast<int>(block.count);
+    }
+
+    if (!writeFileAtomically(output, repaired)) {
+        report.intactBlocks = 0;
+        report.contacts = 0;
+        report.error = QString("Cannot write %1").arg(output);
+    }
+    return report;
+}
+
+QString ContactManager::keepDamagedFile(const QString& filename) {
+    const QString damagedPath = filename + ".damaged";
+    QFile::remove(damagedPath);
+    if (!QFile::copy(filename, damagedPath)) {
+        qDebug() << "Cannot copy damaged file" << filename << "to" << damagedPath;
+        return QString();
+    }
+    return damagedPath;
+}
+
+ContactManager::StorageFormat ContactManager::formatForFile(const QString& filename) {
+    return filename.endsWith(".json", Qt::CaseInsensitive) ? CompactJson : CompressedBlocks;
+}
+
+QString ContactManager::dataFileIn(const QString& directory) {
+    const QDir dir(directory);
+    const QString path = dir.filePath(kDataFileName);
+    const QString legacyPath = dir.filePath(kLegacyDataFileName);
+
+    if (!QFile::exists(path) && QFile::exists(legacyPath)) {
+        if (QFile::rename(legacyPath, path)) {
+            QFile::rename(textIndexPath(legacyPath), textIndexPath(path));
+        } else {
+            qDebug() << "Cannot rename" << legacyPath << "to" << path;
+            return legacyPath;
+        }
+    }
+    return path;
+}
+
+bool ContactManager::writeFileAtomically(const QString& filename, const QByteArray& data) {
+    // QSaveFile writes a temporary file and renames it over the target on
+    // commit, so a crash leaves either the old or the new file, never a mix
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (file.write(data) != data.size()) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool ContactManager::saveToFile(const QString& filename, StorageFormat format) const {
+    QByteArray data;
+
+    if (format == CompressedBlocks) {
+        data = encodeBlocks();
+    } else {
+        QJsonDocument doc(toJsonArray(0, contacts.size()));
+        data = doc.toJson(format == CompactJson ? QJsonDocument::Compact
+                                                : QJsonDocument::Indented);
+    }
+
+    return writeFileAtomically(filename, data);
+}
+
+bool ContactManager::loadFromFile(const QString& filename, const LoadProgress& progress) {
     QFile file(filename);
 
     if (!file.open(QIODevice::ReadOnly)) {
@@ -128,46 +836,710 @@ bool ContactManager::loadFromFile(const QString& filename) {
     QByteArray data = file.readAll();
     file.close();
 
-    QJsonDocument doc = QJsonDocument::fromJson(data);
+    QList<QJsonArray> arrays;
+
+    if (isCompressedBlocks(data)) {
+        if (!decodeBlocks(data, arrays)) {
+            return false;
+        }
+    } else {
+        QJsonDocument doc = QJsonDocument::fromJson(data);
+
+        if (!doc.isArray()) {
+            return false;
+        }
+        arrays.append(doc.array());
+    }
+
+    deferTextIndex = true;
+    ++undoSuspended;
+    loadFromJsonArrays(arrays, progress);
+    --undoSuspended;
+    deferTextIndex = false;
+
+    // Tokenizing every note is the costly part of indexing, so prefer the
+    // saved index when it still describes these contacts
+    bool current = textIndex.loadFromFile(textIndexPath(filename), snapshotVersion());
+    if (current) {
+        const std::vector<int> ids = textIndex.documentIds();
+        current = std::all_of(ids.begin(), ids.end(),
+                              [this](int id) { return idToIndex.count(id) > 0; });
+    }
+    if (!current) {
+        textIndex.clear();
+        for (const auto& contact : contacts) {
+            textIndex.addDocument(contact.getId(), documentText(contact));
+        }
+    }
+    return true;
+}
+
+bool ContactManager::saveTextIndex(const QString& filename) const {
+    return textIndex.saveToFile(filename, snapshotVersion());
+}
+
+quint64 ContactManager::snapshotVersion() const {
+    quint64 version = 0;
+    for (const auto& entry : changeOfId) {
+        version = std::max(version, entry.second);
+    }
+    return version;
+}
 
+void ContactManager::loadFromJsonArrays(const QList<QJsonArray>& arrays,
+                                        const LoadProgress& progress) {
+    clear();
+
+    // Contacts are stamped on construction before their stored times are
+    // restored; one clock read serves the whole load
+    Timestamp::Batch clock;
+
+    int total = 0;
+    for (const QJsonArray& contactArray : arrays) {
+        total += static_cast<int>(contactArray.size());
+    }
+    contacts.reserve(total);
+
+    for (const QJsonArray& contactArray : arrays) {
+        for (const auto& value : contactArray) {
+            QJsonObject obj = value.toObject();
+            Contact contact = contactFromJson(obj);
+
+            // Reuse the stored ID so deltas and other instances agree on it
+            int storedId = obj["id"].toInt(-1);
+            if (storedId > 0 && idToIndex.find(storedId) == idToIndex.end()) {
+                contact.setId(storedId);
+                Contact::reserveId(storedId);
+            }
+
+            const int id = contact.getId();
+            addContact(std::move(contact));
+            recordChange(id, static_cast<quint64>(obj["seq"].toInteger()));
+
+            if (progress && getContactCount() % kProgressInterval == 0) {
+                progress(getContactCount(), total);
+            }
+        }
+    }
+
+    if (progress) {
+        progress(getContactCount(), total);
+    }
+
+    // Deletes from before this load were not saved
+    deltaFloor = changeSequence;
+}
+
+bool ContactManager::savePageFile(const QString& filename, int pageSize, int pageCount) const {
+    pageSize = std::max(1, pageSize);
+    const size_t rows = pageCount < 0 ? contacts.size()
+                                      : std::min(contacts.size(), size_t(pageSize) * size_t(pageCount));
+
+    // Byte-comparable name keys are built once; only the rows that are
+    // written get sorted, so saving the first pages stays cheap on big books
+    const std::vector<ContactSorter::Key> byName = {{ContactSorter::NameColumn}};
+    std::vector<std::pair<QByteArray, size_t>> keyed(contacts.size());
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        keyed[i] = {ContactSorter::collationKey(contacts[i], byName, static_cast<quint32>(i)), i};
+    }
+    std::partial_sort(keyed.begin(), keyed.begin() + rows, keyed.end());
+
+    std::vector<size_t> order(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        order[i] = keyed[i].second;
+    }
+
+    QList<QByteArray> pages;
+    for (size_t first = 0; first < order.size(); first += pageSize) {
+        QJsonArray pageArray;
+        for (size_t i = first; i < std::min(first + pageSize, order.size()); ++i) {
+            pageArray.append(contactToJson(contacts[order[i]]));
+        }
+        pages.append(QJsonDocument(pageArray).toJson(QJsonDocument::Compact));
+    }
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out.writeRawData(kPageMagic, sizeof(kPageMagic));
+    out << kPageFormatVersion << static_cast<quint32>(contacts.size())
+        << static_cast<quint32>(pageSize) << static_cast<quint32>(pages.size());
+
+    // Offset table with one extra entry marking the end of the last page
+    quint64 offset = kPageHeaderSize + (pages.size() + 1) * sizeof(quint64);
+    for (const QByteArray& page : pages) {
+        out << offset;
+        offset += page.size();
+    }
+    out << offset;
+
+    for (const QByteArray& page : pages) {
+        out.writeRawData(page.constData(), page.size());
+    }
+
+    return writeFileAtomically(filename, data);
+}
+
+bool ContactManager::readPage(const QString& filename, int page,
+                              std::vector<Contact>& pageContacts, int& totalCount) {
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    char magic[sizeof(kPageMagic)];
+    quint32 version = 0;
+    quint32 count = 0;
+    quint32 pageSize = 0;
+    quint32 pageCount = 0;
+    if (in.readRawData(magic, sizeof(magic)) != sizeof(magic) ||
+        memcmp(magic, kPageMagic, sizeof(magic)) != 0) {
+        return false;
+    }
+    in >> version >> count >> pageSize >> pageCount;
+    totalCount = static_cast<int>(count);
+    pageContacts.clear();
+
+    if (in.status() != QDataStream::Ok || version != kPageFormatVersion) {
+        return false;
+    }
+    if (page < 0 || static_cast<quint32>(page) >= pageCount) {
+        return count == 0 && page == 0;
+    }
+
+    // Only the two offsets around the page and the page itself are read
+    quint64 begin = 0;
+    quint64 end = 0;
+    if (!file.seek(kPageHeaderSize + page * static_cast<qint64>(sizeof(quint64)))) {
+        return false;
+    }
+    in >> begin >> end;
+    if (in.status() != QDataStream::Ok || end < begin ||
+        end > static_cast<quint64>(file.size()) || !file.seek(begin)) {
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.read(end - begin));
     if (!doc.isArray()) {
         return false;
     }
 
-    clear();
-    QJsonArray contactArray = doc.array();
+    for (const auto& value : doc.array()) {
+        QJsonObject obj = value.toObject();
+        Contact contact = contactFromJson(obj);
+        contact.setId(obj["id"].toInt());
+        pageContacts.push_back(contact);
+    }
+
+    return true;
+}
+
+bool ContactManager::exportChangesSince(quint64 sequence, const QString& filename) const {
+    if (!canExportChangesSince(sequence)) {
+        return false;
+    }
+
+    QJsonArray upserts;
+    for (auto it = changeLog.upper_bound(sequence); it != changeLog.end(); ++it) {
+        QJsonObject contactObj = contactToJson(contacts[idToIndex.at(it->second)]);
+        contactObj["seq"] = static_cast<qint64>(it->first);
+        upserts.append(contactObj);
+    }
+
+    QJsonArray deletes;
+    for (auto it = tombstones.upper_bound(sequence); it != tombstones.end(); ++it) {
+        QJsonObject deleteObj;
+        deleteObj["id"] = it->second.id;
+        deleteObj[ContactFields::Created::key] = Timestamp::toIso(it->second.created);
+        deleteObj[ContactFields::Phone::key] = it->second.phone;
+        deleteObj["seq"] = static_cast<qint64>(it->first);
+        deletes.append(deleteObj);
+    }
+
+    QJsonObject delta;
+    delta["format"] = kDeltaFormat;
+    delta["version"] = kDeltaFormatVersion;
+    delta["fromSequence"] = static_cast<qint64>(sequence);
+    delta["toSequence"] = static_cast<qint64>(changeSequence);
+    delta["upserts"] = upserts;
+    delta["deletes"] = deletes;
+
+    return writeFileAtomically(filename, QJsonDocument(delta).toJson(QJsonDocument::Compact));
+}
+
+ContactManager::DeltaResult ContactManager::applyChanges(const QString& filename) {
+    DeltaResult result;
+    QFile file(filename);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return result;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+
+    QJsonObject delta = doc.object();
+    if (delta["format"].toString() != kDeltaFormat ||
+        delta["version"].toInt() != kDeltaFormatVersion) {
+        return result;
+    }
 
-    for (const auto& value : contactArray) {
+    Timestamp::Batch clock;
+    beginUndoGroup("Apply changes");
+
+    std::vector<int> deletes;
+    for (const auto& value : delta["deletes"].toArray()) {
+        QJsonObject obj = value.toObject();
+        int localId = findDeltaContact(obj["id"].toInt(-1),
+                                       ContactFields::Created::fromJson(obj[ContactFields::Created::key]),
+                                       obj[ContactFields::Phone::key].toString());
+        if (localId > 0) {
+            deletes.push_back(localId);
+        }
+    }
+    result.deletes = removeContacts(deletes);
+
+    for (const auto& value : delta["upserts"].toArray()) {
         QJsonObject obj = value.toObject();
+        int id = obj["id"].toInt(-1);
+        if (id <= 0) {
+            continue;
+        }
 
-        Contact contact(
-            obj["name"].toString(),
-            obj["phone"].toString(),
-            obj["email"].toString(),
-            obj["address"].toString(),
-            obj["notes"].toString()
-            );
+        Contact contact = contactFromJson(obj);
+        int localId = findDeltaContact(id, contact.getCreated(), contact.getPhone());
+
+        // The sender's store allowed the phone; ours may have given it to
+        // another contact since the receiver last synced
+        if (phoneExists(contact.getPhone(), localId)) {
+            qDebug() << "Skipping delta contact" << id << "- phone already in use:" << contact.getPhone();
+            ++result.phoneConflicts;
+            continue;
+        }
 
-        addContact(contact);
+        if (localId > 0) {
+            // Take the sender's record verbatim, including its created date
+            contact.setId(localId);
+            Contact& existing = contacts[idToIndex.at(localId)];
+            recordUndo(UndoStep::Updated, existing);
+            unindexContact(existing);
+            existing = std::move(contact);
+            indexContact(existing);
+            recordChange(localId);
+        } else if (idToIndex.count(id)) {
+            // Both sides created a contact under this ID; ours keeps it and
+            // the sender's keeps the fresh ID contactFromJson() gave it
+            addContact(std::move(contact));
+        } else {
+            contact.setId(id);
+            Contact::reserveId(id);
+            addContact(std::move(contact));
+        }
+        ++result.upserts;
     }
 
+    endUndoGroup();
+    result.valid = true;
+    return result;
+}
+
+void ContactManager::compactChangeLog(quint64 sequence) {
+    sequence = std::min(sequence, changeSequence);
+    tombstones.erase(tombstones.begin(), tombstones.upper_bound(sequence));
+    deltaFloor = std::max(deltaFloor, sequence);
+}
+
+int ContactManager::findDeltaContact(int id, qint64 created, const QString& phone) const {
+    auto mapIt = idToIndex.find(id);
+    if (mapIt != idToIndex.end()) {
+        const qint64 localCreated = contacts[mapIt->second].getCreated();
+        if (created == Timestamp::kInvalid || localCreated == created) {
+            return id;
+        }
+    }
+    if (created == Timestamp::kInvalid) {
+        return 0;
+    }
+
+    // A conflicting create applied earlier lives on under another ID
+    auto range = phoneIndex.equal_range(phone);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (contacts[idToIndex.at(it->second)].getCreated() == created) {
+            return it->second;
+        }
+    }
+    return 0;
+}
+
+bool ContactManager::addContacts(const std::vector<Contact>& batch) {
+    return addContacts(std::vector<Contact>(batch));
+}
+
+bool ContactManager::addContacts(std::vector<Contact>&& batch) {
+    try {
+        // Grow geometrically: reserving the exact size on every batch would
+        // reallocate and move the whole store once per batch
+        const size_t needed = contacts.size() + batch.size();
+        if (needed > contacts.capacity()) {
+            contacts.reserve(std::max(needed, contacts.capacity() * 2));
+        }
+    } catch (const std::exception& e) {
+        qDebug() << "Error reserving space for contacts:" << e.what();
+        return false;
+    }
+
+    Timestamp::Batch clock;
+    beginUndoGroup(QString("Add %1 contacts").arg(batch.size()));
+    for (auto& contact : batch) {
+        addContact(std::move(contact));
+    }
+    endUndoGroup();
+    return true;
+}
+
+int ContactManager::removeContacts(const std::vector<int>& ids) {
+    // Small batches remove their own words; larger ones rewrite every
+    // posting list once, which beats one decode/encode per contact
+    const bool textPerContact = ids.size() < kTextBatchRemoval;
+
+    std::set<int> removed;
+    beginUndoGroup(QString("Delete %1 contacts").arg(ids.size()));
+    for (int id : ids) {
+        auto mapIt = idToIndex.find(id);
+        if (mapIt != idToIndex.end() && removed.insert(id).second) {
+            const Contact& contact = contacts[mapIt->second];
+            recordUndo(UndoStep::Removed, contact);
+            unindexContact(contact, textPerContact ? AllIndexes : AllIndexes & ~TextIndexes);
+            recordRemoval(contact);
+        }
+    }
+    endUndoGroup();
+    if (removed.empty()) {
+        return 0;
+    }
+    if (!textPerContact) {
+        textIndex.removeDocuments(removed);
+    }
+
+    // One compaction pass and one index rebuild for the whole batch
+    contacts.erase(std::remove_if(contacts.begin(), contacts.end(),
+                                  [&removed](const Contact& c) { return removed.count(c.getId()) > 0; }),
+                   contacts.end());
+    rebuildIndexMap();
+    return static_cast<int>(removed.size());
+}
+
+void ContactManager::beginUndoGroup(const QString& label) {
+    if (undoGroupDepth++ == 0) {
+        openGroup = UndoGroup();
+        openGroup.label = label;
+    }
+}
+
+void ContactManager::endUndoGroup() {
+    if (undoGroupDepth == 0 || --undoGroupDepth > 0) {
+        return;
+    }
+    if (!openGroup.steps.empty()) {
+        pushUndoGroup(std::move(openGroup));
+    }
+    openGroup = UndoGroup();
+}
+
+void ContactManager::recordUndo(UndoStep::Kind kind, const Contact& contact) {
+    if (undoSuspended > 0) {
+        return;
+    }
+    redoStack.clear();
+
+    // Added contacts share their strings with the live copy; removed and
+    // replaced versions are only kept alive by the history
+    size_t bytes = sizeof(UndoStep);
+    if (kind != UndoStep::Added) {
+        bytes += sizeof(QChar) * static_cast<size_t>(contact.getName().size() + contact.getPhone().size() +
+                                                      contact.getEmail().size() + contact.getAddress().size() +
+                                                      contact.getNotes().size());
+    }
+
+    if (undoGroupDepth > 0) {
+        openGroup.steps.push_back({kind, contact});
+        openGroup.bytes += bytes;
+        return;
+    }
+
+    UndoGroup group;
+    switch (kind) {
+    case UndoStep::Added:   group.label = QString("Add %1").arg(contact.getName()); break;
+    case UndoStep::Removed: group.label = QString("Delete %1").arg(contact.getName()); break;
+    case UndoStep::Updated: group.label = QString("Edit %1").arg(contact.getName()); break;
+    }
+    group.steps.push_back({kind, contact});
+    group.bytes = bytes;
+    pushUndoGroup(std::move(group));
+}
+
+void ContactManager::pushUndoGroup(UndoGroup&& group) {
+    undoBytes += group.bytes;
+    undoStack.push_back(std::move(group));
+
+    while (undoStack.size() > 1 && undoBytes > undoBudget) {
+        undoBytes -= undoStack.front().bytes;
+        undoStack.pop_front();
+    }
+}
+
+void ContactManager::replayGroup(UndoGroup& group, bool undoing) {
+    ++undoSuspended;
+
+    // Consecutive removals are collected and applied in one pass
+    std::vector<int> pendingRemovals;
+    auto flushRemovals = [this, &pendingRemovals]() {
+        removeContacts(pendingRemovals);
+        pendingRemovals.clear();
+    };
+
+    auto apply = [&](UndoStep& step) {
+        const bool remove = (step.kind == UndoStep::Added) == undoing;
+        if (step.kind != UndoStep::Updated && remove) {
+            pendingRemovals.push_back(step.contact.getId());
+            return;
+        }
+        flushRemovals();
+
+        if (step.kind != UndoStep::Updated) {
+            addContact(step.contact);
+            return;
+        }
+
+        auto mapIt = idToIndex.find(step.contact.getId());
+        if (mapIt == idToIndex.end()) {
+            return;
+        }
+        Contact& live = contacts[mapIt->second];
+        unindexContact(live);
+        std::swap(live, step.contact);
+        indexContact(live);
+        recordChange(live.getId());
+    };
+
+    if (undoing) {
+        std::for_each(group.steps.rbegin(), group.steps.rend(), apply);
+    } else {
+        std::for_each(group.steps.begin(), group.steps.end(), apply);
+    }
+    flushRemovals();
+
+    --undoSuspended;
+}
+
+bool ContactManager::undo() {
+    if (undoStack.empty() || undoGroupDepth > 0) {
+        return false;
+    }
+
+    UndoGroup group = std::move(undoStack.back());
+    undoStack.pop_back();
+    undoBytes -= group.bytes;
+
+    replayGroup(group, true);
+    redoStack.push_back(std::move(group));
     return true;
 }
 
+bool ContactManager::redo() {
+    if (redoStack.empty() || undoGroupDepth > 0) {
+        return false;
+    }
+
+    UndoGroup group = std::move(redoStack.back());
+    redoStack.pop_back();
+
+    replayGroup(group, false);
+    pushUndoGroup(std::move(group));
+    return true;
+}
+
+void ContactManager::setUndoBudget(size_t bytes) {
+    undoBudget = bytes;
+    while (undoStack.size() > 1 && undoBytes > undoBudget) {
+        undoBytes -= undoStack.front().bytes;
+        undoStack.pop_front();
+    }
+}
+
+void ContactManager::clearUndoHistory() {
+    undoStack.clear();
+    redoStack.clear();
+    undoBytes = 0;
+}
+
 void ContactManager::clear() {
     contacts.clear();
     idToIndex.clear();
+    phoneIndex.clear();
+    phoneDigitIndex.clear();
+    nameIndex.clear();
+    trigramIndex.clear();
+    phoneticIndex.clear();
+    for (auto& index : facetIndex) {
+        index.clear();
+    }
+    textIndex.clear();
+    createdIndex.clear();
+    modifiedIndex.clear();
+
+    changeOfId.clear();
+    changeLog.clear();
+    tombstones.clear();
+    deltaFloor = changeSequence;
+
+    // The history refers to contacts that no longer exist
+    clearUndoHistory();
+
+    // clear() does not bump changeSequence, so drop cached results here
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    dropCachedResults();
 }
 
 bool ContactManager::phoneExists(const QString& phone, int excludeId) const {
-    for (const auto& contact : contacts) {
-        if (contact.getId() != excludeId && contact.getPhone() == phone) {
+    auto range = phoneIndex.equal_range(phone);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second != excludeId) {
             return true;
         }
     }
     return false;
 }
 
+void ContactManager::recordChange(int id, quint64 sequence) {
+    auto previous = changeOfId.find(id);
+    if (previous != changeOfId.end()) {
+        changeLog.erase(previous->second);
+    }
+
+    // A restored sequence must not collide with one already handed out
+    if (sequence == 0 || changeLog.count(sequence)) {
+        sequence = ++changeSequence;
+    } else {
+        changeSequence = std::max(changeSequence, sequence);
+    }
+
+    changeOfId[id] = sequence;
+    changeLog[sequence] = id;
+}
+
+void ContactManager::recordRemoval(const Contact& contact) {
+    const int id = contact.getId();
+    auto previous = changeOfId.find(id);
+    if (previous != changeOfId.end()) {
+        changeLog.erase(previous->second);
+        changeOfId.erase(previous);
+    }
+
+    tombstones[++changeSequence] = Tombstone{id, contact.getCreated(), contact.getPhone()};
+}
+
+void ContactManager::indexContact(const Contact& contact, unsigned indexes) {
+    const int id = contact.getId();
+
+    if (indexes & PhoneIndexes) {
+        phoneIndex.emplace(ContactFields::Phone::indexKey(contact), id);
+        phoneDigitIndex.insert(id, contact.getPhone());
+    }
+    if (indexes & NameIndexes) {
+        const QString lowerName = ContactFields::Name::indexKey(contact);
+        nameIndex.emplace(lowerName, id);
+        for (const QString& trigram : QueryPlanner::trigrams(lowerName)) {
+            trigramIndex[trigram].insert(id);
+        }
+        for (const QString& key : Phonetic::nameKeys(contact.getName())) {
+            phoneticIndex[key].insert(id);
+        }
+    }
+    if (indexes & CreatedIndexes) {
+        createdIndex.emplace(ContactFields::Created::indexKey(contact), id);
+    }
+    if (indexes & ModifiedIndexes) {
+        modifiedIndex.emplace(ContactFields::Modified::indexKey(contact), id);
+    }
+    for (int kind = 0; kind < Facets::kKindCount; ++kind) {
+        if (!(indexes & facetIndexes(static_cast<Facets::Kind>(kind)))) {
+            continue;
+        }
+        const QString key = Facets::key(static_cast<Facets::Kind>(kind), contact);
+        if (!key.isEmpty()) {
+            facetIndex[kind][key].insert(id);
+        }
+    }
+    if ((indexes & TextIndexes) && !deferTextIndex) {
+        textIndex.addDocument(id, documentText(contact));
+    }
+}
+
+void ContactManager::unindexContact(const Contact& contact, unsigned indexes) {
+    const int id = contact.getId();
+
+    auto eraseEntry = [id](std::multimap<QString, int>& index, const QString& key) {
+        auto range = index.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == id) {
+                index.erase(it);
+                return;
+            }
+        }
+    };
+    auto eraseFromSet = [id](auto& index, const QString& key) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second.erase(id);
+            if (it->second.empty()) {
+                index.erase(it);
+            }
+        }
+    };
+
+    if (indexes & PhoneIndexes) {
+        eraseEntry(phoneIndex, ContactFields::Phone::indexKey(contact));
+        phoneDigitIndex.remove(id);
+    }
+    if (indexes & NameIndexes) {
+        const QString lowerName = ContactFields::Name::indexKey(contact);
+        eraseEntry(nameIndex, lowerName);
+        for (const QString& trigram : QueryPlanner::trigrams(lowerName)) {
+            eraseFromSet(trigramIndex, trigram);
+        }
+        for (const QString& key : Phonetic::nameKeys(contact.getName())) {
+            eraseFromSet(phoneticIndex, key);
+        }
+    }
+    if (indexes & CreatedIndexes) {
+        createdIndex.erase(std::make_pair(ContactFields::Created::indexKey(contact), id));
+    }
+    if (indexes & ModifiedIndexes) {
+        modifiedIndex.erase(std::make_pair(ContactFields::Modified::indexKey(contact), id));
+    }
+    for (int kind = 0; kind < Facets::kKindCount; ++kind) {
+        if (indexes & facetIndexes(static_cast<Facets::Kind>(kind))) {
+            eraseFromSet(facetIndex[kind], Facets::key(static_cast<Facets::Kind>(kind), contact));
+        }
+    }
+    if (indexes & TextIndexes) {
+        textIndex.removeDocument(id, documentText(contact));
+    }
+}
+
+unsigned ContactManager::facetIndexes(Facets::Kind kind) {
+    switch (kind) {
+    case Facets::EmailDomain: return EmailIndexes;
+    case Facets::CountryCode: return PhoneIndexes;
+    case Facets::City:        return AddressIndexes;
+    }
+    return AllIndexes;
+}
 
 void ContactManager::rebuildIndexMap() {
     idToIndex.clear();
@@ -8,6 +8,9 @@
  * - Vector for main storage (dynamic array)
  * - Map for quick ID-based lookup (Red-Black Tree)
  * - Set for maintaining sorted order (BST)
+ * - Multimaps and trigram posting sets as secondary indexes for queries
+ * - Hash map of Soundex codes for sound-alike name search
+ * - Compressed inverted index for ranked search of notes and addresses
  *
  * Demonstrates usage of STL containers for efficient data management.
  */
@@ -16,21 +19,94 @@
 #define CONTACTMANAGER_H
 
 #include "contact.h"
+#include "contactfields.h"
+#include "contactquery.h"
+#include "contactsorter.h"
+#include "facets.h"
+#include "phonedigitindex.h"
+#include "textindex.h"
 #include <vector>
 #include <map>
 #include <set>
 #include <algorithm>
+#include <functional>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <QFile>
 #include <QTextStream>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QList>
 
 class ContactManager {
 public:
     ContactManager();
     ~ContactManager();
 
+    /**
+     * @brief Timestamp fields covered by the time indexes
+     */
+    enum TimeField {
+        CreatedTime,
+        ModifiedTime
+    };
+
+    /**
+     * @brief Result orderings offered by the sort combo box
+     */
+    enum SortOrder {
+        SortByNameAsc,
+        SortByNameDesc,
+        SortByIDAsc,
+        SortByIDDesc,
+        SortByModifiedDesc
+    };
+
+    /**
+     * @brief Multi-column ordering, most significant column first
+     */
+    using SortKeys = std::vector<ContactSorter::Key>;
+
+    /**
+     * @brief Counters describing the query result cache
+     */
+    struct CacheStats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;       ///< Entries dropped to stay within budget
+        quint64 invalidations = 0;   ///< Entries dropped because the store changed
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    /**
+     * @brief On-disk formats understood by saveToFile()/loadFromFile()
+     */
+    enum StorageFormat {
+        IndentedJson,       ///< Human readable JSON array (original format)
+        CompactJson,        ///< Same JSON array without whitespace
+        CompressedBlocks    ///< zlib-compressed JSON blocks with CRC-32C checksums
+    };
+
+    /**
+     * @brief Result of verifyFile() or repairFile()
+     */
+    struct IntegrityReport {
+        bool readable = false;      ///< The file could be opened and its format recognized
+        bool checksummed = false;   ///< Blocks carry CRC-32C checksums (version 2 files)
+        int blocks = 0;             ///< Blocks the file header declares
+        int intactBlocks = 0;       ///< Blocks that passed verification or were kept
+        int contacts = 0;           ///< Contacts in the intact blocks
+        QString error;              ///< First problem found, empty if none
+
+        bool isIntact() const { return readable && error.isEmpty(); }
+    };
+
     /**
  * @brief Checks if a phone number already exists
  * @param phone The phone number to check
@@ -48,6 +124,37 @@ public:
      */
     bool addContact(const Contact& contact);
 
+    /**
+     * @brief Adds a contact by moving it into the store
+     * The fields are moved, not copied; contact is left empty.
+     */
+    bool addContact(Contact&& contact);
+
+    /**
+     * @brief Constructs a contact from the Contact constructor arguments
+     * and moves it into the store
+     * @return ID of the new contact, or -1 if it could not be added
+     */
+    template <typename... Args>
+    int emplaceContact(Args&&... args) {
+        Contact contact(std::forward<Args>(args)...);
+        const int id = contact.getId();
+        return addContact(std::move(contact)) ? id : -1;
+    }
+
+    /**
+     * @brief Adds many contacts at once
+     * @param batch The contacts to add
+     * @return true if successful, false otherwise
+     * Time Complexity: O(k log n), storage grows only once per batch
+     */
+    bool addContacts(const std::vector<Contact>& batch);
+
+    /**
+     * @brief Adds many contacts at once, moving them out of batch
+     */
+    bool addContacts(std::vector<Contact>&& batch);
+
     /**
      * @brief Removes a contact by ID
      * @param id The unique identifier of the contact
@@ -56,6 +163,15 @@ public:
      */
     bool removeContact(int id);
 
+    /**
+     * @brief Removes many contacts in one pass over the storage
+     * The removals are undone as one step.
+     * @param ids Contacts to remove; unknown IDs are ignored
+     * @return Number of contacts removed
+     * Time Complexity: O(n + k log n) instead of O(k n) for k single removals
+     */
+    int removeContacts(const std::vector<int>& ids);
+
     /**
      * @brief Updates an existing contact
      * @param id The ID of the contact to update
@@ -65,13 +181,47 @@ public:
      */
     bool updateContact(int id, const Contact& updatedContact);
 
+    /**
+     * @brief Updates an existing contact, moving the new data into place
+     */
+    bool updateContact(int id, Contact&& updatedContact);
+
+    /**
+     * @brief Changes one field of a contact in place
+     * @tparam Descriptor A ContactFields descriptor, e.g. ContactFields::Notes
+     * @param id The ID of the contact to update
+     * @param value The new value, moved into the contact
+     * @return false if no contact has this ID
+     * Time Complexity: O(log n) plus re-indexing the indexes built from
+     * this field; e.g. a notes change skips the name and phone indexes
+     *
+     * Usage: manager.updateField<ContactFields::Notes>(id, notes);
+     */
+    template <typename Descriptor>
+    bool updateField(int id, typename Descriptor::Type value) {
+        static_assert(!std::is_same<typename Descriptor::Type, int>::value,
+                      "Contact IDs cannot be changed");
+        // Every setter stamps the modified time, so its index always moves
+        const unsigned indexes = indexesOf<Descriptor>() | ModifiedIndexes;
+        Contact *contact = beginFieldUpdate(id, indexes);
+        if (!contact) {
+            return false;
+        }
+        Descriptor::set(*contact, std::move(value));
+        endFieldUpdate(*contact, indexes);
+        return true;
+    }
+
     /**
      * @brief Retrieves a contact by ID
      * @param id The unique identifier
      * @return Pointer to contact if found, nullptr otherwise
      * Time Complexity: O(log n) using map
+     *
+     * The contact is read-only so that secondary indexes stay in sync;
+     * use updateContact() to change it.
      */
-    Contact* getContactById(int id);
+    const Contact* getContactById(int id) const;
 
     /**
      * @brief Searches contacts by name (partial match)
@@ -83,12 +233,152 @@ public:
 
     /**
      * @brief Searches contacts by phone number
+     * Digits are compared without separators, so "98765" finds
+     * "+91 98765-43210"; a query starting with + or 00 is matched against
+     * the national number in that country. A query without digits falls
+     * back to a plain text match.
      * @param phoneNumber The phone to search for
-     * @return Vector of matching contacts
-     * Time Complexity: O(n)
+     * @return Vector of matching contacts in ID order
+     * Time Complexity: O(n), over the packed digit column
      */
     std::vector<Contact> searchByPhone(const QString& phoneNumber) const;
 
+    /**
+     * @brief Finds contacts whose number, or national number, starts with the given digits
+     * @param prefix Digits, optionally with separators or a +country code
+     * @return Vector of matching contacts in ID order
+     * Time Complexity: O(n), over the packed digit column
+     */
+    std::vector<Contact> searchByPhonePrefix(const QString& prefix) const;
+
+    /**
+     * @brief Finds contacts whose timestamp lies in [from, to)
+     * @param field Which timestamp to look at
+     * @param from Inclusive lower bound
+     * @param to Exclusive upper bound
+     * @return Matching contacts, oldest first
+     * Time Complexity: O(log n + k) using the time index
+     */
+    std::vector<Contact> getContactsInTimeRange(TimeField field, const QDateTime& from,
+                                                const QDateTime& to) const;
+
+    /**
+     * @brief Gets the most recently created/modified contacts
+     * @param field Which timestamp to order by
+     * @param count Maximum number of contacts to return
+     * @return Contacts, newest first
+     * Time Complexity: O(log n + count) using the time index
+     */
+    std::vector<Contact> getMostRecent(TimeField field, size_t count) const;
+
+    /**
+     * @brief Runs a parsed multi-field query (see ContactQuery)
+     * @param query The parsed query
+     * @return Vector of matching contacts ordered by ID
+     * Time Complexity: O(k log n) when an index applies, O(n) otherwise
+     */
+    std::vector<Contact> search(const ContactQuery& query) const;
+
+    /**
+     * @brief Runs a query and orders the results, using the result cache
+     * Results are cached by (query, keys) as ID lists and reused until the
+     * next mutation, so toggling the sort order or repeating a search is
+     * O(k) instead of a fresh search and sort.
+     * @param query The parsed query; an empty query matches every contact
+     * @param keys Multi-column ordering, most significant first; ties are
+     *             broken by ascending ID
+     * @return Matching contacts in the requested order
+     */
+    std::vector<Contact> search(const ContactQuery& query, const SortKeys& keys) const;
+
+    std::vector<Contact> search(const ContactQuery& query, SortOrder order) const {
+        return search(query, sortKeysFor(order));
+    }
+
+    /**
+     * @brief Gets all contacts in the requested order, using the result cache
+     */
+    std::vector<Contact> getContactsSorted(const SortKeys& keys) const {
+        return search(ContactQuery(), keys);
+    }
+
+    std::vector<Contact> getContactsSorted(SortOrder order) const {
+        return search(ContactQuery(), sortKeysFor(order));
+    }
+
+    /**
+     * @brief Sort keys equivalent to one of the preset orders
+     */
+    static SortKeys sortKeysFor(SortOrder order);
+
+    /**
+     * @brief Limits the memory held by cached results
+     * @param bytes Approximate budget; least recently used entries are evicted
+     */
+    void setCacheBudget(size_t bytes);
+
+    /**
+     * @brief Gets hit/miss counters and current size of the result cache
+     */
+    CacheStats getCacheStats() const;
+
+    /**
+     * @brief Number of contacts in one facet group
+     */
+    struct FacetCount {
+        QString key;
+        int count;
+    };
+
+    /**
+     * @brief Group counts of one facet over all contacts
+     * Read from the maintained posting sets, no contact is visited.
+     * Contacts without a value for the facet are not counted.
+     * @param limit Largest groups to return, 0 for all
+     * @return Groups by descending count, then key
+     * Time Complexity: O(g log g) for g groups
+     */
+    std::vector<FacetCount> facetCounts(Facets::Kind kind, size_t limit = 0) const;
+
+    /**
+     * @brief Group counts of one facet over the contacts matching a query
+     * The query may itself contain facet terms, e.g. "domain=acme.com" to
+     * break one company's contacts down by city.
+     * Time Complexity: the query's cost plus O(k) for k matches
+     */
+    std::vector<FacetCount> facetCounts(Facets::Kind kind, const ContactQuery& query,
+                                        size_t limit = 0) const;
+
+    /**
+     * @brief Size of one facet group
+     * Time Complexity: O(1) average
+     */
+    int facetCount(Facets::Kind kind, const QString& key) const;
+
+    /**
+     * @brief A full-text search result with its relevance
+     */
+    struct TextHit {
+        Contact contact;
+        double score;       ///< BM25 score, higher is more relevant
+    };
+
+    /**
+     * @brief Ranked keyword search over notes and address
+     * @param text Free text; contacts matching any word are ranked by BM25
+     * @param limit Maximum number of results
+     * @return Best matches first
+     * Time Complexity: O(p log k) for p postings of the words, k = limit
+     */
+    std::vector<TextHit> searchText(const QString& text, size_t limit) const;
+
+    /**
+     * @brief Describes the plan the query planner chooses for a query
+     * @param query The parsed query
+     * @return Human readable plan, one step per line
+     */
+    QString explain(const ContactQuery& query) const;
+
     /**
      * @brief Gets all contacts sorted by name
      * @return Vector of all contacts in alphabetical order
@@ -104,27 +394,554 @@ public:
     int getContactCount() const { return contacts.size(); }
 
     /**
-     * @brief Saves all contacts to a JSON file
+     * @brief Gets the largest contact ID in use
+     * @return 0 if there are no contacts
+     * Time Complexity: O(1)
+     */
+    int getMaxId() const { return idToIndex.empty() ? 0 : idToIndex.rbegin()->first; }
+
+    /**
+     * @brief Saves all contacts to a file
+     * The file is written to a temporary and renamed over the old one, so a
+     * crash mid-save never leaves a half-written file behind.
+     * @param filename Path to the file
+     * @param format Storage format to write
+     * @return true if successful, false otherwise
+     */
+    bool saveToFile(const QString& filename, StorageFormat format = IndentedJson) const;
+
+    /**
+     * @brief Format a data file is saved in, chosen by its suffix
+     * ".json" files stay JSON so other tools can read them; anything else,
+     * such as the default ".cmz", gets checksummed CompressedBlocks.
+     */
+    static StorageFormat formatForFile(const QString& filename);
+
+    /**
+     * @brief Path of the address book file in a data directory
+     * Versions before CompressedBlocks saved it as contacts_data.json. If
+     * only that file exists it is renamed to contacts_data.cmz, together
+     * with its full-text index; loading reads either format.
+     */
+    static QString dataFileIn(const QString& directory);
+
+    /**
+     * @brief Callback reporting (contacts loaded, total contacts)
+     * May be invoked from whichever thread runs the load.
+     */
+    using LoadProgress = std::function<void(int loaded, int total)>;
+
+    /**
+     * @brief File the full-text index of a snapshot is kept in
+     */
+    static QString textIndexPath(const QString& snapshotFile) { return snapshotFile + ".fts"; }
+
+    /**
+     * @brief Saves the full-text index so the next load can skip rebuilding it
+     * @param filename Usually textIndexPath() of the snapshot just saved
+     * @return true if successful, false otherwise
+     */
+    bool saveTextIndex(const QString& filename) const;
+
+    /**
+     * @brief Loads contacts from a file in any StorageFormat
+     * Reuses the full-text index at textIndexPath(filename) if it was saved
+     * for the same snapshot, otherwise rebuilds it.
      * @param filename Path to the file
+     * @param progress Optional callback invoked periodically while loading
      * @return true if successful, false otherwise
      */
-    bool saveToFile(const QString& filename) const;
+    bool loadFromFile(const QString& filename, const LoadProgress& progress = LoadProgress());
+
+    /**
+     * @brief Checks a contacts file without loading it
+     * CompressedBlocks files are verified block by block against their
+     * checksums, without decompressing; JSON files are parsed.
+     * @param filename Path to the file
+     * @return What was found; isIntact() if the file would load
+     * Time Complexity: O(file size), checksums computed in parallel
+     */
+    static IntegrityReport verifyFile(const QString& filename);
+
+    /**
+     * @brief Writes the intact blocks of a damaged CompressedBlocks file to a new file
+     * Blocks that fail their checksum are dropped; blocks after damage are
+     * found again by their marker. Contacts in dropped blocks are lost.
+     * @param filename Path to the damaged file
+     * @param output Path for the repaired file
+     * @return The blocks kept; nothing is written, and error is set, if no
+     *         block could be salvaged or the output could not be written
+     * Time Complexity: O(file size)
+     */
+    static IntegrityReport repairFile(const QString& filename, const QString& output);
 
     /**
-     * @brief Loads contacts from a JSON file
+     * @brief Copies a data file that failed to load to <file>.damaged
+     * Every writer calls this before it may save over the file, so the
+     * intact blocks can still be recovered with repairFile().
+     * @return Path of the copy, empty if it could not be made
+     */
+    static QString keepDamagedFile(const QString& filename);
+
+    /**
+     * @brief Receives the contacts of one stored block; return false to stop
+     */
+    using BlockVisitor = std::function<bool(const QJsonArray& contacts)>;
+
+    /**
+     * @brief Streams the contacts of a saved file one block at a time
+     * CompressedBlocks files are memory-mapped; each block is checked,
+     * decompressed and parsed only when its turn comes, so a file larger
+     * than memory can be read. JSON files have no blocks and arrive as one.
      * @param filename Path to the file
+     * @param visit Called once per block, in file order
+     * @return false if the file cannot be read, a block is corrupt or the
+     *         visitor stopped; blocks before the failure were still visited
+     * Time Complexity: O(file size), one block resident at a time
+     */
+    static bool readFileBlocks(const QString& filename, const BlockVisitor& visit);
+
+    /**
+     * @brief Writes a name-sorted snapshot split into fixed-size pages
+     * Any single page can later be read without parsing the rest, which lets
+     * the UI show the first screen before the full store is loaded.
+     * @param filename Path to the page file
+     * @param pageSize Contacts per page
+     * @param pageCount Pages to write, -1 for all; the header still records
+     *        the total number of contacts
      * @return true if successful, false otherwise
+     * Time Complexity: O(n m) collation keys, O(n log k) to select k rows
      */
-    bool loadFromFile(const QString& filename);
+    bool savePageFile(const QString& filename, int pageSize, int pageCount = -1) const;
+
+    /**
+     * @brief Reads one page of a file written by savePageFile()
+     * The contacts keep their stored IDs; they are for display only.
+     * @param filename Path to the page file
+     * @param page Zero-based page number
+     * @param pageContacts Receives the contacts of the page in name order
+     * @param totalCount Receives the number of contacts in the whole file
+     * @return false if the file is missing, damaged or has no such page
+     * Time Complexity: O(pageSize), independent of the file size
+     */
+    static bool readPage(const QString& filename, int page,
+                         std::vector<Contact>& pageContacts, int& totalCount);
 
     /**
      * @brief Clears all contacts from memory
+     * Changes made before the clear can no longer be exported as a delta.
      */
     void clear();
 
+    /**
+     * @brief Gets the sequence number of the most recent mutation
+     * The sequence only ever increases, so a peer can remember it and later
+     * ask for everything that changed after it.
+     */
+    quint64 getChangeSequence() const { return changeSequence; }
+
+    /**
+     * @brief Checks whether a delta since a sequence can be produced
+     * Deletes from before the last load/clear are not known, so older peers
+     * need a full export instead.
+     */
+    bool canExportChangesSince(quint64 sequence) const { return sequence >= deltaFloor; }
+
+    /**
+     * @brief Writes every change made after a sequence number to a delta file
+     * @param sequence Last sequence the receiver has seen
+     * @param filename Path to the delta file
+     * @return false if the delta is unavailable or the file cannot be written
+     * Time Complexity: O(k log n) for k changes since the sequence
+     */
+    bool exportChangesSince(quint64 sequence, const QString& filename) const;
+
+    /**
+     * @brief Outcome of applyChanges()
+     */
+    struct DeltaResult {
+        bool valid = false;         ///< The file was a delta and was applied
+        int upserts = 0;            ///< Contacts added or replaced
+        int deletes = 0;            ///< Contacts removed
+        int phoneConflicts = 0;     ///< Upserts skipped because another contact has the phone
+    };
+
+    /**
+     * @brief Applies a delta file written by exportChangesSince()
+     * Contacts are matched by ID and created date. An upsert whose ID is
+     * taken here by a different contact is added under a fresh ID. Phone
+     * numbers stay unique: an upsert whose phone belongs to another local
+     * contact is skipped and counted.
+     * @param filename Path to the delta file
+     * Time Complexity: O(k log n) for k changes in the delta
+     */
+    DeltaResult applyChanges(const QString& filename);
+
+    /**
+     * @brief Forgets deletes up to a sequence every peer has already seen
+     * Removed contacts are remembered so a delta can name them; without
+     * compaction that log grows with every delete ever made. Deltas from
+     * before the sequence are no longer available afterwards.
+     * @param sequence Oldest sequence any peer still needs a delta from
+     * Time Complexity: O(k log n) for k dropped deletes
+     */
+    void compactChangeLog(quint64 sequence);
+
+    /**
+     * @brief Starts grouping mutations into one undo step
+     * Groups nest; only the outermost label is kept. Every begin must be
+     * matched by endUndoGroup().
+     * @param label Shown to the user, e.g. "Import contacts.json"
+     */
+    void beginUndoGroup(const QString& label);
+
+    /**
+     * @brief Closes the current group; empty groups are dropped
+     */
+    void endUndoGroup();
+
+    bool canUndo() const { return !undoStack.empty(); }
+    bool canRedo() const { return !redoStack.empty(); }
+    QString undoLabel() const { return undoStack.empty() ? QString() : undoStack.back().label; }
+    QString redoLabel() const { return redoStack.empty() ? QString() : redoStack.back().label; }
+
+    /**
+     * @brief Reverts the most recent group of mutations
+     * Runs of removals are applied with removeContacts(), so undoing a bulk
+     * import is one pass over the storage rather than a file reload.
+     * @return false if there is nothing to undo
+     * Time Complexity: O(n + k log n) for a group of k mutations
+     */
+    bool undo();
+
+    /**
+     * @brief Re-applies the most recently undone group
+     * @return false if there is nothing to redo
+     */
+    bool redo();
+
+    /**
+     * @brief Limits the memory held by the undo history
+     * The oldest groups are dropped first; the newest is always kept.
+     */
+    void setUndoBudget(size_t bytes);
+
+    void clearUndoHistory();
+
 private:
+    friend class QueryPlanner;
+    friend class ContactImporter;
+
     std::vector<Contact> contacts;        ///< Main storage using dynamic array
     std::map<int, size_t> idToIndex;     ///< Maps ID to vector index for O(log n) lookup
+    std::multimap<QString, int> phoneIndex;  ///< Phone number -> ID (sorted, allows prefix ranges)
+    PhoneDigitIndex phoneDigitIndex;      ///< Packed digits of every phone, for separator-blind search
+    std::multimap<QString, int> nameIndex;   ///< Lower-cased name -> ID (sorted, allows prefix ranges)
+    std::map<QString, std::set<int>> trigramIndex; ///< Name trigram -> IDs for substring search
+    std::unordered_map<QString, std::set<int>> phoneticIndex; ///< Soundex code of a name word -> IDs
+    std::unordered_map<QString, std::set<int>> facetIndex[Facets::kKindCount]; ///< Facet key -> IDs, per facet
+    TextIndex textIndex;                  ///< Words of notes and address -> IDs, ranked
+    bool deferTextIndex = false;          ///< Set while loadFromFile() fills textIndex itself
+    std::set<std::pair<qint64, int>> createdIndex;  ///< (created msecs, ID) in time order
+    std::set<std::pair<qint64, int>> modifiedIndex; ///< (modified msecs, ID) in time order
+
+    const std::set<std::pair<qint64, int>>& timeIndex(TimeField field) const {
+        return field == CreatedTime ? createdIndex : modifiedIndex;
+    }
+
+    /**
+     * @brief One cached result: matching IDs in the requested order
+     */
+    struct CachedResult {
+        QString key;
+        std::vector<int> ids;
+        size_t bytes;
+    };
+
+    mutable std::mutex cacheMutex;                ///< Lets const searches share the cache
+    mutable std::list<CachedResult> resultCache;  ///< Most recently used first
+    mutable std::map<QString, std::list<CachedResult>::iterator> resultCacheIndex;
+    mutable quint64 cacheGeneration = 0;          ///< changeSequence the entries belong to
+    mutable CacheStats cacheStats;
+    size_t cacheBudget = 4 * 1024 * 1024;
+
+    /**
+     * @brief Computes the ordered IDs for a query without the cache
+     * Ties are broken by ascending ID, as ContactSorter does.
+     * Time Complexity: O(k log k) for k matches, O(n) for the unfiltered
+     * newest-first ordering which comes straight from the time index
+     */
+    std::vector<int> sortedIds(const ContactQuery& query, const SortKeys& keys) const;
+
+    /**
+     * @brief Evicts least recently used entries until within budget
+     * Must be called with cacheMutex held.
+     */
+    void trimCache() const;
+
+    /**
+     * @brief Drops every cached result, counting them as invalidations
+     * Must be called with cacheMutex held.
+     */
+    void dropCachedResults() const;
+
+    /**
+     * @brief Compact inverse of one mutation
+     * Holds a single Contact whose strings are shared with the store
+     * (Qt implicit sharing), not a copy of the store. For Added and
+     * Removed it is the contact that exists on one side of the change; for
+     * Updated it is the other version, swapped with the live one on every
+     * undo or redo.
+     */
+    struct UndoStep {
+        enum Kind { Added, Removed, Updated };
+        Kind kind;
+        Contact contact;
+    };
+
+    struct UndoGroup {
+        QString label;
+        std::vector<UndoStep> steps;
+        size_t bytes = 0;       ///< Approximate memory held by the steps
+    };
+
+    std::deque<UndoGroup> undoStack;      ///< Newest group at the back
+    std::deque<UndoGroup> redoStack;
+    UndoGroup openGroup;                  ///< Collects steps between begin/endUndoGroup()
+    int undoGroupDepth = 0;
+    int undoSuspended = 0;                ///< > 0 while loading or replaying history
+    size_t undoBytes = 0;                 ///< Sum of undoStack bytes
+    size_t undoBudget = 64 * 1024 * 1024;
+
+    /**
+     * @brief Records the inverse of a mutation unless history is suspended
+     * Any new mutation discards the redo history.
+     */
+    void recordUndo(UndoStep::Kind kind, const Contact& contact);
+
+    /**
+     * @brief Pushes a finished group and drops old groups over budget
+     */
+    void pushUndoGroup(UndoGroup&& group);
+
+    /**
+     * @brief Applies a group's inverse (undo) or the group itself (redo)
+     */
+    void replayGroup(UndoGroup& group, bool undoing);
+
+    /**
+     * @brief Secondary indexes grouped by the fields they are built from
+     */
+    enum IndexSet : unsigned {
+        PhoneIndexes = 1 << 0,      ///< Phone and digit indexes, country facet
+        NameIndexes = 1 << 1,       ///< Name, trigram and phonetic indexes
+        EmailIndexes = 1 << 2,      ///< Domain facet
+        AddressIndexes = 1 << 3,    ///< City facet
+        TextIndexes = 1 << 4,       ///< Full-text index of notes and address
+        CreatedIndexes = 1 << 5,
+        ModifiedIndexes = 1 << 6,
+        AllIndexes = (1 << 7) - 1
+    };
+
+    /**
+     * @brief Indexes that depend on the field a descriptor changes
+     */
+    template <typename Descriptor>
+    static constexpr unsigned indexesOf() {
+        using namespace ContactFields;
+        return std::is_same<Descriptor, Name>::value     ? NameIndexes
+             : std::is_same<Descriptor, Phone>::value    ? PhoneIndexes
+             : std::is_same<Descriptor, Email>::value    ? EmailIndexes
+             : std::is_same<Descriptor, Address>::value  ? AddressIndexes | TextIndexes
+             : std::is_same<Descriptor, Notes>::value    ? TextIndexes
+             : std::is_same<Descriptor, Created>::value  ? CreatedIndexes
+             : std::is_same<Descriptor, Modified>::value ? ModifiedIndexes
+             : AllIndexes;
+    }
+
+    /**
+     * @brief Records undo for a field update and unindexes the contact
+     * @param indexes IndexSet bits of the indexes the update can change
+     * @return The live contact, or nullptr if the ID is unknown
+     */
+    Contact* beginFieldUpdate(int id, unsigned indexes);
+
+    /**
+     * @brief Re-indexes a contact after updateField() changed it
+     */
+    void endFieldUpdate(Contact& contact, unsigned indexes);
+
+    quint64 changeSequence = 0;           ///< Bumped on every mutation, never reset
+    quint64 deltaFloor = 0;               ///< Oldest sequence a delta can start from
+    std::map<int, quint64> changeOfId;    ///< ID -> sequence of its last add/update
+    std::map<quint64, int> changeLog;     ///< Sequence -> ID of live contacts in change order
+
+    /**
+     * @brief A removed contact, as a delta names it
+     * IDs are process-local, so the created date and phone tell the receiver
+     * whether its contact with that ID is the one that was removed.
+     */
+    struct Tombstone {
+        int id;
+        qint64 created;
+        QString phone;
+    };
+
+    std::map<quint64, Tombstone> tombstones;  ///< Sequence -> removed contact
+
+    /**
+     * @brief Stamps a contact with a new change sequence
+     * @param id The added or updated contact
+     * @param sequence Sequence to restore from a file, or 0 for a new one
+     * Time Complexity: O(log n)
+     */
+    void recordChange(int id, quint64 sequence = 0);
+
+    /**
+     * @brief Moves a contact from the change log to the tombstone log
+     * Time Complexity: O(log n)
+     */
+    void recordRemoval(const Contact& contact);
+
+    /**
+     * @brief Finds the local contact a delta entry refers to
+     * A contact with the sender's ID is the same one only if its created
+     * date matches; otherwise a copy re-IDed by an earlier applyChanges()
+     * is looked up by phone and created date. Entries without a created
+     * date match by ID alone.
+     * @return Local ID, or 0 if this store has no such contact
+     * Time Complexity: O(log n)
+     */
+    int findDeltaContact(int id, qint64 created, const QString& phone) const;
+
+    /**
+     * @brief Serializes contacts [first, last) including their change sequence
+     */
+    QJsonArray toJsonArray(size_t first, size_t last) const;
+
+    /**
+     * @brief Encodes all contacts as independently compressed blocks
+     * Blocks are compressed in parallel on the global thread pool.
+     */
+    QByteArray encodeBlocks() const;
+
+    /**
+     * @brief Location of one block inside a CompressedBlocks file
+     */
+    struct StoredBlock {
+        qsizetype start = 0;    ///< Offset of the block header
+        qsizetype payload = 0;  ///< Offset of the compressed data
+        quint32 count = 0;
+        quint32 size = 0;
+        quint32 checksum = 0;
+        bool checked = false;   ///< false for version 1 blocks, which have no checksum
+    };
+
+    /**
+     * @brief Builds the file header announcing blockCount blocks
+     */
+    static QByteArray blockFileHeader(quint32 blockCount);
+
+    /**
+     * @brief Builds one checksummed block around a compressed payload
+     */
+    static QByteArray encodeBlock(const QByteArray& payload, quint32 count);
+
+    /**
+     * @brief Checks for the CompressedBlocks magic bytes
+     */
+    static bool isCompressedBlocks(const QByteArray& data);
+
+    /**
+     * @brief Walks the block headers of a version 1 or 2 file in order
+     * @return false if the header is invalid or the data is truncated
+     */
+    static bool scanBlocks(const QByteArray& data, QList<StoredBlock>& blocks);
+
+    /**
+     * @brief Recomputes a block's CRC-32C and compares it with the stored one
+     */
+    static bool checksumMatches(const QByteArray& data, const StoredBlock& block);
+
+    /**
+     * @brief Finds every intact block, resynchronizing on markers after damage
+     * Fills the header fields of report and sets its error if anything is lost.
+     */
+    static QList<StoredBlock> salvageBlocks(const QByteArray& data, IntegrityReport& report);
+
+    /**
+     * @brief Replaces a file atomically through QSaveFile
+     */
+    static bool writeFileAtomically(const QString& filename, const QByteArray& data);
+
+    /**
+     * @brief Splits a CompressedBlocks file into its still-compressed blocks
+     * Checksums of version 2 files are verified in parallel.
+     * @param data The whole file
+     * @param compressed Receives the zlib payload of each block
+     * @param counts Receives the number of contacts in each block
+     * @return false if the header is invalid, the data is truncated or a
+     *         checksum does not match
+     */
+    static bool readBlocks(const QByteArray& data, QList<QByteArray>& compressed,
+                           QList<quint32>& counts);
+
+    /**
+     * @brief Decodes a CompressedBlocks file into one JSON array per block
+     * Blocks are decompressed and parsed in parallel.
+     * @return false if the data is truncated or a block is corrupt
+     */
+    static bool decodeBlocks(const QByteArray& data, QList<QJsonArray>& blocks);
+
+    /**
+     * @brief Replaces the current contacts with the parsed JSON arrays
+     */
+    void loadFromJsonArrays(const QList<QJsonArray>& arrays, const LoadProgress& progress);
+
+    /**
+     * @brief Serializes a contact to the JSON object used by files and deltas
+     */
+    static QJsonObject contactToJson(const Contact& contact);
+
+    /**
+     * @brief Builds a contact from a JSON object, keeping stored timestamps
+     * The ID is not applied; callers decide whether it can be reused.
+     */
+    static Contact contactFromJson(const QJsonObject& obj);
+
+    /**
+     * @brief Text of a contact covered by the full-text index
+     */
+    static QString documentText(const Contact& contact) {
+        return contact.getNotes() + '\n' + contact.getAddress();
+    }
+
+    /**
+     * @brief Identifies the saved state of the contacts
+     * The latest change sequence of any contact. Any add or update changes
+     * it; removals are caught by checking the index's IDs still exist.
+     */
+    quint64 snapshotVersion() const;
+
+    /**
+     * @brief Adds a contact to the secondary indexes
+     * @param indexes IndexSet bits of the indexes to update
+     * Time Complexity: O(m log n) where m is the name length
+     */
+    void indexContact(const Contact& contact, unsigned indexes = AllIndexes);
+
+    /**
+     * @brief Removes a contact from the secondary indexes
+     * @param indexes IndexSet bits of the indexes to update; batches leave out
+     *        TextIndexes and call TextIndex::removeDocuments() once instead
+     * Time Complexity: O(m log n) where m is the name length
+     */
+    void unindexContact(const Contact& contact, unsigned indexes = AllIndexes);
+
+    /**
+     * @brief IndexSet bit of the field a facet is computed from
+     */
+    static unsigned facetIndexes(Facets::Kind kind);
 
     /**
      * @brief Rebuilds the ID-to-index mapping
@@ -0,0 +1,61 @@
+/**
+ * @file contactprotocol.cpp
+ * @brief Framing and contact encoding for the binary protocol
+ */
+
+#include "contactprotocol.h"
+#include <QtEndian>
+
+namespace ContactProtocol {
+
+void writeContact(QDataStream& out, const Contact& contact) {
+    out << static_cast<qint32>(contact.getId())
+        << contact.getName() << contact.getPhone() << contact.getEmail()
+        << contact.getAddress() << contact.getNotes()
+        << contact.getCreated() << contact.getModified();
+}
+
+bool readContact(QDataStream& in, Contact& contact, int& storedId) {
+    qint32 id;
+    QString name, phone, email, address, notes;
+    qint64 created, modified;
+    in >> id >> name >> phone >> email >> address >> notes >> created >> modified;
+    if (in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    contact = Contact(name, phone, email, address, notes);
+    storedId = id;
+    contact.setCreated(created);
+    contact.setModified(modified);
+    return true;
+}
+
+QByteArray frame(const QByteArray& payload) {
+    QByteArray data(sizeof(quint32), Qt::Uninitialized);
+    qToBigEndian(static_cast<quint32>(payload.size()), data.data());
+    data.append(payload);
+    return data;
+}
+
+bool takeFrame(QByteArray& buffer, QByteArray& payload, bool& error) {
+    error = false;
+    if (buffer.size() < static_cast<qsizetype>(sizeof(quint32))) {
+        return false;
+    }
+
+    const quint32 length = qFromBigEndian<quint32>(buffer.constData());
+    if (length > kMaxFrameSize) {
+        error = true;
+        return false;
+    }
+    if (buffer.size() < static_cast<qsizetype>(sizeof(quint32) + length)) {
+        return false;
+    }
+
+    payload = buffer.mid(sizeof(quint32), length);
+    buffer.remove(0, sizeof(quint32) + length);
+    return true;
+}
+
+} // namespace ContactProtocol
@@ -0,0 +1,98 @@
+/**
+ * @file contactprotocol.h
+ * @brief Binary protocol spoken by ContactServer and ContactClient
+ *
+ * Every message is a frame: a quint32 payload length followed by the
+ * payload, all big-endian as written by QDataStream.
+ *
+ *     request:  request id (quint32) | opcode (quint8)  | arguments
+ *     response: request id (quint32) | status (quint8)  | result
+ *
+ * Clients may pipeline: send many requests without waiting. Responses on
+ * one connection come back in request order and carry the request id.
+ *
+ * Arguments and results per opcode:
+ *     Ping           -                      -
+ *     Count          -                      quint32 count
+ *     GetContact     qint32 id              contact
+ *     Search         QString query, limit   quint32 total, quint32 n, n x contact
+ *     SearchText     QString text, limit    quint32 n, n x (contact, double score)
+ *     AddContact     contact                qint32 new id
+ *     UpdateContact  qint32 id, contact     -
+ *     RemoveContact  qint32 id              -
+ *     FacetCounts    quint8 facet,          quint32 n, n x (QString key, quint32 count)
+ *                    QString query, limit
+ *     MaxId          -                      qint32 largest ID, 0 if empty
+ *
+ * Search uses the query language of ContactQuery and returns contacts by
+ * name. FacetCounts groups the contacts matching query (all contacts if
+ * empty) by a Facets::Kind, largest groups first. Failed requests (status other than Ok) carry a QString message.
+ */
+
+#ifndef CONTACTPROTOCOL_H
+#define CONTACTPROTOCOL_H
+
+#include "contact.h"
+#include <QByteArray>
+#include <QDataStream>
+#include <QString>
+
+namespace ContactProtocol {
+
+/// QLocalServer name used when none is given
+const char* const kDefaultServerName = "contact-manager";
+
+/// Larger frames are treated as a protocol error
+const quint32 kMaxFrameSize = 16 * 1024 * 1024;
+
+enum Opcode : quint8 {
+    Ping = 1,
+    Count,
+    GetContact,
+    Search,
+    SearchText,
+    AddContact,
+    UpdateContact,
+    RemoveContact,
+    FacetCounts,
+    MaxId
+};
+
+enum Status : quint8 {
+    Ok = 0,
+    NotFound,
+    BadRequest,
+    Rejected        ///< Valid request the store refused, e.g. a duplicate phone
+};
+
+/**
+ * @brief Writes a contact: id, the five text fields and both timestamps
+ */
+void writeContact(QDataStream& out, const Contact& contact);
+
+/**
+ * @brief Reads a contact written by writeContact()
+ * @param contact Receives the fields; it gets a fresh ID like any new
+ *                contact, callers that want the sender's ID apply storedId
+ * @param storedId Receives the ID from the stream
+ * @return false if the stream ran out of data
+ */
+bool readContact(QDataStream& in, Contact& contact, int& storedId);
+
+/**
+ * @brief Prefixes a payload with its length
+ */
+QByteArray frame(const QByteArray& payload);
+
+/**
+ * @brief Removes one complete frame from the front of a receive buffer
+ * @param buffer Bytes received so far
+ * @param payload Receives the frame's payload
+ * @param error Set if the buffer starts with an oversized frame
+ * @return true if a frame was extracted
+ */
+bool takeFrame(QByteArray& buffer, QByteArray& payload, bool& error);
+
+} // namespace ContactProtocol
+
+#endif // CONTACTPROTOCOL_H
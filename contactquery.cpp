@@ -0,0 +1,899 @@
+/**
+ * @file contactquery.cpp
+ * @brief Implementation of the query parser, planner and executor
+ */
+
+#include "contactquery.h"
+#include "contactfields.h"
+#include "contactmanager.h"
+#include "facets.h"
+#include "phonedigitindex.h"
+#include "phonetic.h"
+#include <QDate>
+#include <QStringList>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <set>
+
+namespace {
+
+// Relative cost of checking one candidate row against a residual predicate
+// compared to reading one entry from an index.
+const size_t kRowCheckCost = 4;
+
+// An index that returns more than 1/kIndexRowCost of the table is slower
+// than a sequential scan because every hit needs an extra ID lookup.
+const size_t kIndexRowCost = 2;
+
+bool fieldFromName(const QString& name, QueryPredicate::Field& field) {
+    static const std::map<QString, QueryPredicate::Field> fields = {
+        {"id", QueryPredicate::IdField},
+        {"name", QueryPredicate::NameField},
+        {"phone", QueryPredicate::PhoneField},
+        {"email", QueryPredicate::EmailField},
+        {"address", QueryPredicate::AddressField},
+        {"notes", QueryPredicate::NotesField},
+        {"created", QueryPredicate::CreatedField},
+        {"modified", QueryPredicate::ModifiedField},
+        {"domain", QueryPredicate::DomainField},
+        {"country", QueryPredicate::CountryField},
+        {"city", QueryPredicate::CityField}
+    };
+
+    auto it = fields.find(name);
+    if (it == fields.end()) {
+        return false;
+    }
+    field = it->second;
+    return true;
+}
+
+QStringList tokenize(const QString& text, bool& unbalancedQuotes) {
+    QStringList tokens;
+    QString current;
+    bool inQuotes = false;
+
+    for (const QChar ch : text) {
+        if (ch == '"') {
+            inQuotes = !inQuotes;
+        } else if (ch.isSpace() && !inQuotes) {
+            if (!current.isEmpty()) {
+                tokens.append(current);
+                current.clear();
+            }
+        } else {
+            current.append(ch);
+        }
+    }
+
+    if (!current.isEmpty()) {
+        tokens.append(current);
+    }
+    unbalancedQuotes = inQuotes;
+    return tokens;
+}
+
+// Facet behind a facet field
+Facets::Kind facetOf(QueryPredicate::Field field) {
+    switch (field) {
+    case QueryPredicate::DomainField:  return Facets::EmailDomain;
+    case QueryPredicate::CountryField: return Facets::CountryCode;
+    default:                           return Facets::City;
+    }
+}
+
+bool isFacetField(QueryPredicate::Field field) {
+    return field == QueryPredicate::DomainField || field == QueryPredicate::CountryField ||
+           field == QueryPredicate::CityField;
+}
+
+QString textOf(const Contact& contact, QueryPredicate::Field field) {
+    if (isFacetField(field)) {
+        return Facets::key(facetOf(field), contact);
+    }
+
+    switch (field) {
+    case QueryPredicate::NameField:    return ContactFields::Name::indexKey(contact);
+    case QueryPredicate::PhoneField:   return contact.getPhone().toLower();
+    case QueryPredicate::EmailField:   return ContactFields::Email::indexKey(contact);
+    case QueryPredicate::AddressField: return ContactFields::Address::indexKey(contact);
+    case QueryPredicate::NotesField:   return ContactFields::Notes::indexKey(contact);
+    default:                           return QString();
+    }
+}
+
+template <typename T>
+bool compare(const T& lhs, QueryPredicate::Operator op, const T& rhs) {
+    switch (op) {
+    case QueryPredicate::Less:           return lhs < rhs;
+    case QueryPredicate::LessOrEqual:    return lhs <= rhs;
+    case QueryPredicate::Greater:        return lhs > rhs;
+    case QueryPredicate::GreaterOrEqual: return lhs >= rhs;
+    default:                             return lhs == rhs;
+    }
+}
+
+bool matchText(const QString& text, QueryPredicate::Operator op, const QString& value) {
+    switch (op) {
+    case QueryPredicate::Contains: return text.contains(value);
+    case QueryPredicate::Prefix:   return text.startsWith(value);
+    default:                       return compare(text, op, value);
+    }
+}
+
+// Digit mode of a phone or bare term that reads as a number; false if the
+// term only matches as text
+bool digitMode(const QueryPredicate& predicate, PhoneDigits::Match& mode) {
+    if (predicate.op == QueryPredicate::Contains) {
+        mode = PhoneDigits::Substring;
+    } else if (predicate.op == QueryPredicate::Prefix) {
+        mode = PhoneDigits::Prefix;
+    } else {
+        return false;
+    }
+    return PhoneDigits::isPhoneQuery(predicate.value);
+}
+
+// Text match, or for number-like terms a match by digits alone, so
+// "98765" finds "+91 98765-43210"
+bool matchPhone(const QString& phone, const QueryPredicate& predicate) {
+    PhoneDigits::Match mode;
+    return matchText(phone.toLower(), predicate.op, predicate.value) ||
+           (digitMode(predicate, mode) && PhoneDigitIndex::matches(phone, predicate.value, mode));
+}
+
+const char* accessName(QueryPlanStep::Access access) {
+    switch (access) {
+    case QueryPlanStep::IdLookup:    return "id index lookup";
+    case QueryPlanStep::IdRange:     return "id index range";
+    case QueryPlanStep::PhoneLookup: return "phone index lookup";
+    case QueryPlanStep::PhonePrefix: return "phone index prefix";
+    case QueryPlanStep::NameLookup:  return "name index lookup";
+    case QueryPlanStep::NamePrefix:  return "name index prefix";
+    case QueryPlanStep::NameTrigram: return "name trigram index";
+    case QueryPlanStep::NamePhonetic: return "name phonetic index";
+    case QueryPlanStep::CreatedRange:  return "created time index range";
+    case QueryPlanStep::ModifiedRange: return "modified time index range";
+    case QueryPlanStep::FacetLookup:   return "facet index lookup";
+    case QueryPlanStep::PhoneDigitScan: return "phone digit index";
+    }
+    return "";
+}
+
+std::vector<int> collectPrefix(const std::multimap<QString, int>& index, const QString& prefix) {
+    std::vector<int> ids;
+    for (auto it = index.lower_bound(prefix);
+         it != index.end() && it->first.startsWith(prefix); ++it) {
+        ids.push_back(it->second);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+size_t countPrefix(const std::multimap<QString, int>& index, const QString& prefix) {
+    size_t count = 0;
+    for (auto it = index.lower_bound(prefix);
+         it != index.end() && it->first.startsWith(prefix); ++it) {
+        ++count;
+    }
+    return count;
+}
+
+std::vector<int> collectEqual(const std::multimap<QString, int>& index, const QString& key) {
+    std::vector<int> ids;
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        ids.push_back(it->second);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+using TimeIndex = std::set<std::pair<qint64, int>>;
+
+// Entries of a (msecs, ID) time index selected by a range predicate
+std::pair<TimeIndex::const_iterator, TimeIndex::const_iterator>
+timeRange(const TimeIndex& index, const QueryPredicate& predicate) {
+    const int minId = std::numeric_limits<int>::min();
+    const int maxId = std::numeric_limits<int>::max();
+    const qint64 t = predicate.number;
+
+    switch (predicate.op) {
+    case QueryPredicate::Less:
+        return {index.begin(), index.lower_bound({t, minId})};
+    case QueryPredicate::LessOrEqual:
+        return {index.begin(), index.upper_bound({t, maxId})};
+    case QueryPredicate::Greater:
+        return {index.upper_bound({t, maxId}), index.end()};
+    default:
+        return {index.lower_bound({t, minId}), index.end()};
+    }
+}
+
+// Counts entries in [first, last), stopping early once limit is reached
+template <typename Iterator>
+size_t countUpTo(Iterator first, Iterator last, size_t limit) {
+    size_t count = 0;
+    for (; first != last && count < limit; ++first) {
+        ++count;
+    }
+    return count;
+}
+
+// Inclusive ID bounds selected by a range predicate
+void idBounds(const QueryPredicate& predicate, qint64& low, qint64& high) {
+    low = std::numeric_limits<int>::min();
+    high = std::numeric_limits<int>::max();
+
+    switch (predicate.op) {
+    case QueryPredicate::Less:           high = predicate.number - 1; break;
+    case QueryPredicate::LessOrEqual:    high = predicate.number; break;
+    case QueryPredicate::Greater:        low = predicate.number + 1; break;
+    case QueryPredicate::GreaterOrEqual: low = predicate.number; break;
+    default:                             low = high = predicate.number; break;
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// QueryPredicate
+// ---------------------------------------------------------------------------
+
+bool QueryPredicate::matches(const Contact& contact) const {
+    bool result = false;
+
+    switch (field) {
+    case AnyField:
+        result = matchText(contact.getName().toLower(), op, value) ||
+                 matchPhone(contact.getPhone(), *this);
+        break;
+    case IdField:
+        result = compare<qint64>(contact.getId(), op, number);
+        break;
+    case CreatedField:
+        result = compare<qint64>(ContactFields::Created::indexKey(contact), op, number);
+        break;
+    case ModifiedField:
+        result = compare<qint64>(ContactFields::Modified::indexKey(contact), op, number);
+        break;
+    default:
+        if (op == SoundsLike) {
+            const QStringList nameKeys = Phonetic::nameKeys(contact.getName());
+            result = std::all_of(phoneticKeys.begin(), phoneticKeys.end(),
+                                 [&nameKeys](const QString& key) { return nameKeys.contains(key); });
+        } else if (field == PhoneField) {
+            result = matchPhone(contact.getPhone(), *this);
+        } else {
+            result = matchText(textOf(contact, field), op, value);
+        }
+        break;
+    }
+
+    return negated ? !result : result;
+}
+
+QString QueryPredicate::toString() const {
+    static const char* symbols[] = {":", ":", "=", "~", "<", "<=", ">", ">="};
+
+    QString text = negated ? "-" : "";
+    if (field != AnyField) {
+        text += fieldName(field) + symbols[op];
+    }
+    // Values with spaces are quoted so they read back as one term. The result
+    // cache keys on this text: name:"john smith" must differ from name:john smith
+    if (std::any_of(value.begin(), value.end(), [](QChar ch) { return ch.isSpace(); })) {
+        text += '"' + value + '"';
+    } else {
+        text += value;
+    }
+    if (op == Prefix) {
+        text += "*";
+    }
+    return text;
+}
+
+QString QueryPredicate::fieldName(Field field) {
+    switch (field) {
+    case IdField:       return "id";
+    case NameField:     return "name";
+    case PhoneField:    return "phone";
+    case EmailField:    return "email";
+    case AddressField:  return "address";
+    case NotesField:    return "notes";
+    case CreatedField:  return "created";
+    case ModifiedField: return "modified";
+    case DomainField:   return "domain";
+    case CountryField:  return "country";
+    case CityField:     return "city";
+    default:            return "any";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// ContactQuery
+// ---------------------------------------------------------------------------
+
+ContactQuery ContactQuery::parse(const QString& text, bool soundsLike) {
+    ContactQuery query;
+    bool unbalancedQuotes = false;
+    const QStringList tokens = tokenize(text, unbalancedQuotes);
+
+    if (unbalancedQuotes) {
+        query.errorMessage = "Unbalanced quotes in query";
+        return query;
+    }
+
+    for (const QString& token : tokens) {
+        QueryPredicate predicate;
+        QString term = token;
+
+        if (term.size() > 1 && term.startsWith('-')) {
+            predicate.negated = true;
+            term = term.mid(1);
+        }
+
+        // Locate the operator of a "field<op>value" term
+        int opPos = -1;
+        for (int i = 0; i < term.size(); ++i) {
+            const QChar ch = term[i];
+            if (ch == ':' || ch == '=' || ch == '~' || ch == '<' || ch == '>') {
+                opPos = i;
+                break;
+            }
+        }
+
+        QString value = term;
+        if (opPos > 0 && fieldFromName(term.left(opPos).toLower(), predicate.field)) {
+            const QChar opChar = term[opPos];
+            const bool orEqual = opPos + 1 < term.size() && term[opPos + 1] == '=';
+            int opLength = 1;
+
+            if (opChar == ':') {
+                predicate.op = QueryPredicate::Contains;
+            } else if (opChar == '=') {
+                predicate.op = QueryPredicate::Equals;
+            } else if (opChar == '~') {
+                predicate.op = QueryPredicate::SoundsLike;
+            } else if (opChar == '<') {
+                predicate.op = orEqual ? QueryPredicate::LessOrEqual : QueryPredicate::Less;
+                opLength = orEqual ? 2 : 1;
+            } else {
+                predicate.op = orEqual ? QueryPredicate::GreaterOrEqual : QueryPredicate::Greater;
+                opLength = orEqual ? 2 : 1;
+            }
+            value = term.mid(opPos + opLength);
+        }
+
+        if (predicate.op == QueryPredicate::Contains && value.endsWith('*')) {
+            predicate.op = QueryPredicate::Prefix;
+            value.chop(1);
+        } else if (soundsLike && predicate.field == QueryPredicate::AnyField) {
+            predicate.field = QueryPredicate::NameField;
+            predicate.op = QueryPredicate::SoundsLike;
+        }
+
+        if (value.isEmpty()) {
+            query.errorMessage = QString("Missing value in \"%1\"").arg(token);
+            return query;
+        }
+
+        const bool isRange = predicate.op >= QueryPredicate::Less;
+        predicate.value = value.toLower();
+
+        if (predicate.op == QueryPredicate::SoundsLike) {
+            if (predicate.field != QueryPredicate::NameField) {
+                query.errorMessage = QString("Sound-alike search is only supported for name (\"%1\")").arg(token);
+                return query;
+            }
+            predicate.phoneticKeys = Phonetic::nameKeys(value);
+            if (predicate.phoneticKeys.isEmpty()) {
+                query.errorMessage = QString("Sound-alike search needs letters in \"%1\"").arg(token);
+                return query;
+            }
+        }
+
+        switch (predicate.field) {
+        case QueryPredicate::IdField: {
+            bool ok = false;
+            predicate.number = value.toLongLong(&ok);
+            if (!ok || predicate.op == QueryPredicate::Prefix) {
+                query.errorMessage = QString("Invalid ID in \"%1\"").arg(token);
+                return query;
+            }
+            if (predicate.op == QueryPredicate::Contains) {
+                predicate.op = QueryPredicate::Equals;
+            }
+            break;
+        }
+
+        case QueryPredicate::CreatedField:
+        case QueryPredicate::ModifiedField: {
+            if (!isRange) {
+                query.errorMessage = QString("Use <, <=, > or >= to compare dates in \"%1\"").arg(token);
+                return query;
+            }
+            QDateTime date = QDateTime::fromString(value, Qt::ISODate);
+            if (!date.isValid()) {
+                const QDate day = QDate::fromString(value, Qt::ISODate);
+                if (day.isValid()) {
+                    date = day.startOfDay();
+                }
+            }
+            if (!date.isValid()) {
+                query.errorMessage = QString("Invalid date in \"%1\" (expected YYYY-MM-DD)").arg(token);
+                return query;
+            }
+            predicate.number = date.toMSecsSinceEpoch();
+            break;
+        }
+
+        case QueryPredicate::DomainField:
+        case QueryPredicate::CountryField:
+        case QueryPredicate::CityField:
+            if (isRange) {
+                query.errorMessage = QString("Use : or = to match a group in \"%1\"").arg(token);
+                return query;
+            }
+            // A facet term names a whole group, like an exact match
+            if (predicate.op == QueryPredicate::Contains) {
+                predicate.op = QueryPredicate::Equals;
+            }
+            if (predicate.field == QueryPredicate::CountryField) {
+                if (predicate.value.startsWith('+')) {
+                    predicate.value.remove(0, 1);
+                } else if (predicate.value.startsWith("00")) {
+                    predicate.value.remove(0, 2);
+                }
+            }
+            break;
+
+        default:
+            if (isRange) {
+                query.errorMessage = QString("Range comparisons are only supported for id, "
+                                             "created and modified (\"%1\")").arg(token);
+                return query;
+            }
+            break;
+        }
+
+        query.terms.push_back(predicate);
+    }
+
+    return query;
+}
+
+QString ContactQuery::toString() const {
+    QStringList parts;
+    for (const QueryPredicate& predicate : terms) {
+        parts << predicate.toString();
+    }
+    return parts.join(' ');
+}
+
+bool ContactQuery::matches(const Contact& contact) const {
+    return std::all_of(terms.begin(), terms.end(),
+                       [&contact](const QueryPredicate& p) { return p.matches(contact); });
+}
+
+// ---------------------------------------------------------------------------
+// QueryPlan
+// ---------------------------------------------------------------------------
+
+QString QueryPlan::toString(const ContactQuery& query) const {
+    const auto& predicates = query.predicates();
+    QStringList lines;
+
+    if (indexSteps.empty()) {
+        lines << QString("full scan (%1 rows)").arg(totalRows);
+    }
+
+    for (size_t i = 0; i < indexSteps.size(); ++i) {
+        const QueryPlanStep& step = indexSteps[i];
+        lines << QString("%1%2 %3 (est. %4 rows%5)")
+                     .arg(i == 0 ? "" : "intersect ")
+                     .arg(accessName(step.access))
+                     .arg(predicates[step.predicate].toString())
+                     .arg(step.estimatedRows)
+                     .arg(step.exact ? "" : ", recheck");
+    }
+
+    if (!residual.empty()) {
+        QStringList filters;
+        for (size_t index : residual) {
+            filters << predicates[index].toString();
+        }
+        lines << QString("filter %1").arg(filters.join(" AND "));
+    }
+
+    lines << QString("estimated %1 of %2 rows").arg(estimatedRows).arg(totalRows);
+    return lines.join('\n');
+}
+
+// ---------------------------------------------------------------------------
+// QueryPlanner
+// ---------------------------------------------------------------------------
+
+QueryPlanner::QueryPlanner(const ContactManager& manager)
+    : manager(manager) {
+}
+
+std::set<QString> QueryPlanner::trigrams(const QString& text) {
+    std::set<QString> result;
+    for (int i = 0; i + 3 <= text.size(); ++i) {
+        result.insert(text.mid(i, 3));
+    }
+    return result;
+}
+
+bool QueryPlanner::accessPathFor(const QueryPredicate& predicate, QueryPlanStep& step) const {
+    if (predicate.negated) {
+        return false;
+    }
+
+    step.exact = true;
+
+    switch (predicate.field) {
+    case QueryPredicate::IdField: {
+        const auto& index = manager.idToIndex;
+        if (predicate.op == QueryPredicate::Equals) {
+            step.access = QueryPlanStep::IdLookup;
+            step.estimatedRows = index.count(static_cast<int>(predicate.number));
+            return true;
+        }
+
+        // IDs are handed out sequentially, so assume they are spread evenly
+        // between the smallest and largest key.
+        step.access = QueryPlanStep::IdRange;
+        step.estimatedRows = 0;
+        if (!index.empty()) {
+            qint64 low, high;
+            idBounds(predicate, low, high);
+            const qint64 minId = index.begin()->first;
+            const qint64 maxId = index.rbegin()->first;
+            low = std::max(low, minId);
+            high = std::min(high, maxId);
+            if (low <= high) {
+                const double fraction = double(high - low + 1) / double(maxId - minId + 1);
+                step.estimatedRows = std::max<size_t>(1, size_t(fraction * index.size()));
+            }
+        }
+        return true;
+    }
+
+    case QueryPredicate::AnyField: {
+        // Only number-like terms have an index; names come from the trigram
+        // or name index, so short substrings are left to a scan
+        PhoneDigits::Match mode;
+        if (!digitMode(predicate, mode) ||
+            (mode == PhoneDigits::Substring && predicate.value.size() < 3)) {
+            return false;
+        }
+        step.access = QueryPlanStep::PhoneDigitScan;
+        step.exact = false;
+        step.estimatedRows = digitCandidates(step, predicate).size();
+        return true;
+    }
+
+    case QueryPredicate::PhoneField: {
+        PhoneDigits::Match mode;
+        if (digitMode(predicate, mode)) {
+            step.access = QueryPlanStep::PhoneDigitScan;
+            step.estimatedRows = digitCandidates(step, predicate).size();
+            return true;
+        }
+        if (predicate.op == QueryPredicate::Equals) {
+            step.access = QueryPlanStep::PhoneLookup;
+            step.estimatedRows = manager.phoneIndex.count(predicate.value);
+            return true;
+        }
+        if (predicate.op == QueryPredicate::Prefix) {
+            step.access = QueryPlanStep::PhonePrefix;
+            step.estimatedRows = countPrefix(manager.phoneIndex, predicate.value);
+            return true;
+        }
+        return false;
+    }
+
+    case QueryPredicate::NameField:
+        if (predicate.op == QueryPredicate::Equals) {
+            step.access = QueryPlanStep::NameLookup;
+            step.estimatedRows = manager.nameIndex.count(predicate.value);
+            return true;
+        }
+        if (predicate.op == QueryPredicate::Prefix) {
+            step.access = QueryPlanStep::NamePrefix;
+            step.estimatedRows = countPrefix(manager.nameIndex, predicate.value);
+            return true;
+        }
+        if (predicate.op == QueryPredicate::Contains && predicate.value.size() >= 3) {
+            // The rarest trigram bounds the result; rows still need a recheck
+            // because matching trigrams need not be adjacent.
+            step.access = QueryPlanStep::NameTrigram;
+            step.exact = false;
+            step.estimatedRows = manager.contacts.size();
+            for (const QString& trigram : trigrams(predicate.value)) {
+                auto it = manager.trigramIndex.find(trigram);
+                const size_t postings = it == manager.trigramIndex.end() ? 0 : it->second.size();
+                step.estimatedRows = std::min(step.estimatedRows, postings);
+            }
+            return true;
+        }
+        if (predicate.op == QueryPredicate::SoundsLike) {
+            // Every word's code must match, so the rarest code bounds the result
+            step.access = QueryPlanStep::NamePhonetic;
+            step.estimatedRows = manager.contacts.size();
+            for (const QString& key : predicate.phoneticKeys) {
+                auto it = manager.phoneticIndex.find(key);
+                const size_t postings = it == manager.phoneticIndex.end() ? 0 : it->second.size();
+                step.estimatedRows = std::min(step.estimatedRows, postings);
+            }
+            return true;
+        }
+        return false;
+
+    case QueryPredicate::CreatedField:
+    case QueryPredicate::ModifiedField: {
+        const bool created = predicate.field == QueryPredicate::CreatedField;
+        const auto range = timeRange(manager.timeIndex(created ? ContactManager::CreatedTime
+                                                               : ContactManager::ModifiedTime),
+                                     predicate);
+        // Counting past the point where a full scan wins is wasted work
+        step.access = created ? QueryPlanStep::CreatedRange : QueryPlanStep::ModifiedRange;
+        step.estimatedRows = countUpTo(range.first, range.second,
+                                       manager.contacts.size() / kIndexRowCost + 1);
+        return true;
+    }
+
+    case QueryPredicate::DomainField:
+    case QueryPredicate::CountryField:
+    case QueryPredicate::CityField: {
+        if (predicate.op != QueryPredicate::Equals) {
+            return false;
+        }
+        const auto& index = manager.facetIndex[facetOf(predicate.field)];
+        auto it = index.find(predicate.value);
+        step.access = QueryPlanStep::FacetLookup;
+        step.estimatedRows = it == index.end() ? 0 : it->second.size();
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+QueryPlan QueryPlanner::plan(const ContactQuery& query) const {
+    const auto& predicates = query.predicates();
+    digitMatches.clear();
+    QueryPlan plan;
+    plan.totalRows = manager.contacts.size();
+
+    std::vector<QueryPlanStep> candidates;
+    for (size_t i = 0; i < predicates.size(); ++i) {
+        QueryPlanStep step;
+        step.predicate = i;
+        if (accessPathFor(predicates[i], step)) {
+            candidates.push_back(step);
+        } else {
+            plan.residual.push_back(i);
+        }
+    }
+
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const QueryPlanStep& a, const QueryPlanStep& b) {
+                         return a.estimatedRows < b.estimatedRows;
+                     });
+
+    size_t rows = plan.totalRows;
+    for (const QueryPlanStep& step : candidates) {
+        bool useIndex;
+        if (plan.indexSteps.empty()) {
+            useIndex = step.estimatedRows * kIndexRowCost <= plan.totalRows;
+        } else {
+            useIndex = step.estimatedRows + rows < rows * kRowCheckCost;
+        }
+
+        if (useIndex) {
+            plan.indexSteps.push_back(step);
+            rows = std::min(rows, step.estimatedRows);
+            if (!step.exact) {
+                plan.residual.push_back(step.predicate);
+            }
+        } else {
+            plan.residual.push_back(step.predicate);
+        }
+    }
+
+    std::sort(plan.residual.begin(), plan.residual.end());
+    plan.estimatedRows = rows;
+    return plan;
+}
+
+std::vector<int> QueryPlanner::fetch(const QueryPlanStep& step,
+                                     const QueryPredicate& predicate) const {
+    std::vector<int> ids;
+
+    switch (step.access) {
+    case QueryPlanStep::IdLookup:
+    case QueryPlanStep::IdRange: {
+        qint64 low, high;
+        idBounds(predicate, low, high);
+        low = std::max<qint64>(low, std::numeric_limits<int>::min());
+        if (low > high || low > std::numeric_limits<int>::max()) {
+            break;
+        }
+        for (auto it = manager.idToIndex.lower_bound(static_cast<int>(low));
+             it != manager.idToIndex.end() && it->first <= high; ++it) {
+            ids.push_back(it->first);
+        }
+        break;
+    }
+
+    case QueryPlanStep::PhoneLookup:
+        ids = collectEqual(manager.phoneIndex, predicate.value);
+        break;
+
+    case QueryPlanStep::PhonePrefix:
+        ids = collectPrefix(manager.phoneIndex, predicate.value);
+        break;
+
+    case QueryPlanStep::NameLookup:
+        ids = collectEqual(manager.nameIndex, predicate.value);
+        break;
+
+    case QueryPlanStep::NamePrefix:
+        ids = collectPrefix(manager.nameIndex, predicate.value);
+        break;
+
+    case QueryPlanStep::NameTrigram:
+        ids = trigramCandidates(predicate.value);
+        break;
+
+    case QueryPlanStep::NamePhonetic: {
+        for (const QString& key : predicate.phoneticKeys) {
+            auto it = manager.phoneticIndex.find(key);
+            if (it == manager.phoneticIndex.end()) {
+                return std::vector<int>();
+            }
+            std::vector<int> postings(it->second.begin(), it->second.end());
+            if (ids.empty()) {
+                ids.swap(postings);
+                continue;
+            }
+            std::vector<int> merged;
+            std::set_intersection(ids.begin(), ids.end(), postings.begin(), postings.end(),
+                                  std::back_inserter(merged));
+            ids.swap(merged);
+            if (ids.empty()) {
+                break;
+            }
+        }
+        break;
+    }
+
+    case QueryPlanStep::CreatedRange:
+    case QueryPlanStep::ModifiedRange: {
+        const auto range = timeRange(manager.timeIndex(step.access == QueryPlanStep::CreatedRange
+                                                           ? ContactManager::CreatedTime
+                                                           : ContactManager::ModifiedTime),
+                                     predicate);
+        for (auto it = range.first; it != range.second; ++it) {
+            ids.push_back(it->second);
+        }
+        std::sort(ids.begin(), ids.end());
+        break;
+    }
+
+    case QueryPlanStep::FacetLookup: {
+        const auto& index = manager.facetIndex[facetOf(predicate.field)];
+        auto it = index.find(predicate.value);
+        if (it != index.end()) {
+            ids.assign(it->second.begin(), it->second.end());
+        }
+        break;
+    }
+
+    case QueryPlanStep::PhoneDigitScan:
+        ids = digitCandidates(step, predicate);
+        break;
+    }
+
+    return ids;
+}
+
+const std::vector<int>& QueryPlanner::digitCandidates(const QueryPlanStep& step,
+                                                      const QueryPredicate& predicate) const {
+    auto cached = digitMatches.find(step.predicate);
+    if (cached != digitMatches.end()) {
+        return cached->second;
+    }
+
+    PhoneDigits::Match mode = PhoneDigits::Substring;
+    digitMode(predicate, mode);
+    std::vector<int> ids = manager.phoneDigitIndex.search(predicate.value, mode);
+
+    if (predicate.field == QueryPredicate::AnyField) {
+        // Bare terms match names too; rows are rechecked, so a superset is enough
+        const std::vector<int> names = mode == PhoneDigits::Prefix
+            ? collectPrefix(manager.nameIndex, predicate.value)
+            : trigramCandidates(predicate.value);
+        std::vector<int> merged;
+        std::set_union(ids.begin(), ids.end(), names.begin(), names.end(),
+                       std::back_inserter(merged));
+        ids.swap(merged);
+    }
+    return digitMatches.emplace(step.predicate, std::move(ids)).first->second;
+}
+
+std::vector<int> QueryPlanner::trigramCandidates(const QString& text) const {
+    std::vector<int> ids;
+    std::vector<const std::set<int>*> postings;
+    for (const QString& trigram : trigrams(text)) {
+        auto it = manager.trigramIndex.find(trigram);
+        if (it == manager.trigramIndex.end()) {
+            return ids;
+        }
+        postings.push_back(&it->second);
+    }
+    if (postings.empty()) {
+        return ids;
+    }
+    std::sort(postings.begin(), postings.end(),
+              [](const std::set<int>* a, const std::set<int>* b) { return a->size() < b->size(); });
+
+    ids.assign(postings.front()->begin(), postings.front()->end());
+    for (size_t i = 1; i < postings.size() && !ids.empty(); ++i) {
+        std::vector<int> merged;
+        std::set_intersection(ids.begin(), ids.end(),
+                              postings[i]->begin(), postings[i]->end(),
+                              std::back_inserter(merged));
+        ids.swap(merged);
+    }
+    return ids;
+}
+
+std::vector<int> QueryPlanner::execute(const ContactQuery& query) const {
+    const auto& predicates = query.predicates();
+    const QueryPlan plan = this->plan(query);
+    std::vector<int> ids;
+
+    if (plan.indexSteps.empty()) {
+        for (const auto& contact : manager.contacts) {
+            if (query.matches(contact)) {
+                ids.push_back(contact.getId());
+            }
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    ids = fetch(plan.indexSteps.front(), predicates[plan.indexSteps.front().predicate]);
+    for (size_t i = 1; i < plan.indexSteps.size() && !ids.empty(); ++i) {
+        const QueryPlanStep& step = plan.indexSteps[i];
+        const std::vector<int> next = fetch(step, predicates[step.predicate]);
+        std::vector<int> merged;
+        std::set_intersection(ids.begin(), ids.end(), next.begin(), next.end(),
+                              std::back_inserter(merged));
+        ids.swap(merged);
+    }
+
+    if (!plan.residual.empty()) {
+        ids.erase(std::remove_if(ids.begin(), ids.end(),
+                                 [&](int id) {
+                                     const Contact& contact = manager.contacts[manager.idToIndex.at(id)];
+                                     for (size_t index : plan.residual) {
+                                         if (!predicates[index].matches(contact)) {
+                                             return true;
+                                         }
+                                     }
+                                     return false;
+                                 }),
+                  ids.end());
+    }
+
+    return ids;
+}
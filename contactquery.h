@@ -0,0 +1,220 @@
+/**
+ * @file contactquery.h
+ * @brief Multi-field query language, parser and cost-based planner
+ *
+ * A query is a whitespace separated list of terms which must all match:
+ *
+ *     name:ram* email:@acme.com -notes:former modified>2026-01-01
+ *
+ * - field:value   case-insensitive substring match
+ * - field:value*  prefix match
+ * - field=value   exact match
+ * - name~value    sound-alike match (Soundex) on every word of value
+ * - domain:value, country:value, city:value
+ *                 facet group match (see Facets), e.g. domain:acme.com,
+ *                 country:+91, city:pune; value* matches a key prefix
+ * - field>value, field>=value, field<value, field<=value
+ *                 range match (id, created, modified)
+ * - -term         negates the term
+ * - value         bare term, matches name or phone
+ *
+ * Phone and bare terms that read as a number (see PhoneDigits::isPhoneQuery)
+ * also match by digits, ignoring separators: "98765" and phone:98765* find
+ * "+91 98765-43210".
+ *
+ * Values containing spaces can be wrapped in double quotes.
+ * Fields: id, name, phone, email, address, notes, created, modified,
+ * domain, country, city.
+ */
+
+#ifndef CONTACTQUERY_H
+#define CONTACTQUERY_H
+
+#include "contact.h"
+#include <QString>
+#include <QStringList>
+#include <map>
+#include <vector>
+#include <set>
+
+class ContactManager;
+
+/**
+ * @brief A single term of a query
+ */
+struct QueryPredicate {
+    enum Field {
+        AnyField,       ///< Bare term: name or phone
+        IdField,
+        NameField,
+        PhoneField,
+        EmailField,
+        AddressField,
+        NotesField,
+        CreatedField,
+        ModifiedField,
+        DomainField,    ///< Email domain facet
+        CountryField,   ///< Phone country code facet
+        CityField       ///< Address city facet
+    };
+
+    enum Operator {
+        Contains,
+        Prefix,
+        Equals,
+        SoundsLike,
+        Less,
+        LessOrEqual,
+        Greater,
+        GreaterOrEqual
+    };
+
+    Field field = AnyField;
+    Operator op = Contains;
+    QString value;              ///< Lower-cased search value for text fields
+    qint64 number = 0;          ///< ID or msecs since epoch for numeric fields
+    QStringList phoneticKeys;   ///< Soundex codes of value for SoundsLike
+    bool negated = false;
+
+    /**
+     * @brief Tests the predicate against a contact (honours negation)
+     */
+    bool matches(const Contact& contact) const;
+
+    /**
+     * @brief Formats the predicate back into query syntax
+     * parse() of the text gives the same predicate; values with spaces are
+     * quoted.
+     */
+    QString toString() const;
+
+    static QString fieldName(Field field);
+};
+
+/**
+ * @brief Parsed form of a query string
+ */
+class ContactQuery {
+public:
+    /**
+     * @brief Parses a query string
+     * @param text The query text
+     * @param soundsLike Treat bare terms as name~term instead of substrings
+     * @return The parsed query; check isValid() before use
+     */
+    static ContactQuery parse(const QString& text, bool soundsLike = false);
+
+    bool isValid() const { return errorMessage.isEmpty(); }
+    QString error() const { return errorMessage; }
+    const std::vector<QueryPredicate>& predicates() const { return terms; }
+
+    /**
+     * @brief Canonical query text, e.g. as a cache key
+     * Queries that differ only in spacing or quoting format the same.
+     */
+    QString toString() const;
+
+    /**
+     * @brief Tests every predicate against a contact
+     * Time Complexity: O(p) string comparisons for p predicates
+     */
+    bool matches(const Contact& contact) const;
+
+private:
+    std::vector<QueryPredicate> terms;
+    QString errorMessage;
+};
+
+/**
+ * @brief One access path chosen by the planner
+ */
+struct QueryPlanStep {
+    enum Access {
+        IdLookup,       ///< idToIndex point lookup
+        IdRange,        ///< idToIndex range scan
+        PhoneLookup,    ///< phoneIndex point lookup
+        PhonePrefix,    ///< phoneIndex range scan
+        NameLookup,     ///< nameIndex point lookup
+        NamePrefix,     ///< nameIndex range scan
+        NameTrigram,    ///< Intersection of trigram posting sets
+        NamePhonetic,   ///< Intersection of Soundex posting sets
+        CreatedRange,   ///< createdIndex range scan
+        ModifiedRange,  ///< modifiedIndex range scan
+        FacetLookup,    ///< facetIndex posting set
+        PhoneDigitScan  ///< phoneDigitIndex column scan, plus name candidates for bare terms
+    };
+
+    Access access;
+    size_t predicate;           ///< Index into ContactQuery::predicates()
+    size_t estimatedRows;
+    bool exact;                 ///< false if the rows still need re-checking
+};
+
+/**
+ * @brief Execution plan: index steps to intersect, then residual filters
+ */
+struct QueryPlan {
+    std::vector<QueryPlanStep> indexSteps;  ///< Empty means a full scan
+    std::vector<size_t> residual;           ///< Predicates checked per row
+    size_t estimatedRows = 0;
+    size_t totalRows = 0;
+
+    /**
+     * @brief Formats the plan for explain output
+     */
+    QString toString(const ContactQuery& query) const;
+};
+
+/**
+ * @brief Chooses and runs access paths over ContactManager's indexes
+ *
+ * Every indexable positive predicate is costed by the number of rows its
+ * index would return. The cheapest one drives the scan; further index
+ * results are intersected only while that is cheaper than checking the
+ * candidates row by row. Everything else becomes a residual filter.
+ */
+class QueryPlanner {
+public:
+    explicit QueryPlanner(const ContactManager& manager);
+
+    /**
+     * @brief Builds a plan for a query
+     * Time Complexity: O(p log n) for p predicates
+     */
+    QueryPlan plan(const ContactQuery& query) const;
+
+    /**
+     * @brief Plans and executes a query
+     * @return Sorted IDs of matching contacts
+     */
+    std::vector<int> execute(const ContactQuery& query) const;
+
+    /**
+     * @brief Splits lower-cased text into its distinct 3-character substrings
+     */
+    static std::set<QString> trigrams(const QString& text);
+
+private:
+    const ContactManager& manager;
+
+    /// IDs found by PhoneDigitScan steps while costing them, by predicate index
+    mutable std::map<size_t, std::vector<int>> digitMatches;
+
+    bool accessPathFor(const QueryPredicate& predicate, QueryPlanStep& step) const;
+    std::vector<int> fetch(const QueryPlanStep& step, const QueryPredicate& predicate) const;
+
+    /**
+     * @brief Candidates of a PhoneDigitScan step, computed once per plan
+     * The column scan is the estimate, so its result is kept for fetch().
+     */
+    const std::vector<int>& digitCandidates(const QueryPlanStep& step,
+                                            const QueryPredicate& predicate) const;
+
+    /**
+     * @brief Intersection of the trigram postings of lower-cased text
+     * A superset of the names containing text; empty if any trigram is unknown.
+     */
+    std::vector<int> trigramCandidates(const QString& text) const;
+};
+
+#endif // CONTACTQUERY_H
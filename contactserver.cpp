@@ -0,0 +1,368 @@
+/**
+ * @file contactserver.cpp
+ * @brief Implementation of the local contact server
+ */
+
+#include "contactserver.h"
+#include "contactprotocol.h"
+#include "contactvalidator.h"
+#include <QDebug>
+#include <QFileInfo>
+
+namespace {
+
+// Changes are written this long after the last mutation
+const int kSaveDelayMs = 3000;
+
+// Search results returned when the client asks for no limit
+const quint32 kDefaultSearchLimit = 1000;
+
+} // namespace
+
+ContactServer::ContactServer(const QString& dataFile, QObject *parent)
+    : QObject(parent)
+    , dataFile(dataFile) {
+    if (DiskContactStore::isStoreFile(dataFile)) {
+        disk = std::make_unique<DiskContactStore>();
+        if (!disk->open(dataFile)) {
+            qDebug() << "Failed to open contact store:" << dataFile;
+            ready = false;
+        }
+    } else if (QFileInfo::exists(dataFile) && !manager.loadFromFile(dataFile)) {
+        qDebug() << "Failed to load contacts from:" << dataFile;
+        damagedPath = ContactManager::keepDamagedFile(dataFile);
+        ready = false;
+    }
+
+    // Clients cannot undo, keep only the latest step
+    manager.setUndoBudget(0);
+
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(kSaveDelayMs);
+    connect(&saveTimer, &QTimer::timeout, this, &ContactServer::saveIfDirty);
+    connect(&server, &QLocalServer::newConnection, this, &ContactServer::onNewConnection);
+}
+
+ContactServer::~ContactServer() {
+    server.close();
+    workers.waitForDone();
+    saveIfDirty();
+}
+
+bool ContactServer::listen(const QString& name) {
+    if (server.listen(name)) {
+        return true;
+    }
+
+    // A crashed server leaves its socket file behind; reclaim it only if
+    // nobody answers on it
+    if (server.serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (!probe.waitForConnected(500)) {
+            QLocalServer::removeServer(name);
+            return server.listen(name);
+        }
+    }
+    return false;
+}
+
+void ContactServer::setWorkerCount(int workerCount) {
+    workers.setMaxThreadCount(std::max(1, workerCount));
+}
+
+int ContactServer::contactCount() {
+    std::shared_lock<std::shared_mutex> lock(managerLock);
+    return disk ? disk->getContactCount() : manager.getContactCount();
+}
+
+void ContactServer::onNewConnection() {
+    while (QLocalSocket *socket = server.nextPendingConnection()) {
+        auto connection = std::make_shared<Connection>();
+        connection->socket = socket;
+        connections[socket] = connection;
+
+        connect(socket, &QLocalSocket::readyRead, this, &ContactServer::onReadyRead);
+        connect(socket, &QLocalSocket::disconnected, this, &ContactServer::onDisconnected);
+    }
+}
+
+void ContactServer::onReadyRead() {
+    auto *socket = qobject_cast<QLocalSocket*>(sender());
+    auto it = connections.find(socket);
+    if (it == connections.end()) {
+        return;
+    }
+
+    std::shared_ptr<Connection> connection = it->second;
+    connection->input.append(socket->readAll());
+
+    // Queue every complete frame; pipelined requests arrive together
+    QByteArray payload;
+    bool error = false;
+    bool start = false;
+    while (ContactProtocol::takeFrame(connection->input, payload, error)) {
+        std::lock_guard<std::mutex> lock(connection->mutex);
+        connection->pending.push_back(payload);
+        if (!connection->running) {
+            connection->running = true;
+            start = true;
+        }
+    }
+
+    if (error) {
+        qDebug() << "Closing connection after an oversized frame";
+        socket->abort();
+        return;
+    }
+    if (start) {
+        workers.start([this, connection]() { drain(connection); });
+    }
+}
+
+void ContactServer::onDisconnected() {
+    auto *socket = qobject_cast<QLocalSocket*>(sender());
+    connections.erase(socket);
+    socket->deleteLater();
+}
+
+void ContactServer::drain(const std::shared_ptr<Connection>& connection) {
+    for (;;) {
+        QByteArray request;
+        {
+            std::lock_guard<std::mutex> lock(connection->mutex);
+            if (connection->pending.empty()) {
+                connection->running = false;
+                return;
+            }
+            request = std::move(connection->pending.front());
+            connection->pending.pop_front();
+        }
+
+        // Sockets belong to the server thread, so hand the response back
+        const QByteArray response = ContactProtocol::frame(handle(request));
+        QMetaObject::invokeMethod(this, [connection, response]() {
+            if (connection->socket) {
+                connection->socket->write(response);
+            }
+        }, Qt::QueuedConnection);
+    }
+}
+
+QByteArray ContactServer::handle(const QByteArray& request) {
+    QDataStream in(request);
+    quint32 requestId = 0;
+    quint8 opcode = 0;
+    in >> requestId >> opcode;
+
+    QByteArray response;
+    QDataStream out(&response, QIODevice::WriteOnly);
+    out << requestId;
+
+    auto fail = [&](ContactProtocol::Status status, const QString& message) {
+        response.clear();
+        QDataStream error(&response, QIODevice::WriteOnly);
+        error << requestId << static_cast<quint8>(status) << message;
+        return response;
+    };
+
+    if (in.status() != QDataStream::Ok) {
+        return fail(ContactProtocol::BadRequest, "Truncated request header");
+    }
+
+    switch (opcode) {
+    case ContactProtocol::Ping:
+        out << static_cast<quint8>(ContactProtocol::Ok);
+        return response;
+
+    case ContactProtocol::Count: {
+        std::shared_lock<std::shared_mutex> lock(managerLock);
+        out << static_cast<quint8>(ContactProtocol::Ok)
+            << static_cast<quint32>(disk ? disk->getContactCount() : manager.getContactCount());
+        return response;
+    }
+
+    case ContactProtocol::MaxId: {
+        std::shared_lock<std::shared_mutex> lock(managerLock);
+        out << static_cast<quint8>(ContactProtocol::Ok)
+            << static_cast<qint32>(disk ? disk->getMaxId() : manager.getMaxId());
+        return response;
+    }
+
+    case ContactProtocol::GetContact: {
+        qint32 id;
+        in >> id;
+        std::shared_lock<std::shared_mutex> lock(managerLock);
+        std::optional<Contact> stored;
+        const Contact *contact = nullptr;
+        if (disk) {
+            stored = disk->getContactById(id);
+            contact = stored ? &*stored : nullptr;
+        } else {
+            contact = manager.getContactById(id);
+        }
+        if (!contact) {
+            return fail(ContactProtocol::NotFound, QString("No contact with ID %1").arg(id));
+        }
+        out << static_cast<quint8>(ContactProtocol::Ok);
+        ContactProtocol::writeContact(out, *contact);
+        return response;
+    }
+
+    case ContactProtocol::Search: {
+        QString text;
+        quint32 limit;
+        in >> text >> limit;
+        if (in.status() != QDataStream::Ok) {
+            return fail(ContactProtocol::BadRequest, "Truncated request");
+        }
+        const ContactQuery query = ContactQuery::parse(text);
+        if (!query.isValid()) {
+            return fail(ContactProtocol::BadRequest, query.error());
+        }
+        limit = limit ? limit : kDefaultSearchLimit;
+
+        std::shared_lock<std::shared_mutex> lock(managerLock);
+        size_t total = 0;
+        std::vector<Contact> results;
+        if (disk) {
+            results = disk->search(query, limit, total);
+        } else {
+            results = manager.search(query, ContactManager::SortByNameAsc);
+            total = results.size();
+        }
+        const quint32 count = std::min<quint32>(limit, static_cast<quint32>(results.size()));
+        out << static_cast<quint8>(ContactProtocol::Ok)
+            << static_cast<quint32>(total) << count;
+        for (quint32 i = 0; i < count; ++i) {
+            ContactProtocol::writeContact(out, results[i]);
+        }
+        return response;
+    }
+
+    case ContactProtocol::SearchText: {
+        QString text;
+        quint32 limit;
+        in >> text >> limit;
+        limit = limit ? limit : kDefaultSearchLimit;
+        if (disk) {
+            return fail(ContactProtocol::BadRequest, "A disk-backed store has no full-text index");
+        }
+
+        std::shared_lock<std::shared_mutex> lock(managerLock);
+        const auto hits = manager.searchText(text, limit);
+        out << static_cast<quint8>(ContactProtocol::Ok) << static_cast<quint32>(hits.size());
+        for (const auto& hit : hits) {
+            ContactProtocol::writeContact(out, hit.contact);
+            out << hit.score;
+        }
+        return response;
+    }
+
+    case ContactProtocol::FacetCounts: {
+        quint8 facet;
+        QString text;
+        quint32 limit;
+        in >> facet >> text >> limit;
+        const ContactQuery query = ContactQuery::parse(text);
+        if (in.status() != QDataStream::Ok || facet >= Facets::kKindCount || !query.isValid()) {
+            return fail(ContactProtocol::BadRequest,
+                        query.isValid() ? QString("Unknown facet %1").arg(facet) : query.error());
+        }
+        if (disk) {
+            return fail(ContactProtocol::BadRequest, "A disk-backed store has no facet indexes");
+        }
+
+        std::shared_lock<std::shared_mutex> lock(managerLock);
+        const auto groups = manager.facetCounts(static_cast<Facets::Kind>(facet), query, limit);
+        out << static_cast<quint8>(ContactProtocol::Ok) << static_cast<quint32>(groups.size());
+        for (const auto& group : groups) {
+            out << group.key << static_cast<quint32>(group.count);
+        }
+        return response;
+    }
+
+    case ContactProtocol::AddContact:
+    case ContactProtocol::UpdateContact: {
+        qint32 id = 0;
+        if (opcode == ContactProtocol::UpdateContact) {
+            in >> id;
+        }
+        Contact contact;
+        int storedId;
+        if (!ContactProtocol::readContact(in, contact, storedId)) {
+            return fail(ContactProtocol::BadRequest, "Truncated contact");
+        }
+
+        const auto result = ContactValidator::validate(contact.getName(), contact.getPhone(),
+                                                       contact.getEmail());
+        if (result != ContactValidator::Valid) {
+            return fail(ContactProtocol::Rejected, ContactValidator::message(result));
+        }
+
+        std::unique_lock<std::shared_mutex> lock(managerLock);
+        const bool taken = disk ? disk->phoneExists(contact.getPhone(), id)
+                                : manager.phoneExists(contact.getPhone(), id);
+        if (taken) {
+            return fail(ContactProtocol::Rejected, "A contact with this phone number already exists");
+        }
+
+        bool ok;
+        if (opcode == ContactProtocol::AddContact) {
+            const qint32 newId = contact.getId();
+            ok = disk ? disk->addContact(contact) : manager.addContact(std::move(contact));
+            out << static_cast<quint8>(ContactProtocol::Ok) << newId;
+        } else {
+            ok = disk ? disk->updateContact(id, contact) : manager.updateContact(id, std::move(contact));
+            if (!ok) {
+                return fail(ContactProtocol::NotFound, QString("No contact with ID %1").arg(id));
+            }
+            out << static_cast<quint8>(ContactProtocol::Ok);
+        }
+        if (!ok) {
+            return fail(ContactProtocol::Rejected, "The contact could not be stored");
+        }
+        break;
+    }
+
+    case ContactProtocol::RemoveContact: {
+        qint32 id;
+        in >> id;
+        std::unique_lock<std::shared_mutex> lock(managerLock);
+        if (disk ? !disk->removeContact(id) : !manager.removeContact(id)) {
+            return fail(ContactProtocol::NotFound, QString("No contact with ID %1").arg(id));
+        }
+        out << static_cast<quint8>(ContactProtocol::Ok);
+        break;
+    }
+
+    default:
+        return fail(ContactProtocol::BadRequest, QString("Unknown opcode %1").arg(opcode));
+    }
+
+    // Only mutations get here; restart the save countdown
+    dirty = true;
+    QMetaObject::invokeMethod(&saveTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
+    return response;
+}
+
+void ContactServer::saveIfDirty() {
+    if (!ready || !dirty.exchange(false)) {
+        return;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(managerLock);
+    if (disk) {
+        // Mutations already went to the store's pages; make them durable
+        if (!disk->flush()) {
+            qDebug() << "Failed to flush contact store:" << dataFile;
+            dirty = true;
+        }
+        return;
+    }
+    if (!manager.saveToFile(dataFile, ContactManager::formatForFile(dataFile)) ||
+        !manager.saveTextIndex(ContactManager::textIndexPath(dataFile))) {
+        qDebug() << "Failed to save contacts to:" << dataFile;
+        dirty = true;
+    }
+}
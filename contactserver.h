@@ -0,0 +1,126 @@
+/**
+ * @file contactserver.h
+ * @brief Local server sharing one ContactManager with other processes
+ *
+ * Tools that need contact lookups connect to a QLocalServer (a Unix domain
+ * socket or Windows named pipe) instead of each parsing the data file.
+ * Requests use the binary protocol in contactprotocol.h and are executed on
+ * a worker pool: reads run concurrently under a shared lock, mutations
+ * take the lock exclusively. Each connection's requests run in order, so
+ * pipelined requests see each other's effects. Changes are saved to the
+ * data file a few seconds after the last mutation and on shutdown.
+ *
+ * A data file ending in DiskContactStore::kFileSuffix is served from disk
+ * instead, with only the page cache in memory. Such a store has no
+ * full-text or facet indexes, so SearchText and FacetCounts are refused
+ * and Search reads every record.
+ */
+
+#ifndef CONTACTSERVER_H
+#define CONTACTSERVER_H
+
+#include "contactmanager.h"
+#include "diskcontactstore.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QPointer>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+class ContactServer : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Loads the data file (if it exists) into the hosted manager
+     * Check isReady() before listening: a file that exists but does not
+     * load is copied aside and never saved over.
+     */
+    explicit ContactServer(const QString& dataFile, QObject *parent = nullptr);
+
+    /**
+     * @brief Waits for running requests and saves pending changes
+     */
+    ~ContactServer();
+
+    /**
+     * @brief Starts accepting connections
+     * @param name Server name clients connect to
+     * @return false if the name is taken by a running server
+     */
+    bool listen(const QString& name);
+
+    /**
+     * @brief Sets the number of worker threads executing requests
+     */
+    void setWorkerCount(int workers);
+
+    QString errorString() const { return server.errorString(); }
+
+    /**
+     * @brief false if the data file could not be loaded
+     * Serving an empty book then would let the first save replace a file
+     * whose contacts could still be repaired.
+     */
+    bool isReady() const { return ready; }
+
+    /**
+     * @brief Copy of a data file that failed to load, see keepDamagedFile()
+     */
+    QString damagedCopy() const { return damagedPath; }
+    int contactCount();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+    void saveIfDirty();
+
+private:
+    /**
+     * @brief Per-client state
+     * input is only touched on the server thread; pending and running are
+     * shared with the worker draining the connection.
+     */
+    struct Connection {
+        QPointer<QLocalSocket> socket;
+        QByteArray input;
+        std::mutex mutex;
+        std::deque<QByteArray> pending;     ///< Complete request payloads
+        bool running = false;               ///< A worker is draining pending
+    };
+
+    ContactManager manager;
+    std::unique_ptr<DiskContactStore> disk; ///< Serves a store file instead of manager if set
+    std::shared_mutex managerLock;          ///< Shared for reads, exclusive for mutations
+    std::atomic<bool> dirty{false};
+    QString dataFile;
+    bool ready = true;
+    QString damagedPath;
+
+    QLocalServer server;
+    QThreadPool workers;
+    QTimer saveTimer;
+    std::map<QLocalSocket*, std::shared_ptr<Connection>> connections;
+
+    /**
+     * @brief Executes requests of one connection until its queue is empty
+     * Runs on a worker thread.
+     */
+    void drain(const std::shared_ptr<Connection>& connection);
+
+    /**
+     * @brief Executes one request and builds the response payload
+     * Runs on a worker thread.
+     */
+    QByteArray handle(const QByteArray& request);
+};
+
+#endif // CONTACTSERVER_H
@@ -0,0 +1,159 @@
+/**
+ * @file contactsorter.cpp
+ * @brief Implementation of the collation-key sort engine
+ */
+
+#include "contactsorter.h"
+#include "contactfields.h"
+#include <QList>
+#include <QStringList>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+namespace {
+
+struct SortEntry {
+    QByteArray key;
+    size_t row;
+
+    bool operator<(const SortEntry& other) const { return key < other.key; }
+};
+
+// Appends bytes, inverted for descending keys so byte order flips too
+void appendBytes(QByteArray& key, const char* bytes, int size, bool descending) {
+    for (int i = 0; i < size; ++i) {
+        key.append(descending ? static_cast<char>(~bytes[i]) : bytes[i]);
+    }
+}
+
+template <typename T>
+void appendNumber(QByteArray& key, T value, bool descending) {
+    using Unsigned = typename std::make_unsigned<T>::type;
+    Unsigned bits = static_cast<Unsigned>(value);
+    if (std::is_signed<T>::value) {
+        // Flipping the sign bit makes two's complement order match byte order
+        bits ^= Unsigned(1) << (sizeof(T) * 8 - 1);
+    }
+
+    char bytes[sizeof(T)];
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        bytes[i] = static_cast<char>(bits >> (8 * (sizeof(T) - 1 - i)));
+    }
+    appendBytes(key, bytes, sizeof(T), descending);
+}
+
+void appendText(QByteArray& key, const QString& text, bool descending) {
+    // Case-folded UTF-16 units, big-endian, then a 0x0000 terminator so a
+    // prefix sorts before the longer string
+    const QString folded = text.toCaseFolded();
+    QByteArray bytes;
+    bytes.reserve((folded.size() + 1) * 2);
+    for (QChar ch : folded) {
+        const char16_t unit = std::max<char16_t>(ch.unicode(), 1);
+        bytes.append(static_cast<char>(unit >> 8));
+        bytes.append(static_cast<char>(unit & 0xff));
+    }
+    bytes.append(2, '\0');
+    appendBytes(key, bytes.constData(), bytes.size(), descending);
+}
+
+void sortEntries(std::vector<SortEntry>& entries) {
+    const int threads = QThread::idealThreadCount();
+    if (entries.size() < ContactSorter::kParallelThreshold || threads < 2) {
+        std::sort(entries.begin(), entries.end());
+        return;
+    }
+
+    // Sort one chunk per core, then merge neighbouring runs pairwise
+    const size_t chunks = static_cast<size_t>(threads);
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= chunks; ++i) {
+        bounds.push_back(entries.size() * i / chunks);
+    }
+
+    QList<std::pair<size_t, size_t>> runs;
+    for (size_t i = 0; i < chunks; ++i) {
+        runs.append({bounds[i], bounds[i + 1]});
+    }
+    QtConcurrent::blockingMap(runs, [&entries](const std::pair<size_t, size_t>& run) {
+        std::sort(entries.begin() + run.first, entries.begin() + run.second);
+    });
+
+    for (size_t width = 1; width < chunks; width *= 2) {
+        QList<std::array<size_t, 3>> merges;
+        for (size_t i = 0; i + width < chunks; i += 2 * width) {
+            merges.append({bounds[i], bounds[i + width], bounds[std::min(i + 2 * width, chunks)]});
+        }
+        QtConcurrent::blockingMap(merges, [&entries](const std::array<size_t, 3>& merge) {
+            std::inplace_merge(entries.begin() + merge[0], entries.begin() + merge[1],
+                               entries.begin() + merge[2]);
+        });
+    }
+}
+
+} // namespace
+
+QByteArray ContactSorter::collationKey(const Contact& contact, const std::vector<Key>& keys,
+                                       quint32 row) {
+    using namespace ContactFields;
+    QByteArray key;
+
+    for (const Key& level : keys) {
+        const bool desc = level.descending;
+        switch (level.column) {
+        case IdColumn:       appendNumber<qint32>(key, Id::get(contact), desc); break;
+        case NameColumn:     appendText(key, Name::get(contact), desc); break;
+        case PhoneColumn:    appendText(key, Phone::get(contact), desc); break;
+        case EmailColumn:    appendText(key, Email::get(contact), desc); break;
+        case AddressColumn:  appendText(key, Address::get(contact), desc); break;
+        case NotesColumn:    appendText(key, Notes::get(contact), desc); break;
+        case CreatedColumn:  appendNumber<qint64>(key, Created::indexKey(contact), desc); break;
+        case ModifiedColumn: appendNumber<qint64>(key, Modified::indexKey(contact), desc); break;
+        }
+    }
+
+    appendNumber<quint32>(key, row, false);
+    return key;
+}
+
+std::vector<size_t> ContactSorter::order(const std::vector<const Contact*>& rows,
+                                         const std::vector<Key>& keys) {
+    std::vector<SortEntry> entries(rows.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        entries[i] = {collationKey(*rows[i], keys, static_cast<quint32>(i)), i};
+    }
+
+    sortEntries(entries);
+
+    std::vector<size_t> positions;
+    positions.reserve(entries.size());
+    for (const SortEntry& entry : entries) {
+        positions.push_back(entry.row);
+    }
+    return positions;
+}
+
+QString ContactSorter::describe(const std::vector<Key>& keys) {
+    QStringList parts;
+    for (const Key& key : keys) {
+        parts << (key.descending ? "-" : "") + columnName(key.column);
+    }
+    return parts.join(',');
+}
+
+QString ContactSorter::columnName(Column column) {
+    switch (column) {
+    case IdColumn:       return ContactFields::Id::key;
+    case NameColumn:     return ContactFields::Name::key;
+    case PhoneColumn:    return ContactFields::Phone::key;
+    case EmailColumn:    return ContactFields::Email::key;
+    case AddressColumn:  return ContactFields::Address::key;
+    case NotesColumn:    return ContactFields::Notes::key;
+    case CreatedColumn:  return ContactFields::Created::key;
+    case ModifiedColumn: return ContactFields::Modified::key;
+    }
+    return QString();
+}
@@ -0,0 +1,149 @@
+/**
+ * @file contactvalidator.cpp
+ * @brief Implementation of the single-pass validation rules
+ */
+
+#include "contactvalidator.h"
+
+namespace {
+
+inline bool isAsciiLetter(char16_t ch) {
+    return (ch >= u'a' && ch <= u'z') || (ch >= u'A' && ch <= u'Z');
+}
+
+inline bool isAsciiDigit(char16_t ch) {
+    return ch >= u'0' && ch <= u'9';
+}
+
+inline bool isEmailLocalChar(char16_t ch) {
+    return isAsciiLetter(ch) || isAsciiDigit(ch) ||
+           ch == u'.' || ch == u'_' || ch == u'%' || ch == u'+' || ch == u'-';
+}
+
+inline bool isEmailDomainChar(char16_t ch) {
+    return isAsciiLetter(ch) || isAsciiDigit(ch) || ch == u'.' || ch == u'-';
+}
+
+} // namespace
+
+bool ContactValidator::isValidName(QStringView name) {
+    for (QChar ch : name) {
+        if (isAsciiLetter(ch.unicode())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ContactValidator::hasValidPhoneCharacters(QStringView phone) {
+    for (QChar ch : phone) {
+        const char16_t c = ch.unicode();
+        if (!isAsciiDigit(c) && !ch.isSpace() &&
+            c != u'-' && c != u'(' && c != u')' && c != u'+') {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ContactValidator::phoneDigitCount(QStringView phone) {
+    int digits = 0;
+    for (QChar ch : phone) {
+        digits += isAsciiDigit(ch.unicode()) ? 1 : 0;
+    }
+    return digits;
+}
+
+bool ContactValidator::isValidPhone(QStringView phone) {
+    const int digits = phoneDigitCount(phone);
+    return digits >= 7 && digits <= 15;
+}
+
+bool ContactValidator::isValidEmail(QStringView email) {
+    email = email.trimmed();
+    if (email.isEmpty()) {
+        return true; // Email is optional
+    }
+
+    // Local part: one or more allowed characters up to the single '@'
+    qsizetype pos = 0;
+    while (pos < email.size() && isEmailLocalChar(email[pos].unicode())) {
+        ++pos;
+    }
+    if (pos == 0 || pos == email.size() || email[pos] != u'@') {
+        return false;
+    }
+
+    // Domain: allowed characters only; the part after the last '.' must be
+    // at least two letters and something must come before that '.'
+    const qsizetype domainStart = ++pos;
+    qsizetype lastDot = -1;
+    for (; pos < email.size(); ++pos) {
+        const char16_t ch = email[pos].unicode();
+        if (!isEmailDomainChar(ch)) {
+            return false;
+        }
+        if (ch == u'.') {
+            lastDot = pos;
+        }
+    }
+    if (lastDot <= domainStart || email.size() - lastDot - 1 < 2) {
+        return false;
+    }
+    for (pos = lastDot + 1; pos < email.size(); ++pos) {
+        if (!isAsciiLetter(email[pos].unicode())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ContactValidator::Result ContactValidator::validate(QStringView name, QStringView phone,
+                                                    QStringView email) {
+    if (name.trimmed().isEmpty()) {
+        return EmptyName;
+    }
+    if (!isValidName(name)) {
+        return NameWithoutLetters;
+    }
+    if (phone.trimmed().isEmpty()) {
+        return EmptyPhone;
+    }
+    if (!hasValidPhoneCharacters(phone)) {
+        return InvalidPhoneCharacters;
+    }
+    if (!isValidPhone(phone)) {
+        return InvalidPhoneLength;
+    }
+    if (!isValidEmail(email)) {
+        return InvalidEmail;
+    }
+    return Valid;
+}
+
+size_t ContactValidator::validateBatch(const std::vector<Contact>& contacts,
+                                       std::vector<Result>& results) {
+    results.resize(contacts.size());
+    size_t valid = 0;
+
+    for (size_t i = 0; i < contacts.size(); ++i) {
+        const Contact& contact = contacts[i];
+        results[i] = validate(contact.getName(), contact.getPhone(), contact.getEmail());
+        valid += results[i] == Valid ? 1 : 0;
+    }
+
+    return valid;
+}
+
+QString ContactValidator::message(Result result) {
+    switch (result) {
+    case Valid:                  return QString();
+    case EmptyName:              return "Name cannot be empty";
+    case NameWithoutLetters:     return "Name must contain at least some letters";
+    case EmptyPhone:             return "Phone number cannot be empty";
+    case InvalidPhoneCharacters: return "Phone number may only contain digits, spaces, -, (, ) and +";
+    case InvalidPhoneLength:     return "Phone number must have 7 to 15 digits";
+    case InvalidEmail:           return "Invalid email address";
+    }
+    return QString();
+}
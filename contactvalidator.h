@@ -0,0 +1,86 @@
+/**
+ * @file contactvalidator.h
+ * @brief Shared validation rules for names, phone numbers and emails
+ *
+ * Each rule is a hand-written single pass over the characters, so checks do
+ * not compile regexes or allocate strings. Used by AddDialog for live
+ * feedback and by ContactImporter for bulk imports.
+ */
+
+#ifndef CONTACTVALIDATOR_H
+#define CONTACTVALIDATOR_H
+
+#include "contact.h"
+#include <QString>
+#include <QStringView>
+#include <vector>
+
+class ContactValidator {
+public:
+    /**
+     * @brief Outcome of validating one record
+     */
+    enum Result {
+        Valid,
+        EmptyName,
+        NameWithoutLetters,
+        EmptyPhone,
+        InvalidPhoneCharacters,
+        InvalidPhoneLength,
+        InvalidEmail
+    };
+
+    /**
+     * @brief Name must contain at least one ASCII letter
+     * Time Complexity: O(m)
+     */
+    static bool isValidName(QStringView name);
+
+    /**
+     * @brief Phone may only contain digits, spaces, '-', '(', ')' and '+'
+     * Time Complexity: O(m)
+     */
+    static bool hasValidPhoneCharacters(QStringView phone);
+
+    /**
+     * @brief Phone must have 7 to 15 digits, ignoring separators
+     * Covers 10-digit Indian numbers, 12 digits with the 91 country code
+     * and international numbers.
+     * Time Complexity: O(m)
+     */
+    static bool isValidPhone(QStringView phone);
+
+    /**
+     * @brief Email is optional; if present it must look like user@domain.tld
+     * Equivalent to ^[a-zA-Z0-9._%+-]+@[a-zA-Z0-9.-]+\.[a-zA-Z]{2,}$
+     * Time Complexity: O(m)
+     */
+    static bool isValidEmail(QStringView email);
+
+    /**
+     * @brief Counts the digits in a phone number
+     */
+    static int phoneDigitCount(QStringView phone);
+
+    /**
+     * @brief Applies every rule to one record
+     * @return The first rule that fails, or Valid
+     */
+    static Result validate(QStringView name, QStringView phone, QStringView email);
+
+    /**
+     * @brief Validates many contacts without allocating per record
+     * @param contacts Records to check
+     * @param results Receives one Result per contact
+     * @return Number of valid contacts
+     * Time Complexity: O(total characters)
+     */
+    static size_t validateBatch(const std::vector<Contact>& contacts, std::vector<Result>& results);
+
+    /**
+     * @brief User-facing description of a result
+     */
+    static QString message(Result result);
+};
+
+#endif // CONTACTVALIDATOR_H
@@ -0,0 +1,134 @@
+/**
+ * @file crc32c.cpp
+ * @brief Hardware and table-driven CRC-32C
+ */
+
+#include "crc32c.h"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#elif defined(_M_X64)
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#define CRC32C_TARGET
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM 1
+#endif
+
+namespace {
+
+const quint32 kPolynomial = 0x82F63B78;     // Castagnoli, bit-reversed
+
+struct Tables {
+    quint32 t[8][256];
+
+    Tables() {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (kPolynomial & (0u - (crc & 1)));
+            }
+            t[0][i] = crc;
+        }
+        for (quint32 i = 0; i < 256; ++i) {
+            for (int slice = 1; slice < 8; ++slice) {
+                t[slice][i] = (t[slice - 1][i] >> 8) ^ t[0][t[slice - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+// Slicing-by-8: eight table lookups per 8 input bytes
+quint32 computeTable(const uchar* p, size_t size, quint32 crc) {
+    static const Tables tables;
+    const auto& t = tables.t;
+
+    for (; size >= 8; size -= 8, p += 8) {
+        const quint32 low = (quint32(p[0]) | quint32(p[1]) << 8 |
+                             quint32(p[2]) << 16 | quint32(p[3]) << 24) ^ crc;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+              t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; size > 0; --size, ++p) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(CRC32C_X86)
+
+CRC32C_TARGET quint32 computeHardware(const uchar* p, size_t size, quint32 crc) {
+    quint64 crc64 = crc;
+    for (; size >= 8; size -= 8, p += 8) {
+        quint64 word;
+        std::memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = static_cast<quint32>(crc64);
+    for (; size > 0; --size, ++p) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+
+bool detectHardware() {
+#if defined(_M_X64)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+#elif defined(CRC32C_ARM)
+
+quint32 computeHardware(const uchar* p, size_t size, quint32 crc) {
+    for (; size >= 8; size -= 8, p += 8) {
+        quint64 word;
+        std::memcpy(&word, p, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; size > 0; --size, ++p) {
+        crc = __crc32cb(crc, *p);
+    }
+    return crc;
+}
+
+bool detectHardware() {
+    return true;    // Compiled for a CPU with the CRC extension
+}
+
+#endif
+
+} // namespace
+
+quint32 Crc32c::compute(const char* data, qsizetype size, quint32 crc) {
+    const auto* p = reinterpret_cast<const uchar*>(data);
+    crc = ~crc;
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+    if (hardwareAccelerated()) {
+        return ~computeHardware(p, static_cast<size_t>(size), crc);
+    }
+#endif
+    return ~computeTable(p, static_cast<size_t>(size), crc);
+}
+
+quint32 Crc32c::computePortable(const char* data, qsizetype size, quint32 crc) {
+    return ~computeTable(reinterpret_cast<const uchar*>(data), static_cast<size_t>(size), ~crc);
+}
+
+bool Crc32c::hardwareAccelerated() {
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+    static const bool available = detectHardware();
+    return available;
+#else
+    return false;
+#endif
+}
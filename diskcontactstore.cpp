@@ -0,0 +1,666 @@
+/**
+ * @file diskcontactstore.cpp
+ * @brief Implementation of the disk-backed address book
+ */
+
+#include "diskcontactstore.h"
+#include "contactfields.h"
+#include "contactmanager.h"
+#include "timestamp.h"
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtEndian>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+namespace {
+
+// Header page:
+//   "CMDS" | version | page size | ID root | name root | phone root |
+//   contact count | highest ID | heap page | heap offset
+const char kStoreMagic[4] = {'C', 'M', 'D', 'S'};
+const quint32 kStoreFormatVersion = 1;
+
+// Record location stored in the ID tree: file offset | length
+const int kLocationSize = 8 + 4;
+
+// Index keys end with the 4-byte ID; the text before it is cut to fit
+const int kIdKeySize = 4;
+const int kMaxIndexText = BPlusTree::kMaxKeySize - kIdKeySize;
+
+QByteArray encodeRecord(const Contact& contact) {
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << static_cast<qint32>(contact.getId()) << contact.getName() << contact.getPhone()
+        << contact.getEmail() << contact.getAddress() << contact.getNotes()
+        << contact.getCreated() << contact.getModified();
+    return record;
+}
+
+std::optional<Contact> decodeRecord(const QByteArray& record) {
+    QDataStream in(record);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    qint32 id = 0;
+    QString name, phone, email, address, notes;
+    qint64 created = 0;
+    qint64 modified = 0;
+    in >> id >> name >> phone >> email >> address >> notes >> created >> modified;
+    if (in.status() != QDataStream::Ok) {
+        return std::nullopt;
+    }
+
+    // Restored as stored; no ID is drawn from the shared counter
+    return Contact(id, std::move(name), std::move(phone), std::move(email),
+                   std::move(address), std::move(notes), created, modified);
+}
+
+/**
+ * @brief Renames from over to in one step, replacing to if it exists
+ * QFile::rename() refuses to overwrite, which would force a remove first
+ * and leave a window with no file at all.
+ */
+bool replaceFile(const QString& from, const QString& to) {
+#if defined(Q_OS_WIN)
+    return MoveFileExW(reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(from).utf16()),
+                       reinterpret_cast<const wchar_t*>(QDir::toNativeSeparators(to).utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(QFile::encodeName(from).constData(), QFile::encodeName(to).constData()) == 0;
+#endif
+}
+
+bool nameMatches(const Contact& contact, const QString& term) {
+    return contact.getName().toLower().contains(term.toLower());
+}
+
+bool phoneMatches(const Contact& contact, const QString& term) {
+    return contact.getPhone().contains(term);
+}
+
+} // namespace
+
+bool DiskContactStore::isStoreFile(const QString& filename) {
+    return filename.endsWith(QLatin1String(kFileSuffix), Qt::CaseInsensitive);
+}
+
+DiskContactStore::DiskContactStore(size_t cacheBytes)
+    : cache(cacheBytes) {
+}
+
+DiskContactStore::~DiskContactStore() {
+    close();
+}
+
+bool DiskContactStore::open(const QString& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return openUnlocked(path);
+}
+
+bool DiskContactStore::openUnlocked(const QString& path) {
+    closeUnlocked();
+    if (!cache.open(path)) {
+        return false;
+    }
+    filename = path;
+
+    if (cache.pageCount() == 0) {
+        cache.allocate();
+        contactCount = 0;
+        maxId = 0;
+        heapPage = 0;
+        heapOffset = 0;
+        idTree = std::make_unique<BPlusTree>(cache);
+        nameTree = std::make_unique<BPlusTree>(cache);
+        phoneTree = std::make_unique<BPlusTree>(cache);
+        return writeHeader() && cache.flush();
+    }
+
+    if (!readHeader()) {
+        qDebug() << "Not a contact store file:" << path;
+        cache.close();
+        return false;
+    }
+    Contact::reserveId(maxId);
+    return true;
+}
+
+bool DiskContactStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.isOpen() && writeHeader() && cache.flush();
+}
+
+void DiskContactStore::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closeUnlocked();
+}
+
+void DiskContactStore::closeUnlocked() {
+    if (!cache.isOpen()) {
+        return;
+    }
+    writeHeader();
+    cache.close();
+    idTree.reset();
+    nameTree.reset();
+    phoneTree.reset();
+}
+
+bool DiskContactStore::readHeader() {
+    const PageCache::Page header = cache.read(0);
+    if (!header || memcmp(header->constData(), kStoreMagic, sizeof(kStoreMagic)) != 0) {
+        return false;
+    }
+
+    const char *p = header->constData();
+    if (qFromBigEndian<quint32>(p + 4) != kStoreFormatVersion ||
+        qFromBigEndian<quint32>(p + 8) != PageCache::kPageSize) {
+        return false;
+    }
+
+    const quint32 idRoot = qFromBigEndian<quint32>(p + 12);
+    const quint32 nameRoot = qFromBigEndian<quint32>(p + 16);
+    const quint32 phoneRoot = qFromBigEndian<quint32>(p + 20);
+    contactCount = static_cast<int>(qFromBigEndian<quint32>(p + 24));
+    maxId = static_cast<int>(qFromBigEndian<quint32>(p + 28));
+    heapPage = qFromBigEndian<quint32>(p + 32);
+    heapOffset = qFromBigEndian<quint32>(p + 36);
+
+    const quint32 pages = cache.pageCount();
+    if (idRoot >= pages || nameRoot >= pages || phoneRoot >= pages || heapPage >= pages ||
+        heapOffset > PageCache::kPageSize) {
+        return false;
+    }
+
+    idTree = std::make_unique<BPlusTree>(cache, idRoot);
+    nameTree = std::make_unique<BPlusTree>(cache, nameRoot);
+    phoneTree = std::make_unique<BPlusTree>(cache, phoneRoot);
+    return true;
+}
+
+bool DiskContactStore::writeHeader() {
+    const PageCache::Page header = cache.modify(0);
+    if (!header) {
+        return false;
+    }
+
+    char *p = header->data();
+    memcpy(p, kStoreMagic, sizeof(kStoreMagic));
+    qToBigEndian(kStoreFormatVersion, p + 4);
+    qToBigEndian(static_cast<quint32>(PageCache::kPageSize), p + 8);
+    qToBigEndian(idTree->root(), p + 12);
+    qToBigEndian(nameTree->root(), p + 16);
+    qToBigEndian(phoneTree->root(), p + 20);
+    qToBigEndian(static_cast<quint32>(contactCount), p + 24);
+    qToBigEndian(static_cast<quint32>(maxId), p + 28);
+    qToBigEndian(heapPage, p + 32);
+    qToBigEndian(heapOffset, p + 36);
+    return true;
+}
+
+QByteArray DiskContactStore::idKey(int id) {
+    QByteArray key(kIdKeySize, Qt::Uninitialized);
+    qToBigEndian(static_cast<quint32>(id), key.data());
+    return key;
+}
+
+QByteArray DiskContactStore::indexKey(const QString& text, int id) {
+    QByteArray key = text.toLower().toUtf8();
+    if (key.size() > kMaxIndexText) {
+        // Cut on a character boundary so the kept prefix is valid UTF-8
+        qsizetype size = kMaxIndexText;
+        while (size > 0 && (static_cast<uchar>(key[size]) & 0xC0) == 0x80) {
+            --size;
+        }
+        key.truncate(size);
+    }
+    return key + idKey(id);
+}
+
+int DiskContactStore::idOfIndexKey(const QByteArray& key) {
+    return static_cast<int>(qFromBigEndian<quint32>(key.constData() + key.size() - kIdKeySize));
+}
+
+bool DiskContactStore::mayBeTruncated(const QByteArray& key) {
+    // A cut can shorten the text by up to three bytes of a split character
+    return key.size() - kIdKeySize > kMaxIndexText - 4;
+}
+
+bool DiskContactStore::appendRecord(const QByteArray& record, quint64& offset) {
+    const qsizetype size = record.size();
+
+    if (heapPage != 0 && size <= PageCache::kPageSize - heapOffset) {
+        offset = static_cast<quint64>(heapPage) * PageCache::kPageSize + heapOffset;
+    } else {
+        // Pages allocated together are contiguous, so a long record spans
+        // several fresh pages
+        const quint32 count = static_cast<quint32>((size + PageCache::kPageSize - 1) /
+                                                   PageCache::kPageSize);
+        heapPage = cache.allocate(std::max<quint32>(1, count));
+        heapOffset = 0;
+        offset = static_cast<quint64>(heapPage) * PageCache::kPageSize;
+    }
+
+    qsizetype written = 0;
+    quint64 position = offset;
+    while (written < size) {
+        const quint32 page = static_cast<quint32>(position / PageCache::kPageSize);
+        const qsizetype at = position % PageCache::kPageSize;
+        const qsizetype chunk = std::min<qsizetype>(size - written, PageCache::kPageSize - at);
+        const PageCache::Page data = cache.modify(page);
+        if (!data) {
+            return false;
+        }
+        memcpy(data->data() + at, record.constData() + written, chunk);
+        written += chunk;
+        position += chunk;
+        heapPage = page;
+        heapOffset = static_cast<quint32>(at + chunk);
+    }
+    return true;
+}
+
+std::optional<Contact> DiskContactStore::readRecord(const QByteArray& location) const {
+    if (location.size() != kLocationSize) {
+        return std::nullopt;
+    }
+    quint64 position = qFromBigEndian<quint64>(location.constData());
+    const quint32 size = qFromBigEndian<quint32>(location.constData() + 8);
+
+    QByteArray record(size, Qt::Uninitialized);
+    qsizetype read = 0;
+    while (read < size) {
+        const quint32 page = static_cast<quint32>(position / PageCache::kPageSize);
+        const qsizetype at = position % PageCache::kPageSize;
+        const qsizetype chunk = std::min<qsizetype>(size - read, PageCache::kPageSize - at);
+        const PageCache::Page data = cache.read(page);
+        if (!data) {
+            return std::nullopt;
+        }
+        memcpy(record.data() + read, data->constData() + at, chunk);
+        read += chunk;
+        position += chunk;
+    }
+    return decodeRecord(record);
+}
+
+std::optional<Contact> DiskContactStore::readContact(int id) const {
+    QByteArray location;
+    if (!idTree->find(idKey(id), location)) {
+        return std::nullopt;
+    }
+    return readRecord(location);
+}
+
+bool DiskContactStore::writeRecord(const Contact& contact, QByteArray& location) {
+    const QByteArray record = encodeRecord(contact);
+    quint64 offset = 0;
+    if (!appendRecord(record, offset)) {
+        return false;
+    }
+
+    location.resize(kLocationSize);
+    qToBigEndian(offset, location.data());
+    qToBigEndian(static_cast<quint32>(record.size()), location.data() + 8);
+    return true;
+}
+
+bool DiskContactStore::insertUnlocked(const Contact& contact) {
+    const QByteArray key = idKey(contact.getId());
+    QByteArray location;
+    if (contact.getId() <= 0 || idTree->find(key, location) || !writeRecord(contact, location)) {
+        return false;
+    }
+
+    // Entries already inserted are taken out again when a later one fails,
+    // so the trees never disagree; the unreferenced record goes at compact()
+    const QByteArray nameKey = indexKey(contact.getName(), contact.getId());
+    const QByteArray phoneKey = indexKey(contact.getPhone(), contact.getId());
+    if (!idTree->insert(key, location)) {
+        return false;
+    }
+    if (!nameTree->insert(nameKey, QByteArray())) {
+        idTree->remove(key);
+        return false;
+    }
+    if (!phoneTree->insert(phoneKey, QByteArray())) {
+        nameTree->remove(nameKey);
+        idTree->remove(key);
+        return false;
+    }
+
+    ++contactCount;
+    maxId = std::max(maxId, contact.getId());
+    return true;
+}
+
+std::optional<Contact> DiskContactStore::removeUnlocked(int id) {
+    std::optional<Contact> removed = readContact(id);
+    if (!removed) {
+        return std::nullopt;
+    }
+
+    // The record itself stays in the heap until compact()
+    idTree->remove(idKey(id));
+    nameTree->remove(indexKey(removed->getName(), id));
+    phoneTree->remove(indexKey(removed->getPhone(), id));
+    --contactCount;
+    return removed;
+}
+
+bool DiskContactStore::addContact(const Contact& contact) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.isOpen() && insertUnlocked(contact);
+}
+
+bool DiskContactStore::removeContact(int id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.isOpen() && removeUnlocked(id).has_value();
+}
+
+bool DiskContactStore::updateContact(int id, const Contact& updatedContact) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cache.isOpen()) {
+        return false;
+    }
+    const QByteArray key = idKey(id);
+    QByteArray oldLocation;
+    if (!idTree->find(key, oldLocation)) {
+        return false;
+    }
+    const std::optional<Contact> existing = readRecord(oldLocation);
+    if (!existing) {
+        return false;
+    }
+
+    // Preserve the original ID and created date
+    Contact updated(updatedContact);
+    updated.setId(id);
+    updated.setCreated(existing->getCreated());
+
+    // The new record is written before any tree changes, and the old keys
+    // are only removed once every new entry is in, so a failure at any
+    // step leaves the old contact fully indexed
+    QByteArray location;
+    if (!writeRecord(updated, location) || !idTree->insert(key, location)) {
+        idTree->insert(key, oldLocation);
+        return false;
+    }
+
+    const QByteArray oldName = indexKey(existing->getName(), id);
+    const QByteArray oldPhone = indexKey(existing->getPhone(), id);
+    const QByteArray newName = indexKey(updated.getName(), id);
+    const QByteArray newPhone = indexKey(updated.getPhone(), id);
+    const bool nameChanged = newName != oldName;
+    const bool phoneChanged = newPhone != oldPhone;
+
+    if (nameChanged && !nameTree->insert(newName, QByteArray())) {
+        idTree->insert(key, oldLocation);
+        return false;
+    }
+    if (phoneChanged && !phoneTree->insert(newPhone, QByteArray())) {
+        if (nameChanged) {
+            nameTree->remove(newName);
+        }
+        idTree->insert(key, oldLocation);
+        return false;
+    }
+
+    if (nameChanged) {
+        nameTree->remove(oldName);
+    }
+    if (phoneChanged) {
+        phoneTree->remove(oldPhone);
+    }
+    return true;
+}
+
+std::optional<Contact> DiskContactStore::getContactById(int id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.isOpen() ? readContact(id) : std::nullopt;
+}
+
+bool DiskContactStore::phoneExists(const QString& phone, int excludeId) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.isOpen() && phoneExistsUnlocked(phone, excludeId);
+}
+
+bool DiskContactStore::phoneExistsUnlocked(const QString& phone, int excludeId) const {
+    // Every entry for this phone shares the text part of the key
+    const QByteArray prefix = indexKey(phone, 0).chopped(kIdKeySize);
+    bool exists = false;
+    phoneTree->scan(prefix, [&](const QByteArray& key, const QByteArray&) {
+        if (!key.startsWith(prefix)) {
+            return false;
+        }
+        // Longer numbers sharing the prefix may sort between the exact ones
+        exists = key.size() - kIdKeySize == prefix.size() && idOfIndexKey(key) != excludeId;
+        return !exists;
+    });
+    return exists;
+}
+
+std::vector<Contact> DiskContactStore::filterIndex(const BPlusTree& tree, const QString& term,
+                                                   bool (*matches)(const Contact&, const QString&)) const {
+    const QByteArray needle = term.toLower().toUtf8();
+    std::vector<int> ids;
+    tree.scan(QByteArray(), [&](const QByteArray& key, const QByteArray&) {
+        if (key.chopped(kIdKeySize).contains(needle) || mayBeTruncated(key)) {
+            ids.push_back(idOfIndexKey(key));
+        }
+        return true;
+    });
+
+    std::vector<Contact> results;
+    for (int id : ids) {
+        std::optional<Contact> contact = readContact(id);
+        if (contact && matches(*contact, term)) {
+            results.push_back(std::move(*contact));
+        }
+    }
+    return results;
+}
+
+std::vector<Contact> DiskContactStore::searchByName(const QString& searchTerm) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.isOpen() ? filterIndex(*nameTree, searchTerm, nameMatches) : std::vector<Contact>();
+}
+
+std::vector<Contact> DiskContactStore::searchByPhone(const QString& phoneNumber) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.isOpen() ? filterIndex(*phoneTree, phoneNumber, phoneMatches) : std::vector<Contact>();
+}
+
+std::vector<Contact> DiskContactStore::search(const ContactQuery& query, size_t limit,
+                                              size_t& total) const {
+    std::vector<Contact> results;
+    total = 0;
+    forEachSorted([&](const Contact& contact) {
+        if (query.matches(contact)) {
+            ++total;
+            if (limit == 0 || results.size() < limit) {
+                results.push_back(contact);
+            }
+        }
+        return true;
+    });
+    return results;
+}
+
+std::vector<Contact> DiskContactStore::searchByNamePrefix(const QString& prefix, int limit) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Contact> results;
+    if (!cache.isOpen()) {
+        return results;
+    }
+
+    const QByteArray start = indexKey(prefix, 0).chopped(kIdKeySize);
+    nameTree->scan(start, [&](const QByteArray& key, const QByteArray&) {
+        if (!key.startsWith(start) || (limit >= 0 && static_cast<int>(results.size()) >= limit)) {
+            return false;
+        }
+        if (std::optional<Contact> contact = readContact(idOfIndexKey(key))) {
+            results.push_back(std::move(*contact));
+        }
+        return true;
+    });
+    return results;
+}
+
+void DiskContactStore::forEachSorted(const ContactVisitor& visit) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cache.isOpen()) {
+        return;
+    }
+
+    nameTree->scan(QByteArray(), [&](const QByteArray& key, const QByteArray&) {
+        const std::optional<Contact> contact = readContact(idOfIndexKey(key));
+        return !contact || visit(*contact);
+    });
+}
+
+std::vector<Contact> DiskContactStore::getContactsSorted(int first, int count) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Contact> results;
+    if (!cache.isOpen() || count <= 0) {
+        return results;
+    }
+
+    // Rows before the window are counted on the name keys alone; only the
+    // records inside the window are read
+    int position = 0;
+    nameTree->scan(QByteArray(), [&](const QByteArray& key, const QByteArray&) {
+        if (position++ < first) {
+            return true;
+        }
+        if (std::optional<Contact> contact = readContact(idOfIndexKey(key))) {
+            results.push_back(std::move(*contact));
+        }
+        return static_cast<int>(results.size()) < count;
+    });
+    return results;
+}
+
+std::vector<Contact> DiskContactStore::getAllContactsSorted() const {
+    std::vector<Contact> results;
+    forEachSorted([&](const Contact& contact) {
+        results.push_back(contact);
+        return true;
+    });
+    return results;
+}
+
+int DiskContactStore::getContactCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return contactCount;
+}
+
+int DiskContactStore::getMaxId() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxId;
+}
+
+void DiskContactStore::setCacheBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.setBudget(bytes);
+}
+
+PageCache::Stats DiskContactStore::getCacheStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache.getStats();
+}
+
+bool DiskContactStore::compact() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cache.isOpen()) {
+        return false;
+    }
+
+    const QString compactPath = filename + ".compact";
+    QFile::remove(compactPath);
+
+    // Records are copied in ID order; the target has its own cache of the same budget
+    DiskContactStore target(cache.getStats().budgetPages * PageCache::kPageSize);
+    if (!target.openUnlocked(compactPath)) {
+        return false;
+    }
+
+    bool ok = true;
+    idTree->scan(QByteArray(), [&](const QByteArray&, const QByteArray& location) {
+        const std::optional<Contact> contact = readRecord(location);
+        ok = contact && target.insertUnlocked(*contact);
+        return ok;
+    });
+    target.closeUnlocked();
+
+    const QString path = filename;
+    if (!ok) {
+        QFile::remove(compactPath);
+        return false;
+    }
+
+    // Renamed over the old file, so a crash leaves either the old or the
+    // compacted store in place, never neither
+    closeUnlocked();
+    if (!replaceFile(compactPath, path)) {
+        qDebug() << "Cannot replace" << path << "with its compacted copy";
+        QFile::remove(compactPath);
+        openUnlocked(path);
+        return false;
+    }
+    return openUnlocked(path);
+}
+
+DiskContactStore::ImportResult DiskContactStore::importFile(const QString& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ImportResult result;
+    if (!cache.isOpen()) {
+        return result;
+    }
+
+    // Blocks are decoded and inserted one at a time, so only one block of
+    // contacts is ever in memory on top of the page cache
+    Timestamp::Batch clock;
+    bool written = true;
+    const bool read = ContactManager::readFileBlocks(path, [&](const QJsonArray& contacts) {
+        for (const auto& value : contacts) {
+            const QJsonObject obj = value.toObject();
+
+            // Phones stay unique, as on every other write path
+            if (phoneExistsUnlocked(ContactFields::value<ContactFields::Phone>(obj))) {
+                ++result.duplicatePhones;
+                continue;
+            }
+
+            // Reuse the stored ID so the store agrees with the source file
+            QByteArray location;
+            int id = obj["id"].toInt(-1);
+            if (id > 0 && !idTree->find(idKey(id), location)) {
+                Contact::reserveId(id);
+            } else {
+                id = Contact::allocateId();
+            }
+
+            // The ID is free, so a failed insert means the store could not be written
+            if (!insertUnlocked(ContactFields::fromJson(obj, id))) {
+                qDebug() << "Cannot write imported contacts to" << filename;
+                written = false;
+                return false;
+            }
+            ++result.imported;
+        }
+        return true;
+    });
+    result.complete = read && written;
+    return result;
+}
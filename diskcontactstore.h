@@ -0,0 +1,237 @@
+/**
+ * @file diskcontactstore.h
+ * @brief Disk-backed address book for archives larger than memory
+ *
+ * Contacts live in a single page file; only the pages in use are held in a
+ * PageCache with a fixed memory budget. The file holds:
+ * - Page 0: header with the tree roots and the record heap position
+ * - Record heap: serialized contacts appended to heap pages
+ * - B+tree by ID: ID -> record location
+ * - B+tree by name: lower-case name + ID, for name order and prefix scans
+ * - B+tree by phone: lower-case phone + ID, for duplicate checks
+ *
+ * The CRUD and search calls mirror ContactManager, so code written against
+ * the in-memory store works with only the hot working set resident. Name
+ * and phone substring searches filter the index keys and read only the
+ * records that match.
+ *
+ * Updates append a new record; compact() reclaims the old ones. Changes are
+ * durable after flush(); a crash between flushes can leave the file
+ * inconsistent.
+ */
+
+#ifndef DISKCONTACTSTORE_H
+#define DISKCONTACTSTORE_H
+
+#include "bplustree.h"
+#include "contact.h"
+#include "contactquery.h"
+#include "pagecache.h"
+#include <QString>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+class DiskContactStore {
+public:
+    static const size_t kDefaultCacheBytes = 64 * 1024 * 1024;
+
+    /// Suffix of store files; ContactServer serves these from disk
+    static constexpr const char* kFileSuffix = ".cds";
+
+    /**
+     * @brief Checks whether a path names a store file rather than a
+     * ContactManager snapshot
+     */
+    static bool isStoreFile(const QString& filename);
+
+    /**
+     * @brief Receives contacts in name order; return false to stop
+     */
+    using ContactVisitor = std::function<bool(const Contact& contact)>;
+
+    /**
+     * @param cacheBytes Memory budget of the page cache
+     */
+    explicit DiskContactStore(size_t cacheBytes = kDefaultCacheBytes);
+
+    /**
+     * @brief Flushes and closes the file
+     */
+    ~DiskContactStore();
+
+    /**
+     * @brief Opens a store file, creating an empty one if it does not exist
+     * @return false if the file cannot be opened or is not a store file
+     */
+    bool open(const QString& filename);
+
+    /**
+     * @brief Writes all modified pages and the header to the file
+     */
+    bool flush();
+
+    void close();
+
+    /**
+     * @brief Copies every live record to a fresh file and replaces the old one
+     * Reclaims the space of updated and removed contacts. The copy is
+     * renamed over the old file, so a crash keeps one complete store.
+     * Time Complexity: O(n log n)
+     */
+    bool compact();
+
+    /**
+     * @brief Outcome of importFile()
+     */
+    struct ImportResult {
+        int imported = 0;
+        int duplicatePhones = 0;    ///< Rows skipped because their phone is already stored
+        bool complete = false;      ///< false if the file could not be read or the store written
+    };
+
+    /**
+     * @brief Imports a JSON or CompressedBlocks file written by ContactManager
+     * Stored IDs are kept where they are free; rows whose phone is already
+     * stored are skipped. CompressedBlocks files are streamed through
+     * ContactManager::readFileBlocks(), so only one block of contacts is in
+     * memory at a time; a JSON file is parsed whole. Rows imported before a
+     * failure stay in the store.
+     */
+    ImportResult importFile(const QString& filename);
+
+    void setCacheBudget(size_t bytes);
+    PageCache::Stats getCacheStats() const;
+
+    /**
+     * @brief Checks if a phone number already exists
+     * Time Complexity: O(log n)
+     */
+    bool phoneExists(const QString& phone, int excludeId = -1) const;
+
+    /**
+     * @brief Adds a contact; fails if its ID is already stored
+     * Time Complexity: O(log n) page accesses
+     */
+    bool addContact(const Contact& contact);
+
+    /**
+     * @brief Removes a contact by ID
+     * Time Complexity: O(log n)
+     */
+    bool removeContact(int id);
+
+    /**
+     * @brief Replaces a contact, keeping its ID and created date
+     * Time Complexity: O(log n)
+     */
+    bool updateContact(int id, const Contact& updatedContact);
+
+    /**
+     * @brief Reads a contact by ID
+     * @return The stored contact, or nothing if the ID is unknown
+     * Time Complexity: O(log n)
+     */
+    std::optional<Contact> getContactById(int id) const;
+
+    /**
+     * @brief Searches contacts by name (partial match), in name order
+     * Time Complexity: O(n) over the name index, records read for matches only
+     */
+    std::vector<Contact> searchByName(const QString& searchTerm) const;
+
+    /**
+     * @brief Searches contacts by phone number (partial match)
+     * Time Complexity: O(n) over the phone index, records read for matches only
+     */
+    std::vector<Contact> searchByPhone(const QString& phoneNumber) const;
+
+    /**
+     * @brief Evaluates a query language search, in name order
+     * There are no secondary indexes to plan with, so every record is read
+     * and tested; only the results are held in memory.
+     * @param limit Maximum number of results kept, 0 for all
+     * @param total Receives the number of contacts matching
+     * Time Complexity: O(n) record reads
+     */
+    std::vector<Contact> search(const ContactQuery& query, size_t limit, size_t& total) const;
+
+    /**
+     * @brief Finds contacts whose name starts with prefix, in name order
+     * @param limit Maximum number of results, -1 for all
+     * Time Complexity: O(log n + k)
+     */
+    std::vector<Contact> searchByNamePrefix(const QString& prefix, int limit = -1) const;
+
+    /**
+     * @brief Gets one window of the contacts sorted by name
+     * Rows before first are skipped on the name index without reading
+     * their records.
+     * Time Complexity: O(first) index keys + O(count) record reads
+     */
+    std::vector<Contact> getContactsSorted(int first, int count) const;
+
+    /**
+     * @brief Visits every contact in name order without holding them all
+     * The visitor must not call back into the store.
+     */
+    void forEachSorted(const ContactVisitor& visit) const;
+
+    /**
+     * @brief Gets all contacts sorted by name
+     * Materializes the whole store; prefer forEachSorted() for large files.
+     */
+    std::vector<Contact> getAllContactsSorted() const;
+
+    int getContactCount() const;
+
+    /**
+     * @brief Largest ID ever stored, 0 for an empty store
+     */
+    int getMaxId() const;
+
+private:
+    mutable std::mutex mutex;               ///< Serializes all access, reads move the cache too
+    mutable PageCache cache;
+    std::unique_ptr<BPlusTree> idTree;
+    std::unique_ptr<BPlusTree> nameTree;
+    std::unique_ptr<BPlusTree> phoneTree;
+    QString filename;
+
+    int contactCount = 0;
+    int maxId = 0;
+    quint32 heapPage = 0;                   ///< Page records are appended to, 0 if none yet
+    quint32 heapOffset = 0;                 ///< First free byte of heapPage
+
+    bool openUnlocked(const QString& path);
+    void closeUnlocked();
+    bool readHeader();
+    bool writeHeader();
+
+    static QByteArray idKey(int id);
+    static QByteArray indexKey(const QString& text, int id);
+    static int idOfIndexKey(const QByteArray& key);
+    static bool mayBeTruncated(const QByteArray& key);
+
+    bool phoneExistsUnlocked(const QString& phone, int excludeId = -1) const;
+    bool appendRecord(const QByteArray& record, quint64& offset);
+
+    /**
+     * @brief Appends a contact's record and fills in its ID-tree location
+     */
+    bool writeRecord(const Contact& contact, QByteArray& location);
+    std::optional<Contact> readRecord(const QByteArray& location) const;
+    std::optional<Contact> readContact(int id) const;
+    bool insertUnlocked(const Contact& contact);
+    std::optional<Contact> removeUnlocked(int id);
+
+    /**
+     * @brief Collects contacts whose index entry matches, in key order
+     */
+    std::vector<Contact> filterIndex(const BPlusTree& tree, const QString& term,
+                                     bool (*matches)(const Contact&, const QString&)) const;
+};
+
+#endif // DISKCONTACTSTORE_H
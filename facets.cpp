@@ -0,0 +1,171 @@
+/**
+ * @file facets.cpp
+ * @brief Implementation of the facet group keys
+ */
+
+#include "facets.h"
+#include <set>
+#include <vector>
+
+namespace {
+
+inline bool isAsciiDigit(char16_t ch) {
+    return ch >= u'0' && ch <= u'9';
+}
+
+// The two-digit ITU calling codes; any other code not starting with 1 or 7
+// has three digits
+bool isTwoDigitCode(int code) {
+    switch (code) {
+    case 20: case 27:
+    case 30: case 31: case 32: case 33: case 34: case 36: case 39:
+    case 40: case 41: case 43: case 44: case 45: case 46: case 47: case 48: case 49:
+    case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 58:
+    case 60: case 61: case 62: case 63: case 64: case 65: case 66:
+    case 81: case 82: case 84: case 86:
+    case 90: case 91: case 92: case 93: case 94: case 95: case 98:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Drops a trailing postal code ("Pune 411001", "Pune - 411001")
+QStringView stripPostalCode(QStringView part) {
+    qsizetype end = part.size();
+    while (end > 0) {
+        const char16_t ch = part[end - 1].unicode();
+        if (!isAsciiDigit(ch) && ch != u' ' && ch != u'-') {
+            break;
+        }
+        --end;
+    }
+    return part.left(end).trimmed();
+}
+
+// Countries and Indian states/territories that end addresses. Territories
+// named after their capital (Delhi, Chandigarh, Puducherry) are left out:
+// they are the city too.
+const std::set<QString>& regionNames() {
+    static const std::set<QString> names = {
+        "india", "bharat", "usa", "u.s.a.", "united states", "united states of america",
+        "uk", "u.k.", "united kingdom", "england", "canada", "australia", "germany",
+        "france", "singapore", "uae", "united arab emirates", "nepal", "sri lanka",
+        "bangladesh", "pakistan", "china", "japan",
+        "andhra pradesh", "arunachal pradesh", "assam", "bihar", "chhattisgarh", "goa",
+        "gujarat", "haryana", "himachal pradesh", "jharkhand", "karnataka", "kerala",
+        "madhya pradesh", "maharashtra", "manipur", "meghalaya", "mizoram", "nagaland",
+        "odisha", "orissa", "punjab", "rajasthan", "sikkim", "tamil nadu", "telangana",
+        "tripura", "uttar pradesh", "uttarakhand", "west bengal", "jammu and kashmir",
+        "ladakh", "lakshadweep", "andaman and nicobar islands"
+    };
+    return names;
+}
+
+// A country or state, by name or as a two-letter upper-case code ("IL", "MH")
+bool isRegion(QStringView part) {
+    if (part.size() == 2 && part[0].unicode() >= u'A' && part[0].unicode() <= u'Z' &&
+        part[1].unicode() >= u'A' && part[1].unicode() <= u'Z') {
+        return true;
+    }
+    return regionNames().count(part.toString().toLower()) > 0;
+}
+
+} // namespace
+
+QString Facets::key(Kind kind, const Contact& contact) {
+    switch (kind) {
+    case EmailDomain: return emailDomain(contact.getEmail());
+    case CountryCode: return countryCode(contact.getPhone());
+    case City:        return city(contact.getAddress());
+    }
+    return QString();
+}
+
+QString Facets::emailDomain(QStringView email) {
+    const qsizetype at = email.lastIndexOf(u'@');
+    if (at < 0) {
+        return QString();
+    }
+    return email.mid(at + 1).trimmed().toString().toLower();
+}
+
+QString Facets::countryCode(QStringView phone) {
+    phone = phone.trimmed();
+
+    qsizetype pos;
+    if (phone.startsWith(u'+')) {
+        pos = 1;
+    } else if (phone.startsWith(u"00")) {
+        pos = 2;
+    } else {
+        return QString();
+    }
+
+    // Up to three digits, skipping separators such as "+1 (415)"
+    char16_t digits[3];
+    int count = 0;
+    for (; pos < phone.size() && count < 3; ++pos) {
+        const char16_t ch = phone[pos].unicode();
+        if (isAsciiDigit(ch)) {
+            digits[count++] = ch;
+        }
+    }
+    if (count == 0 || digits[0] == u'0') {
+        return QString();
+    }
+
+    int length = 3;
+    if (digits[0] == u'1' || digits[0] == u'7') {
+        length = 1;
+    } else if (count >= 2 && isTwoDigitCode((digits[0] - u'0') * 10 + (digits[1] - u'0'))) {
+        length = 2;
+    }
+    if (count < length) {
+        return QString();
+    }
+    return QString(reinterpret_cast<const QChar*>(digits), length);
+}
+
+QString Facets::city(QStringView address) {
+    std::vector<QStringView> parts;
+    for (QStringView part : address.split(u',')) {
+        part = stripPostalCode(part.trimmed());
+        if (!part.isEmpty()) {
+            parts.push_back(part);
+        }
+    }
+
+    // "MG Road, Pune, Maharashtra 411001, India": drop the country and the
+    // state, then the city is what is left at the end
+    bool droppedRegion = false;
+    while (parts.size() > 1 && isRegion(parts.back())) {
+        parts.pop_back();
+        droppedRegion = true;
+    }
+
+    // A lone part with nothing after it is a street, not a city
+    if (parts.empty() || (parts.size() < 2 && !droppedRegion)) {
+        return QString();
+    }
+    return parts.back().toString().toLower();
+}
+
+QString Facets::name(Kind kind) {
+    switch (kind) {
+    case EmailDomain: return "domain";
+    case CountryCode: return "country";
+    case City:        return "city";
+    }
+    return QString();
+}
+
+bool Facets::fromName(const QString& name, Kind& kind) {
+    for (int i = 0; i < kKindCount; ++i) {
+        if (name == Facets::name(static_cast<Kind>(i))) {
+            kind = static_cast<Kind>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file facets.h
+ * @brief Group keys for faceted counts: email domain, country code, city
+ *
+ * Each facet reduces a contact to one normalized key, or to an empty
+ * string if the contact has no value for it. ContactManager keeps a
+ * posting set per key, so group counts are read in O(groups) and facet
+ * terms in queries (domain=acme.com, country=91, city=pune) are index
+ * lookups.
+ */
+
+#ifndef FACETS_H
+#define FACETS_H
+
+#include "contact.h"
+#include <QString>
+#include <QStringView>
+
+class Facets {
+public:
+    enum Kind {
+        EmailDomain,
+        CountryCode,
+        City
+    };
+
+    static constexpr int kKindCount = 3;
+
+    /**
+     * @brief Group key of a contact for one facet
+     * @return Lower-case key, empty if the contact has no value
+     */
+    static QString key(Kind kind, const Contact& contact);
+
+    /**
+     * @brief Part after the '@', lower-cased
+     * Time Complexity: O(m)
+     */
+    static QString emailDomain(QStringView email);
+
+    /**
+     * @brief Calling code of an international number, without the '+'
+     * Only numbers written with '+' or '00' carry a country code. Calling
+     * codes are prefix-free, so the code length follows from its first
+     * digits: 1 and 7 are one digit, the ITU's two-digit codes are listed
+     * and everything else has three.
+     * Time Complexity: O(m)
+     */
+    static QString countryCode(QStringView phone);
+
+    /**
+     * @brief City part of a free-form address, lower-cased
+     * The address is split at commas and postal codes are stripped. Trailing
+     * countries and states (known names or two-letter codes such as "IL")
+     * are dropped and the city is the last part left, so "Flat 4B, MG Road,
+     * Pune" gives "pune". A single part with nothing dropped has no city.
+     * Time Complexity: O(m)
+     */
+    static QString city(QStringView address);
+
+    /**
+     * @brief Name used in queries and reports: "domain", "country", "city"
+     */
+    static QString name(Kind kind);
+
+    /**
+     * @brief Looks up a facet by its name()
+     */
+    static bool fromName(const QString& name, Kind& kind);
+};
+
+#endif // FACETS_H
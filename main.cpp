@@ -1,12 +1,182 @@
 #include "mainwindow.h"
+#include "contactclient.h"
+#include "contactprotocol.h"
+#include "contactserver.h"
+#include "diskcontactstore.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QThread>
+#include <cstring>
 
-int main(int argc, char *argv[]) {
-    QApplication app(argc, argv);
+namespace {
 
+void setApplicationInfo(QCoreApplication& app) {
     app.setApplicationName("Contact Management System");
     app.setApplicationVersion("1.0.0");
     app.setOrganizationName("DSA Project");
+}
+
+bool isHeadless(int argc, char *argv[]) {
+    // Every option of the command-line modes, given as --opt or --opt=value
+    static const char* const options[] = {
+        "server", "bench", "verify", "repair", "import", "output", "name", "data",
+        "workers", "connections", "requests", "pipeline"
+    };
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--", 2) != 0) {
+            continue;
+        }
+        const char* arg = argv[i] + 2;
+        for (const char* option : options) {
+            const size_t length = std::strlen(option);
+            if (std::strncmp(arg, option, length) == 0 && (arg[length] == '\0' || arg[length] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Prints an integrity report, returns the process exit code
+ */
+int printIntegrity(QTextStream& out, const ContactManager::IntegrityReport& report) {
+    out << "format:     " << (!report.readable ? "unknown"
+                              : report.checksummed ? "checksummed blocks" : "unchecked") << "\n"
+        << "blocks:     " << report.intactBlocks << " of " << report.blocks << " intact\n"
+        << "contacts:   " << report.contacts << "\n";
+    if (!report.error.isEmpty()) {
+        out << "error:      " << report.error << "\n";
+    }
+    return report.isIntact() ? 0 : 1;
+}
+
+/**
+ * @brief Runs the query server, the load generator or a file tool without a GUI
+ */
+int runHeadless(QCoreApplication& app) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Contact Management System server and file tools");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    const QString dataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QCommandLineOption serverOption("server", "Serve the address book to local clients.");
+    QCommandLineOption benchOption("bench", "Load-test a running server.");
+    QCommandLineOption nameOption("name", "Server name.", "name", ContactProtocol::kDefaultServerName);
+    QCommandLineOption dataOption("data", "Contacts file served; .json files are kept as JSON, "
+                                  ".cds stores are served from disk.",
+                                  "file", QDir(dataDir).filePath("contacts_data.cmz"));
+    QCommandLineOption workersOption("workers", "Server worker threads.", "count",
+                                     QString::number(QThread::idealThreadCount()));
+    QCommandLineOption connectionsOption("connections", "Concurrent bench clients.", "count", "8");
+    QCommandLineOption requestsOption("requests", "Requests per bench client.", "count", "10000");
+    QCommandLineOption pipelineOption("pipeline", "Requests in flight per bench client.", "count", "16");
+    QCommandLineOption verifyOption("verify", "Check a contacts file against its checksums.", "file");
+    QCommandLineOption repairOption("repair", "Copy the intact blocks of a damaged contacts file.", "file");
+    QCommandLineOption importOption("import", "Copy a contacts file into a disk-backed .cds store.", "file");
+    QCommandLineOption outputOption("output", "Repaired file, default <file>.repaired; "
+                                    "imported store, default <file>.cds.", "file");
+    parser.addOptions({serverOption, benchOption, nameOption, dataOption, workersOption,
+                       connectionsOption, requestsOption, pipelineOption,
+                       verifyOption, repairOption, importOption, outputOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+
+    if (parser.isSet(verifyOption)) {
+        return printIntegrity(out, ContactManager::verifyFile(parser.value(verifyOption)));
+    }
+
+    if (parser.isSet(repairOption)) {
+        const QString input = parser.value(repairOption);
+        const QString output = parser.isSet(outputOption) ? parser.value(outputOption)
+                                                          : input + ".repaired";
+        const ContactManager::IntegrityReport report = ContactManager::repairFile(input, output);
+        printIntegrity(out, report);
+        if (report.intactBlocks == 0 || !report.readable) {
+            return 1;
+        }
+        out << "written:    " << output << "\n";
+        return 0;
+    }
+
+    if (parser.isSet(importOption)) {
+        const QString input = parser.value(importOption);
+        const QFileInfo info(input);
+        const QString output = parser.isSet(outputOption)
+            ? parser.value(outputOption)
+            : info.dir().filePath(info.completeBaseName() + DiskContactStore::kFileSuffix);
+        DiskContactStore store;
+        if (!store.open(output)) {
+            out << "Cannot open " << output << "\n";
+            return 1;
+        }
+        const DiskContactStore::ImportResult result = store.importFile(input);
+        const bool flushed = store.flush();
+        out << "imported:   " << result.imported << "\n"
+            << "duplicates: " << result.duplicatePhones << " skipped (phone already stored)\n"
+            << "contacts:   " << store.getContactCount() << "\n";
+        if (!result.complete || !flushed) {
+            out << "error:      the import stopped early; " << output << " holds the rows before it\n";
+            return 1;
+        }
+        out << "written:    " << output << "\n";
+        return 0;
+    }
+    const QString name = parser.value(nameOption);
+
+    if (parser.isSet(benchOption)) {
+        const ContactClient::LoadReport report = ContactClient::runLoad(
+            name, parser.value(connectionsOption).toInt(),
+            parser.value(requestsOption).toInt(), parser.value(pipelineOption).toInt());
+
+        out << "requests:   " << report.requests << "\n"
+            << "errors:     " << report.errors << "\n"
+            << "seconds:    " << report.seconds << "\n"
+            << "throughput: " << qRound64(report.requestsPerSecond) << " req/s\n"
+            << "latency:    p50 " << report.p50Ms << " ms, p99 " << report.p99Ms
+            << " ms, max " << report.maxMs << " ms\n";
+        return report.requests > 0 && report.errors == 0 ? 0 : 1;
+    }
+
+    QDir().mkpath(dataDir);
+    ContactServer server(parser.isSet(dataOption) ? parser.value(dataOption)
+                                                  : ContactManager::dataFileIn(dataDir));
+    if (!server.isReady()) {
+        out << "Cannot load the data file; it was left untouched.\n";
+        if (!server.damagedCopy().isEmpty()) {
+            out << "A copy was kept as " << server.damagedCopy()
+                << "; run --repair on it to recover its intact contacts.\n";
+        }
+        return 1;
+    }
+    server.setWorkerCount(parser.value(workersOption).toInt());
+    if (!server.listen(name)) {
+        out << "Cannot listen on " << name << ": " << server.errorString() << "\n";
+        return 1;
+    }
+    out << "Serving " << server.contactCount() << " contacts on " << name << "\n";
+    out.flush();
+    return app.exec();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (isHeadless(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        setApplicationInfo(app);
+        return runHeadless(app);
+    }
+
+    QApplication app(argc, argv);
+    setApplicationInfo(app);
 
     MainWindow window;
     window.show();
@@ -5,30 +5,60 @@
 
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
+#include "contactfields.h"
 #include <QFileDialog>
 #include <QStandardPaths>
 #include <QDir>
 #include <QCloseEvent>
 #include <QDebug>
+#include <QFileInfo>
+#include <QHeaderView>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+// Contacts shown from the page file before the full store is loaded
+const int kFirstPageSize = 200;
+
+// Most relevant contacts shown by a notes and address search
+const size_t kMaxTextHits = 200;
+
+// Header clicks keep at most this many columns in the ordering
+const size_t kMaxSortKeys = 3;
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , contactManager(new ContactManager())
-    , currentSortOption(SortByNameAsc) {  // Default sort by name
+    , sortKeys(ContactManager::sortKeysFor(ContactManager::SortByNameAsc))  // Default sort by name
+    , loadingContacts(false)
+    , firstPaintReported(false) {
+    startupTimer.start();
     ui->setupUi(this);
 
     // Set up the data file path
     dataFilePath = getDefaultDataPath();
+    pageFilePath = QFileInfo(dataFilePath).absolutePath() + "/contacts_data.pages";
 
     setupUI();
     loadStyleSheet();
+
+    // Show the first page right away, load everything else in the background
+    showFirstPage();
     autoLoadContacts();
-    onRefreshTable();
 }
 
 MainWindow::~MainWindow() {
-    autoSaveContacts();
+    if (loadingContacts) {
+        // Nothing was changed while loading, so there is nothing to save
+        loadWatcher.waitForFinished();
+        delete loadWatcher.result();
+    } else {
+        autoSaveContacts();
+    }
     delete contactManager;
     delete ui;
 }
@@ -39,31 +69,129 @@ QString MainWindow::getDefaultDataPath() {
     if (!dir.exists(dataDir)) {
         dir.mkpath(dataDir);
     }
-    return dataDir + "/contacts_data.json";
+    return ContactManager::dataFileIn(dataDir);
+}
+
+void MainWindow::showFirstPage() {
+    QFileInfo dataInfo(dataFilePath);
+    QFileInfo pageInfo(pageFilePath);
+
+    // The page file is rewritten after every save; an older one is stale
+    if (!dataInfo.exists() || !pageInfo.exists() ||
+        pageInfo.lastModified() < dataInfo.lastModified()) {
+        return;
+    }
+
+    std::vector<Contact> firstPage;
+    int totalCount = 0;
+    if (ContactManager::readPage(pageFilePath, 0, firstPage, totalCount)) {
+        populateTable(firstPage);
+        ui->statusLabel->setText(QString("Showing %1 of %2 contacts, loading...")
+                                     .arg(firstPage.size())
+                                     .arg(totalCount));
+    }
 }
 
 void MainWindow::autoLoadContacts() {
     QFile file(dataFilePath);
-    if (file.exists()) {
-        if (contactManager->loadFromFile(dataFilePath)) {
-            qDebug() << "Contacts loaded successfully from:" << dataFilePath;
-            ui->statusLabel->setText(
-                QString("Loaded %1 contacts").arg(contactManager->getContactCount())
-                );
-        } else {
-            qDebug() << "Failed to load contacts from:" << dataFilePath;
+    if (!file.exists()) {
+        qDebug() << "No existing data file found. Starting fresh.";
+        onRefreshTable();
+        return;
+    }
+
+    setLoading(true);
+
+    // Parsing and index building run on a worker thread into a separate
+    // manager, which replaces the empty one once it is complete
+    const QString path = dataFilePath;
+    loadWatcher.setFuture(QtConcurrent::run([this, path]() -> ContactManager* {
+        auto *loaded = new ContactManager();
+        auto progress = [this](int count, int total) {
+            QMetaObject::invokeMethod(this, [this, count, total]() {
+                ui->statusLabel->setText(
+                    QString("Loading contacts... %1 of %2").arg(count).arg(total));
+            }, Qt::QueuedConnection);
+        };
+
+        if (!loaded->loadFromFile(path, progress)) {
+            delete loaded;
+            return nullptr;
         }
+        return loaded;
+    }));
+}
+
+void MainWindow::onContactsLoaded() {
+    ContactManager *loaded = loadWatcher.result();
+    setLoading(false);
+
+    if (loaded) {
+        delete contactManager;
+        contactManager = loaded;
+        qDebug() << "Contacts loaded successfully from:" << dataFilePath
+                 << "in" << startupTimer.elapsed() << "ms";
     } else {
-        qDebug() << "No existing data file found. Starting fresh.";
+        qDebug() << "Failed to load contacts from:" << dataFilePath;
+
+        // Keep the damaged file aside before the next autosave replaces it
+        const QString damagedPath = ContactManager::keepDamagedFile(dataFilePath);
+        QMessageBox::warning(this, "Damaged Data File",
+                             QString("The contacts file could not be read and was copied to\n%1\n\n"
+                                     "Run the application with --repair on that file to recover "
+                                     "its intact contacts.").arg(damagedPath));
+    }
+
+    applySorting();
+}
+
+void MainWindow::setLoading(bool loading) {
+    loadingContacts = loading;
+
+    // Mutations and searches wait for the full store and its indexes
+    ui->addButton->setEnabled(!loading);
+    ui->searchButton->setEnabled(!loading);
+    ui->clearSearchButton->setEnabled(!loading);
+    ui->refreshButton->setEnabled(!loading);
+    ui->importButton->setEnabled(!loading);
+    ui->exportButton->setEnabled(!loading);
+    ui->sortComboBox->setEnabled(!loading);
+    onTableSelectionChanged();
+    updateUndoButtons();
+}
+
+void MainWindow::paintEvent(QPaintEvent *event) {
+    QMainWindow::paintEvent(event);
+
+    if (!firstPaintReported) {
+        firstPaintReported = true;
+        qDebug() << "Time to first paint:" << startupTimer.elapsed() << "ms";
     }
 }
 
 void MainWindow::autoSaveContacts() {
-    if (contactManager->saveToFile(dataFilePath)) {
+    if (loadingContacts) {
+        return;
+    }
+
+    // Checksummed blocks unless the data file is still a .json, so a
+    // damaged data file is detected on load
+    if (contactManager->saveToFile(dataFilePath, ContactManager::formatForFile(dataFilePath))) {
         qDebug() << "Contacts saved successfully to:" << dataFilePath;
     } else {
         qDebug() << "Failed to save contacts to:" << dataFilePath;
     }
+
+    // Saved next to the snapshot so the next start does not re-tokenize notes
+    if (!contactManager->saveTextIndex(ContactManager::textIndexPath(dataFilePath))) {
+        qDebug() << "Failed to save full-text index for:" << dataFilePath;
+    }
+
+    // Persist the name-sorted first page for the next fast startup; it is
+    // the only page read back
+    if (!contactManager->savePageFile(pageFilePath, kFirstPageSize, 1)) {
+        qDebug() << "Failed to save page file to:" << pageFilePath;
+    }
 }
 
 void MainWindow::closeEvent(QCloseEvent *event) {
@@ -76,10 +204,11 @@ void MainWindow::setupUI() {
     resize(1000, 600);
 
     // Add sort options to the combo box
-    ui->sortComboBox->addItem("Sort by Name (A-Z)", SortByNameAsc);
-    ui->sortComboBox->addItem("Sort by Name (Z-A)", SortByNameDesc);
-    ui->sortComboBox->addItem("Sort by ID (Low-High)", SortByIDAsc);
-    ui->sortComboBox->addItem("Sort by ID (High-Low)", SortByIDDesc);
+    ui->sortComboBox->addItem("Sort by Name (A-Z)", ContactManager::SortByNameAsc);
+    ui->sortComboBox->addItem("Sort by Name (Z-A)", ContactManager::SortByNameDesc);
+    ui->sortComboBox->addItem("Sort by ID (Low-High)", ContactManager::SortByIDAsc);
+    ui->sortComboBox->addItem("Sort by ID (High-Low)", ContactManager::SortByIDDesc);
+    ui->sortComboBox->addItem("Sort by Recently Modified", ContactManager::SortByModifiedDesc);
     ui->sortComboBox->setCurrentIndex(0);  // Default to Name A-Z
 
     // Connect signals and slots
@@ -88,6 +217,10 @@ void MainWindow::setupUI() {
     connect(ui->deleteButton, &QPushButton::clicked, this, &MainWindow::onDeleteContact);
     connect(ui->searchButton, &QPushButton::clicked, this, &MainWindow::onSearchContact);
     connect(ui->refreshButton, &QPushButton::clicked, this, &MainWindow::onRefreshTable);
+    connect(ui->undoButton, &QPushButton::clicked, this, &MainWindow::onUndo);
+    connect(ui->redoButton, &QPushButton::clicked, this, &MainWindow::onRedo);
+    ui->undoButton->setShortcut(QKeySequence::Undo);
+    ui->redoButton->setShortcut(QKeySequence::Redo);
     connect(ui->viewButton, &QPushButton::clicked, this, &MainWindow::onViewDetails);
     connect(ui->exportButton, &QPushButton::clicked, this, &MainWindow::onExportContacts);
     connect(ui->importButton, &QPushButton::clicked, this, &MainWindow::onImportContacts);
@@ -96,12 +229,22 @@ void MainWindow::setupUI() {
             this, &MainWindow::onTableSelectionChanged);
     connect(ui->sortComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
             this, &MainWindow::onSortChanged);
+    connect(ui->contactTable->horizontalHeader(), &QHeaderView::sectionClicked,
+            this, &MainWindow::onHeaderClicked);
+    connect(&loadWatcher, &QFutureWatcher<ContactManager*>::finished,
+            this, &MainWindow::onContactsLoaded);
 
     // Configure table
-    ui->contactTable->setColumnCount(5);
-    ui->contactTable->setHorizontalHeaderLabels(
-        {"ID", "Name", "Phone", "Email", "Address"});
+    QStringList headers;
+    ContactFields::Columns::forEach([&headers](auto field) {
+        headers << decltype(field)::label;
+    });
+    ui->contactTable->setColumnCount(ContactFields::Columns::size);
+    ui->contactTable->setHorizontalHeaderLabels(headers);
     ui->contactTable->horizontalHeader()->setStretchLastSection(true);
+    ui->contactTable->horizontalHeader()->setSectionsClickable(true);
+    ui->contactTable->horizontalHeader()->setSortIndicatorShown(true);
+    updateSortIndicator();
     ui->contactTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     ui->contactTable->setSelectionMode(QAbstractItemView::SingleSelection);
     ui->contactTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
@@ -120,42 +263,78 @@ void MainWindow::loadStyleSheet() {
 }
 
 void MainWindow::onSortChanged(int index) {
-    currentSortOption = static_cast<SortOption>(ui->sortComboBox->itemData(index).toInt());
+    sortKeys = ContactManager::sortKeysFor(
+        static_cast<ContactManager::SortOrder>(ui->sortComboBox->itemData(index).toInt()));
+    updateSortIndicator();
     applySorting();
 }
 
 void MainWindow::applySorting() {
-    std::vector<Contact> contacts = contactManager->getAllContactsSorted();
+    populateTable(contactManager->getContactsSorted(sortKeys));
+
+    // Every mutation ends by refreshing the table
+    updateUndoButtons();
+}
 
-    // Apply the selected sort option
-    switch (currentSortOption) {
-    case SortByNameAsc:
-        // Already sorted by name ascending in getAllContactsSorted()
-        break;
+void MainWindow::onUndo() {
+    const QString label = contactManager->undoLabel();
+    if (loadingContacts || !contactManager->undo()) {
+        return;
+    }
+    autoSaveContacts();
+    applySorting();
+    ui->statusLabel->setText(QString("Undid: %1").arg(label));
+}
+
+void MainWindow::onRedo() {
+    const QString label = contactManager->redoLabel();
+    if (loadingContacts || !contactManager->redo()) {
+        return;
+    }
+    autoSaveContacts();
+    applySorting();
+    ui->statusLabel->setText(QString("Redid: %1").arg(label));
+}
 
-    case SortByNameDesc:
-        std::sort(contacts.begin(), contacts.end(),
-                  [](const Contact& a, const Contact& b) {
-                      return a.getName().toLower() > b.getName().toLower();
-                  });
-        break;
+void MainWindow::updateUndoButtons() {
+    const bool idle = !loadingContacts;
+    ui->undoButton->setEnabled(idle && contactManager->canUndo());
+    ui->redoButton->setEnabled(idle && contactManager->canRedo());
+    ui->undoButton->setToolTip(contactManager->canUndo() ? "Undo " + contactManager->undoLabel() : QString());
+    ui->redoButton->setToolTip(contactManager->canRedo() ? "Redo " + contactManager->redoLabel() : QString());
+}
 
-    case SortByIDAsc:
-        std::sort(contacts.begin(), contacts.end(),
-                  [](const Contact& a, const Contact& b) {
-                      return a.getId() < b.getId();
-                  });
-        break;
+void MainWindow::onHeaderClicked(int section) {
+    const auto column = static_cast<ContactSorter::Column>(section);
 
-    case SortByIDDesc:
-        std::sort(contacts.begin(), contacts.end(),
-                  [](const Contact& a, const Contact& b) {
-                      return a.getId() > b.getId();
-                  });
-        break;
+    // Clicking the primary column flips it; any other column becomes the
+    // primary key and the previous keys break ties
+    if (!sortKeys.empty() && sortKeys.front().column == column) {
+        sortKeys.front().descending = !sortKeys.front().descending;
+    } else {
+        sortKeys.erase(std::remove_if(sortKeys.begin(), sortKeys.end(),
+                                      [column](const ContactSorter::Key& key) {
+                                          return key.column == column;
+                                      }),
+                       sortKeys.end());
+        sortKeys.insert(sortKeys.begin(), {column, false});
+        if (sortKeys.size() > kMaxSortKeys) {
+            sortKeys.resize(kMaxSortKeys);
+        }
     }
 
-    populateTable(contacts);
+    updateSortIndicator();
+    applySorting();
+}
+
+void MainWindow::updateSortIndicator() {
+    QHeaderView *header = ui->contactTable->horizontalHeader();
+    if (sortKeys.empty() || sortKeys.front().column >= ContactFields::Columns::size) {
+        header->setSortIndicator(-1, Qt::AscendingOrder);
+        return;
+    }
+    header->setSortIndicator(sortKeys.front().column,
+                             sortKeys.front().descending ? Qt::DescendingOrder : Qt::AscendingOrder);
 }
 
 void MainWindow::populateTable(const std::vector<Contact>& contacts) {
@@ -165,11 +344,11 @@ void MainWindow::populateTable(const std::vector<Contact>& contacts) {
         int row = ui->contactTable->rowCount();
         ui->contactTable->insertRow(row);
 
-        ui->contactTable->setItem(row, 0, new QTableWidgetItem(QString::number(contact.getId())));
-        ui->contactTable->setItem(row, 1, new QTableWidgetItem(contact.getName()));
-        ui->contactTable->setItem(row, 2, new QTableWidgetItem(contact.getPhone()));
-        ui->contactTable->setItem(row, 3, new QTableWidgetItem(contact.getEmail()));
-        ui->contactTable->setItem(row, 4, new QTableWidgetItem(contact.getAddress()));
+        int column = 0;
+        ContactFields::Columns::forEach([&](auto field) {
+            ui->contactTable->setItem(row, column++,
+                                      new QTableWidgetItem(decltype(field)::display(contact)));
+        });
     }
 
     ui->statusLabel->setText(QString("Total Contacts: %1").arg(contacts.size()));
@@ -186,7 +365,7 @@ void MainWindow::onAddContact() {
             return;
         }
 
-        if (contactManager->addContact(newContact)) {
+        if (contactManager->addContact(std::move(newContact))) {
             autoSaveContacts();
             QMessageBox::information(this, "Success", "Contact added successfully!");
             applySorting();  // Use applySorting instead of onRefreshTable
@@ -202,21 +381,24 @@ void MainWindow::onEditContact() {
         return;
     }
 
-    Contact selectedContact = getSelectedContact();
+    const Contact *selectedContact = getSelectedContact();
+    if (!selectedContact) {
+        return;
+    }
+    const int id = selectedContact->getId();
     AddDialog dialog(this, true);
-    dialog.setContact(selectedContact);
+    dialog.setContact(*selectedContact);
 
     if (dialog.exec() == QDialog::Accepted) {
         Contact updatedContact = dialog.getContact();
 
-        if (contactManager->phoneExists(updatedContact.getPhone(),
-                                        selectedContact.getId())) {
+        if (contactManager->phoneExists(updatedContact.getPhone(), id)) {
             QMessageBox::warning(this, "Duplicate Contact",
                                  "Another contact with this phone number already exists!");
             return;
         }
 
-        if (contactManager->updateContact(selectedContact.getId(), updatedContact)) {
+        if (contactManager->updateContact(id, std::move(updatedContact))) {
             autoSaveContacts();
             QMessageBox::information(this, "Success", "Contact updated successfully!");
             applySorting();  // Use applySorting instead of onRefreshTable
@@ -232,16 +414,20 @@ void MainWindow::onDeleteContact() {
         return;
     }
 
-    Contact selectedContact = getSelectedContact();
+    const Contact *selectedContact = getSelectedContact();
+    if (!selectedContact) {
+        return;
+    }
+    const int id = selectedContact->getId();
 
     QMessageBox::StandardButton reply = QMessageBox::question(
         this, "Confirm Delete",
-        QString("Are you sure you want to delete %1?").arg(selectedContact.getName()),
+        QString("Are you sure you want to delete %1?").arg(selectedContact->getName()),
         QMessageBox::Yes | QMessageBox::No
         );
 
     if (reply == QMessageBox::Yes) {
-        if (contactManager->removeContact(selectedContact.getId())) {
+        if (contactManager->removeContact(id)) {
             autoSaveContacts();
             QMessageBox::information(this, "Success", "Contact deleted successfully!");
             applySorting();  // Use applySorting instead of onRefreshTable
@@ -259,40 +445,26 @@ void MainWindow::onSearchContact() {
         return;
     }
 
-    std::vector<Contact> results = contactManager->searchByName(searchTerm);
-
-    if (results.empty()) {
-        results = contactManager->searchByPhone(searchTerm);
+    if (ui->searchNotesCheckBox->isChecked()) {
+        // Ranked keyword search: keep relevance order instead of the sort option
+        std::vector<Contact> results;
+        for (const auto& hit : contactManager->searchText(searchTerm, kMaxTextHits)) {
+            results.push_back(hit.contact);
+        }
+        populateTable(results);
+        ui->statusLabel->setText(results.empty() ? "No contacts found!"
+                                                 : QString("%1 contacts ranked by relevance")
+                                                       .arg(results.size()));
+        return;
     }
 
-    // Apply current sorting to search results
-    switch (currentSortOption) {
-    case SortByNameDesc:
-        std::sort(results.begin(), results.end(),
-                  [](const Contact& a, const Contact& b) {
-                      return a.getName().toLower() > b.getName().toLower();
-                  });
-        break;
-
-    case SortByIDAsc:
-        std::sort(results.begin(), results.end(),
-                  [](const Contact& a, const Contact& b) {
-                      return a.getId() < b.getId();
-                  });
-        break;
-
-    case SortByIDDesc:
-        std::sort(results.begin(), results.end(),
-                  [](const Contact& a, const Contact& b) {
-                      return a.getId() > b.getId();
-                  });
-        break;
-
-    default: // SortByNameAsc
-        std::sort(results.begin(), results.end());
-        break;
+    ContactQuery query = ContactQuery::parse(searchTerm, ui->soundsLikeCheckBox->isChecked());
+    if (!query.isValid()) {
+        QMessageBox::warning(this, "Invalid Search", query.error());
+        return;
     }
 
+    std::vector<Contact> results = contactManager->search(query, sortKeys);
     populateTable(results);
 
     if (results.empty()) {
@@ -311,7 +483,10 @@ void MainWindow::onViewDetails() {
         return;
     }
 
-    Contact selectedContact = getSelectedContact();
+    const Contact *selectedContact = getSelectedContact();
+    if (!selectedContact) {
+        return;
+    }
 
     QString details = QString(
                           "Contact Details\n\n"
@@ -322,13 +497,13 @@ void MainWindow::onViewDetails() {
                           "Notes: %5\n\n"
                           "Created: %6\n"
                           "Modified: %7"
-                          ).arg(selectedContact.getName())
-                          .arg(selectedContact.getPhone())
-                          .arg(selectedContact.getEmail())
-                          .arg(selectedContact.getAddress())
-                          .arg(selectedContact.getNotes())
-                          .arg(selectedContact.getCreatedDate().toString("yyyy-MM-dd hh:mm:ss"))
-                          .arg(selectedContact.getModifiedDate().toString("yyyy-MM-dd hh:mm:ss"));
+                          ).arg(selectedContact->getName())
+                          .arg(selectedContact->getPhone())
+                          .arg(selectedContact->getEmail())
+                          .arg(selectedContact->getAddress())
+                          .arg(selectedContact->getNotes())
+                          .arg(selectedContact->getCreatedDate().toString("yyyy-MM-dd hh:mm:ss"))
+                          .arg(selectedContact->getModifiedDate().toString("yyyy-MM-dd hh:mm:ss"));
 
     QMessageBox::information(this, "Contact Details", details);
 }
@@ -337,11 +512,14 @@ void MainWindow::onExportContacts() {
     QString filename = QFileDialog::getSaveFileName(
         this, "Export Contacts",
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation) + "/contacts.json",
-        "JSON Files (*.json)"
+        "JSON Files (*.json);;Compressed Contacts (*.cmz)"
         );
 
     if (!filename.isEmpty()) {
-        if (contactManager->saveToFile(filename)) {
+        ContactManager::StorageFormat format = filename.endsWith(".cmz", Qt::CaseInsensitive)
+                                                   ? ContactManager::CompressedBlocks
+                                                   : ContactManager::IndentedJson;
+        if (contactManager->saveToFile(filename, format)) {
             QMessageBox::information(this, "Success",
                                      QString("Contacts exported successfully to:\n%1").arg(filename));
         } else {
@@ -354,19 +532,53 @@ void MainWindow::onImportContacts() {
     QString filename = QFileDialog::getOpenFileName(
         this, "Import Contacts",
         QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation),
-        "JSON Files (*.json)"
+        "Contact Files (*.json *.cmz)"
         );
 
     if (!filename.isEmpty()) {
-        if (contactManager->loadFromFile(filename)) {
-            autoSaveContacts();
-            QMessageBox::information(this, "Success",
-                                     QString("Contacts imported successfully!\nTotal contacts: %1")
-                                         .arg(contactManager->getContactCount()));
-            applySorting();  // Use applySorting instead of onRefreshTable
-        } else {
-            QMessageBox::warning(this, "Error", "Failed to import contacts!");
+        ContactImporter importer(*contactManager);
+        ImportReport report = importer.importFile(filename);
+
+        if (!report.succeeded()) {
+            QMessageBox::warning(this, "Error",
+                                 QString("Failed to import contacts!\n%1").arg(report.error));
+            return;
+        }
+
+        autoSaveContacts();
+        applySorting();  // Use applySorting instead of onRefreshTable
+
+        QString summary = QString("Imported %1 contacts.\n"
+                                  "Skipped %2 duplicates and %3 invalid rows.\n"
+                                  "Total contacts: %4")
+                              .arg(report.imported)
+                              .arg(report.duplicates)
+                              .arg(report.invalid)
+                              .arg(contactManager->getContactCount());
+
+        // List the first few problems; the full list is under "Show Details"
+        const size_t shown = std::min<size_t>(report.rejected.size(), 10);
+        if (shown > 0) {
+            summary += "\n\nSkipped rows:";
+            for (size_t i = 0; i < shown; ++i) {
+                summary += QString("\n• Row %1: %2")
+                               .arg(report.rejected[i].row)
+                               .arg(report.rejected[i].reason);
+            }
+            if (report.rejected.size() > shown) {
+                summary += QString("\n… and %1 more").arg(report.rejected.size() - shown);
+            }
+        }
+
+        QMessageBox box(QMessageBox::Information, "Import Complete", summary, QMessageBox::Ok, this);
+        if (report.rejected.size() > shown) {
+            QStringList rows;
+            for (const auto& rejected : report.rejected) {
+                rows << QString("Row %1: %2").arg(rejected.row).arg(rejected.reason);
+            }
+            box.setDetailedText(rows.join('\n'));
         }
+        box.exec();
     }
 }
 
@@ -376,16 +588,16 @@ void MainWindow::onClearSearch() {
 }
 
 void MainWindow::onTableSelectionChanged() {
-    bool hasSelection = !ui->contactTable->selectedItems().isEmpty();
+    bool hasSelection = !ui->contactTable->selectedItems().isEmpty() && !loadingContacts;
     ui->editButton->setEnabled(hasSelection);
     ui->deleteButton->setEnabled(hasSelection);
     ui->viewButton->setEnabled(hasSelection);
 }
 
-Contact MainWindow::getSelectedContact() {
+const Contact* MainWindow::getSelectedContact() {
     int row = ui->contactTable->currentRow();
     int id = ui->contactTable->item(row, 0)->text().toInt();
-    return *contactManager->getContactById(id);
+    return contactManager->getContactById(id);
 }
 
 bool MainWindow::isContactSelected() {
@@ -14,7 +14,10 @@
 #include <QMessageBox>
 #include <QStandardPaths>
 #include <QComboBox>  // Add this
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 #include "contactmanager.h"
+#include "contactimporter.h"
 #include "adddialog.h"
 
 QT_BEGIN_NAMESPACE
@@ -28,16 +31,9 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
-    // Enum for sort options
-    enum SortOption {
-        SortByNameAsc,
-        SortByNameDesc,
-        SortByIDAsc,
-        SortByIDDesc
-    };
-
 protected:
     void closeEvent(QCloseEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
 
 private slots:
     void onAddContact();
@@ -51,23 +47,36 @@ private slots:
     void onClearSearch();
     void onTableSelectionChanged();
     void onSortChanged(int index);  // Add this
+    void onHeaderClicked(int section);
+    void onUndo();
+    void onRedo();
+    void onContactsLoaded();
 
 private:
     Ui::MainWindow *ui;
     ContactManager *contactManager;
     QString dataFilePath;
-    SortOption currentSortOption;  // Add this
+    ContactManager::SortKeys sortKeys;  ///< From the sort combo box or header clicks
+    QString pageFilePath;
+    QFutureWatcher<ContactManager*> loadWatcher;  ///< Background load of the full store
+    bool loadingContacts;
+    QElapsedTimer startupTimer;     ///< Measures time to first paint
+    bool firstPaintReported;
 
     void setupUI();
     void loadStyleSheet();
     void populateTable(const std::vector<Contact>& contacts);
-    Contact getSelectedContact();
+    const Contact* getSelectedContact();   ///< Points into the manager, nullptr if gone
     bool isContactSelected();
 
     void autoSaveContacts();
     void autoLoadContacts();
+    void showFirstPage();
+    void setLoading(bool loading);
     QString getDefaultDataPath();
     void applySorting();  // Add this
+    void updateSortIndicator();
+    void updateUndoButtons();
 };
 
 #endif // MAINWINDOW_H
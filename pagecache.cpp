@@ -0,0 +1,177 @@
+/**
+ * @file pagecache.cpp
+ * @brief Implementation of the LRU page cache
+ */
+
+#include "pagecache.h"
+#include <QDebug>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// Enough for a root-to-leaf path of every tree plus the pages being copied
+const size_t kMinBudgetPages = 16;
+
+size_t pagesFor(size_t budgetBytes) {
+    return std::max(kMinBudgetPages, budgetBytes / PageCache::kPageSize);
+}
+
+} // namespace
+
+PageCache::PageCache(size_t budgetBytes)
+    : budgetPages(pagesFor(budgetBytes)) {
+}
+
+PageCache::~PageCache() {
+    close();
+}
+
+bool PageCache::open(const QString& filename) {
+    close();
+
+    file.setFileName(filename);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qDebug() << "Cannot open page file:" << filename;
+        return false;
+    }
+    if (file.size() % kPageSize != 0) {
+        qDebug() << "Page file is not a whole number of pages:" << filename;
+        file.close();
+        return false;
+    }
+
+    pages = static_cast<quint32>(file.size() / kPageSize);
+    return true;
+}
+
+void PageCache::close() {
+    if (!file.isOpen()) {
+        return;
+    }
+    flush();
+    entries.clear();
+    lru.clear();
+    pages = 0;
+    file.close();
+}
+
+PageCache::Entry* PageCache::fetch(quint32 page) {
+    if (page >= pages) {
+        return nullptr;
+    }
+
+    auto it = entries.find(page);
+    if (it != entries.end()) {
+        ++stats.hits;
+        lru.splice(lru.begin(), lru, it->second.lruPosition);
+        return &it->second;
+    }
+
+    ++stats.misses;
+    auto data = std::make_shared<QByteArray>(kPageSize, Qt::Uninitialized);
+    if (!file.seek(static_cast<qint64>(page) * kPageSize) ||
+        file.read(data->data(), kPageSize) != kPageSize) {
+        qDebug() << "Cannot read page" << page << "of" << file.fileName();
+        return nullptr;
+    }
+
+    // Evict before inserting so the new page is never the victim
+    evict();
+    lru.push_front(page);
+    Entry& entry = entries[page];
+    entry.data = std::move(data);
+    entry.lruPosition = lru.begin();
+    return &entry;
+}
+
+PageCache::Page PageCache::read(quint32 page) {
+    Entry *entry = fetch(page);
+    return entry ? entry->data : nullptr;
+}
+
+PageCache::Page PageCache::modify(quint32 page) {
+    Entry *entry = fetch(page);
+    if (!entry) {
+        return nullptr;
+    }
+    entry->dirty = true;
+    return entry->data;
+}
+
+quint32 PageCache::allocate(quint32 count) {
+    const quint32 first = pages;
+    pages += count;
+
+    // New pages start dirty and zeroed; the file grows when they are written
+    for (quint32 page = first; page < pages; ++page) {
+        evict();
+        lru.push_front(page);
+        Entry& entry = entries[page];
+        entry.data = std::make_shared<QByteArray>(kPageSize, '\0');
+        entry.dirty = true;
+        entry.lruPosition = lru.begin();
+    }
+    return first;
+}
+
+bool PageCache::writeBack(quint32 page, Entry& entry) {
+    if (!file.seek(static_cast<qint64>(page) * kPageSize) ||
+        file.write(*entry.data) != kPageSize) {
+        qDebug() << "Cannot write page" << page << "of" << file.fileName();
+        return false;
+    }
+    entry.dirty = false;
+    ++stats.writes;
+    return true;
+}
+
+void PageCache::evict() {
+    // A page someone still holds is skipped; if all are held the cache
+    // temporarily grows past its budget
+    auto it = lru.end();
+    while (entries.size() >= budgetPages && it != lru.begin()) {
+        --it;
+        auto entryIt = entries.find(*it);
+        Entry& entry = entryIt->second;
+        if (entry.data.use_count() > 1 || (entry.dirty && !writeBack(*it, entry))) {
+            continue;
+        }
+        entries.erase(entryIt);
+        it = lru.erase(it);
+        ++stats.evictions;
+    }
+}
+
+bool PageCache::flush() {
+    if (!file.isOpen()) {
+        return false;
+    }
+
+    // Pages are written in file order so a growing file is extended sequentially
+    std::vector<quint32> dirtyPages;
+    for (const auto& entry : entries) {
+        if (entry.second.dirty) {
+            dirtyPages.push_back(entry.first);
+        }
+    }
+    std::sort(dirtyPages.begin(), dirtyPages.end());
+
+    bool ok = true;
+    for (quint32 page : dirtyPages) {
+        ok = writeBack(page, entries[page]) && ok;
+    }
+    return file.flush() && ok;
+}
+
+void PageCache::setBudget(size_t budgetBytes) {
+    budgetPages = pagesFor(budgetBytes);
+    evict();
+}
+
+PageCache::Stats PageCache::getStats() const {
+    Stats current = stats;
+    current.residentPages = entries.size();
+    current.budgetPages = budgetPages;
+    return current;
+}
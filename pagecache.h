@@ -0,0 +1,128 @@
+/**
+ * @file pagecache.h
+ * @brief Fixed-size pages of one file, cached in memory within a budget
+ *
+ * Pages are read on first access and kept in an LRU list. When the budget
+ * is exceeded the least recently used page no one holds is dropped,
+ * modified pages are written back first. New pages are always appended at
+ * the end of the file, so pages allocated together are contiguous.
+ *
+ * Page handles are shared pointers: a page that is still held is never
+ * evicted, so a handle stays valid while other pages are read.
+ */
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+class PageCache {
+public:
+    static const int kPageSize = 4096;
+
+    /**
+     * @brief Handle to the bytes of one cached page
+     */
+    using Page = std::shared_ptr<QByteArray>;
+
+    /**
+     * @brief Counters describing the cache
+     */
+    struct Stats {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        quint64 evictions = 0;
+        quint64 writes = 0;          ///< Pages written back to the file
+        size_t residentPages = 0;
+        size_t budgetPages = 0;
+    };
+
+    /**
+     * @param budgetBytes Memory the cached pages may use; at least a few pages
+     */
+    explicit PageCache(size_t budgetBytes);
+
+    /**
+     * @brief Writes back modified pages
+     */
+    ~PageCache();
+
+    /**
+     * @brief Opens or creates the file; an existing file must be whole pages
+     */
+    bool open(const QString& filename);
+
+    /**
+     * @brief Writes back modified pages and closes the file
+     */
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+
+    quint32 pageCount() const { return pages; }
+
+    /**
+     * @brief Gets a page for reading
+     * @return nullptr if the page does not exist or cannot be read
+     * Time Complexity: O(1) when cached, one read otherwise
+     */
+    Page read(quint32 page);
+
+    /**
+     * @brief Gets a page for writing; it is written back on eviction or flush()
+     */
+    Page modify(quint32 page);
+
+    /**
+     * @brief Appends zeroed pages to the file
+     * @param count Number of contiguous pages
+     * @return Number of the first new page
+     */
+    quint32 allocate(quint32 count = 1);
+
+    /**
+     * @brief Writes every modified page to the file
+     * @return false if a write failed
+     */
+    bool flush();
+
+    /**
+     * @brief Changes the budget, evicting pages if it shrank
+     */
+    void setBudget(size_t budgetBytes);
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        Page data;
+        bool dirty = false;
+        std::list<quint32>::iterator lruPosition;
+    };
+
+    QFile file;
+    quint32 pages = 0;
+    size_t budgetPages;
+    std::unordered_map<quint32, Entry> entries;
+    std::list<quint32> lru;         ///< Most recently used first
+    Stats stats;
+
+    /**
+     * @brief Finds or loads a page and marks it most recently used
+     */
+    Entry* fetch(quint32 page);
+
+    /**
+     * @brief Drops unheld pages from the cold end until within budget
+     */
+    void evict();
+
+    bool writeBack(quint32 page, Entry& entry);
+};
+
+#endif // PAGECACHE_H
@@ -0,0 +1,130 @@
+/**
+ * @file phonedigitindex.cpp
+ * @brief Implementation of the packed phone digit column
+ */
+
+#include "phonedigitindex.h"
+#include <algorithm>
+
+void PhoneDigitIndex::insert(int id, QStringView phone) {
+    size_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = slotIds.size();
+        digits.push_back(0);
+        digitLengths.push_back(0);
+        national.push_back(0);
+        nationalLengths.push_back(0);
+        countries.push_back(0);
+        slotIds.push_back(0);
+    }
+
+    int countryCode = 0;
+    const PhoneDigits::Packed all = PhoneDigits::pack(phone);
+    const PhoneDigits::Packed local = PhoneDigits::national(phone, countryCode);
+
+    digits[slot] = all.digits;
+    digitLengths[slot] = std::min<quint8>(all.length, PhoneDigits::kMaxDigits);
+    national[slot] = local.digits;
+    nationalLengths[slot] = std::min<quint8>(local.length, PhoneDigits::kMaxDigits);
+    countries[slot] = static_cast<quint16>(countryCode);
+    slotIds[slot] = id;
+    slotOfId[id] = slot;
+}
+
+void PhoneDigitIndex::remove(int id) {
+    auto it = slotOfId.find(id);
+    if (it == slotOfId.end()) {
+        return;
+    }
+
+    // A zero length never matches, so the slot drops out of searches
+    const size_t slot = it->second;
+    digitLengths[slot] = 0;
+    nationalLengths[slot] = 0;
+    countries[slot] = 0;
+    freeSlots.push_back(slot);
+    slotOfId.erase(it);
+}
+
+void PhoneDigitIndex::clear() {
+    digits.clear();
+    digitLengths.clear();
+    national.clear();
+    nationalLengths.clear();
+    countries.clear();
+    slotIds.clear();
+    freeSlots.clear();
+    slotOfId.clear();
+}
+
+std::vector<int> PhoneDigitIndex::search(QStringView query, PhoneDigits::Match mode) const {
+    const size_t count = slotIds.size();
+    std::vector<quint8> hits(count, 0);
+
+    int countryCode = 0;
+    const PhoneDigits::Packed local = PhoneDigits::national(query, countryCode);
+
+    if (countryCode != 0) {
+        // The country code anchors the query at the start of the national number
+        if (local.length == 0) {
+            for (size_t i = 0; i < count; ++i) {
+                hits[i] = digitLengths[i] > 0;
+            }
+        } else {
+            PhoneDigits::match(national.data(), nationalLengths.data(), count, local,
+                               PhoneDigits::Prefix, hits.data());
+        }
+        const quint16 code = static_cast<quint16>(countryCode);
+        const bool anyCountry = local.length > 0;
+        for (size_t i = 0; i < count; ++i) {
+            hits[i] &= static_cast<quint8>(countries[i] == code || (anyCountry && countries[i] == 0));
+        }
+    } else {
+        PhoneDigits::match(digits.data(), digitLengths.data(), count, PhoneDigits::pack(query),
+                           mode, hits.data());
+        if (mode == PhoneDigits::Prefix) {
+            PhoneDigits::match(national.data(), nationalLengths.data(), count, local,
+                               PhoneDigits::Prefix, hits.data());
+        }
+    }
+
+    std::vector<int> ids;
+    for (size_t i = 0; i < count; ++i) {
+        if (hits[i]) {
+            ids.push_back(slotIds[i]);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+bool PhoneDigitIndex::matches(QStringView phone, QStringView query, PhoneDigits::Match mode) {
+    int countryCode = 0;
+    const PhoneDigits::Packed local = PhoneDigits::national(query, countryCode);
+    int phoneCountry = 0;
+    PhoneDigits::Packed number = PhoneDigits::national(phone, phoneCountry);
+    number.length = std::min<quint8>(number.length, PhoneDigits::kMaxDigits);
+    quint8 hit = 0;
+
+    if (countryCode != 0) {
+        if (phoneCountry != countryCode && (local.length == 0 || phoneCountry != 0)) {
+            return false;
+        }
+        if (local.length == 0) {
+            return PhoneDigits::pack(phone).length > 0;
+        }
+        PhoneDigits::match(&number.digits, &number.length, 1, local, PhoneDigits::Prefix, &hit);
+        return hit != 0;
+    }
+
+    PhoneDigits::Packed all = PhoneDigits::pack(phone);
+    all.length = std::min<quint8>(all.length, PhoneDigits::kMaxDigits);
+    PhoneDigits::match(&all.digits, &all.length, 1, PhoneDigits::pack(query), mode, &hit);
+    if (mode == PhoneDigits::Prefix) {
+        PhoneDigits::match(&number.digits, &number.length, 1, local, PhoneDigits::Prefix, &hit);
+    }
+    return hit != 0;
+}
@@ -0,0 +1,247 @@
+/**
+ * @file phonedigits.cpp
+ * @brief Implementation of the packed phone digit kernels
+ */
+
+#include "phonedigits.h"
+#include "facets.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PHONEDIGITS_SSE2
+#endif
+
+// The AVX2 kernel is compiled for its own target and only called after a
+// CPU check, so the rest of the build needs no -mavx2
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define PHONEDIGITS_AVX2 1
+#define PHONEDIGITS_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(_M_X64)
+#include <immintrin.h>
+#include <intrin.h>
+#define PHONEDIGITS_AVX2 1
+#define PHONEDIGITS_AVX2_TARGET
+#endif
+
+namespace {
+
+// Longest run of digits worth extracting: enough for a national number after
+// a 00 prefix and a three-digit country code
+const int kMaxExtracted = PhoneDigits::kMaxDigits + 8;
+
+int extractScalar(const char16_t *chars, qsizetype size, char *out, int count, int capacity) {
+    for (qsizetype i = 0; i < size && count < capacity; ++i) {
+        const char16_t value = chars[i] - u'0';
+        if (value < 10) {
+            out[count++] = static_cast<char>(value);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief A packed pattern and the alignments to try it at
+ */
+struct Window {
+    quint64 digits;
+    quint64 mask;
+    int length;
+    int lastShift;
+};
+
+// Tests one entry at every alignment; from is the first entry to test
+void matchScalar(const quint64 *column, const quint8 *lengths, size_t from, size_t count,
+                 const Window& window, quint8 *hits) {
+    for (size_t i = from; i < count; ++i) {
+        quint8 hit = 0;
+        for (int shift = 0; shift <= window.lastShift; ++shift) {
+            const quint64 digits = (column[i] >> (4 * shift)) & window.mask;
+            hit |= static_cast<quint8>((digits == window.digits) & (lengths[i] >= shift + window.length));
+        }
+        hits[i] |= hit;
+    }
+}
+
+#if defined(PHONEDIGITS_AVX2)
+
+// Four entries per step: each alignment is one shift, mask and 64-bit
+// compare across the vector. Returns the number of entries tested.
+PHONEDIGITS_AVX2_TARGET size_t matchAvx2(const quint64 *column, const quint8 *lengths,
+                                         size_t count, const Window& window, quint8 *hits) {
+    const __m256i pattern = _mm256_set1_epi64x(static_cast<long long>(window.digits));
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(window.mask));
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i numbers = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(column + i));
+        quint32 fourLengths;
+        std::memcpy(&fourLengths, lengths + i, sizeof(fourLengths));
+        const __m256i numberLengths =
+            _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(static_cast<int>(fourLengths)));
+
+        __m256i hit = _mm256_setzero_si256();
+        for (int shift = 0; shift <= window.lastShift; ++shift) {
+            const __m256i digits =
+                _mm256_and_si256(_mm256_srl_epi64(numbers, _mm_cvtsi32_si128(4 * shift)), mask);
+            // length >= shift + pattern length, as a signed greater-than
+            const __m256i fits = _mm256_cmpgt_epi64(
+                numberLengths, _mm256_set1_epi64x(shift + window.length - 1));
+            hit = _mm256_or_si256(hit, _mm256_and_si256(_mm256_cmpeq_epi64(digits, pattern), fits));
+        }
+
+        const int lanes = _mm256_movemask_pd(_mm256_castsi256_pd(hit));
+        hits[i] |= static_cast<quint8>(lanes & 1);
+        hits[i + 1] |= static_cast<quint8>((lanes >> 1) & 1);
+        hits[i + 2] |= static_cast<quint8>((lanes >> 2) & 1);
+        hits[i + 3] |= static_cast<quint8>((lanes >> 3) & 1);
+    }
+    return i;
+}
+
+bool detectAvx2() {
+#if defined(_M_X64)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // The OS must save the YMM registers (OSXSAVE, AVX and XCR0 bits 1-2)
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+} // namespace
+
+bool PhoneDigits::isPhoneQuery(QStringView text) {
+    bool digit = false;
+    for (const QChar ch : text) {
+        if (ch.unicode() >= u'0' && ch.unicode() <= u'9') {
+            digit = true;
+        } else if (!ch.isSpace() && ch != u'+' && ch != u'-' && ch != u'(' && ch != u')' &&
+                   ch != u'.') {
+            return false;
+        }
+    }
+    return digit;
+}
+
+bool PhoneDigits::matchAccelerated() {
+#if defined(PHONEDIGITS_AVX2)
+    static const bool available = detectAvx2();
+    return available;
+#else
+    return false;
+#endif
+}
+
+bool PhoneDigits::simdAccelerated() {
+#ifdef PHONEDIGITS_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+int PhoneDigits::extract(QStringView phone, char *out, int capacity) {
+    const char16_t *chars = phone.utf16();
+    const qsizetype size = phone.size();
+    int count = 0;
+    qsizetype i = 0;
+
+#ifdef PHONEDIGITS_SSE2
+    // SSE2 has no unsigned 16-bit compare: flipping the sign bit maps
+    // ch - '0' in [0, 10) onto the lowest signed values
+    const __m128i zero = _mm_set1_epi16(u'0');
+    const __m128i signBit = _mm_set1_epi16(static_cast<short>(0x8000));
+    const __m128i limit = _mm_set1_epi16(static_cast<short>(0x8000 + 10));
+
+    for (; i + 8 <= size && count + 8 <= capacity; i += 8) {
+        const __m128i values = _mm_sub_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(chars + i)), zero);
+        const __m128i isDigit = _mm_cmplt_epi16(_mm_xor_si128(values, signBit), limit);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(isDigit));
+
+        if (mask == 0xFFFF) {
+            // Eight digits in a row, the common case for unformatted numbers
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + count),
+                             _mm_packus_epi16(values, values));
+            count += 8;
+            continue;
+        }
+
+        // Two mask bits per character; keep the digits in order
+        while (mask != 0) {
+            const int lane = qCountTrailingZeroBits(mask) / 2;
+            out[count++] = static_cast<char>(chars[i + lane] - u'0');
+            mask &= ~(3u << (2 * lane));
+        }
+    }
+#endif
+
+    return extractScalar(chars + i, size - i, out, count, capacity);
+}
+
+PhoneDigits::Packed PhoneDigits::pack(const char *digits, int count) {
+    Packed packed;
+    packed.length = static_cast<quint8>(std::min(count, 255));
+    for (int i = 0; i < std::min(count, kMaxDigits); ++i) {
+        packed.digits |= static_cast<quint64>(digits[i]) << (4 * i);
+    }
+    return packed;
+}
+
+PhoneDigits::Packed PhoneDigits::pack(QStringView phone) {
+    char digits[kMaxExtracted];
+    return pack(digits, extract(phone, digits, kMaxExtracted));
+}
+
+PhoneDigits::Packed PhoneDigits::national(QStringView phone, int& countryCode) {
+    char digits[kMaxExtracted];
+    const int count = extract(phone, digits, kMaxExtracted);
+
+    const QString code = Facets::countryCode(phone);
+    int skip = 0;
+    countryCode = 0;
+    if (!code.isEmpty()) {
+        countryCode = code.toInt();
+        skip = static_cast<int>(code.size()) + (phone.trimmed().startsWith(u"00") ? 2 : 0);
+    } else if (count > 0 && digits[0] == 0) {
+        skip = 1;
+    }
+    return pack(digits + skip, std::max(0, count - skip));
+}
+
+void PhoneDigits::match(const quint64 *column, const quint8 *lengths, size_t count,
+                        Packed pattern, Match mode, quint8 *hits) {
+    if (pattern.length == 0 || pattern.length > kMaxDigits) {
+        return;
+    }
+
+    Window window;
+    window.digits = pattern.digits;
+    window.mask = pattern.length == kMaxDigits ? ~quint64(0)
+                                               : (quint64(1) << (4 * pattern.length)) - 1;
+    window.length = pattern.length;
+    window.lastShift = mode == Prefix ? 0 : kMaxDigits - pattern.length;
+
+    size_t done = 0;
+#if defined(PHONEDIGITS_AVX2)
+    if (matchAccelerated()) {
+        done = matchAvx2(column, lengths, count, window, hits);
+    }
+#endif
+    matchScalar(column, lengths, done, count, window, hits);
+}
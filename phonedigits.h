@@ -0,0 +1,95 @@
+/**
+ * @file phonedigits.h
+ * @brief Phone numbers reduced to their digits, packed four bits per digit
+ *
+ * A packed number keeps up to 16 digits in one 64-bit word, digit i in
+ * bits 4i..4i+3, so a prefix or substring test is a shift, a mask and one
+ * compare. match() runs that test over a whole column of packed numbers:
+ * with AVX2, four numbers per instruction, otherwise one at a time. AVX2 is
+ * detected once at run time, so one build runs on any x86-64 CPU.
+ *
+ * Digits are extracted with SSE2 on x86, eight characters per step, and
+ * with a scalar loop elsewhere.
+ */
+
+#ifndef PHONEDIGITS_H
+#define PHONEDIGITS_H
+
+#include <QStringView>
+#include <QtGlobal>
+
+class PhoneDigits {
+public:
+    static constexpr int kMaxDigits = 16;
+
+    /**
+     * @brief Digits of one number, packed into nibbles
+     */
+    struct Packed {
+        quint64 digits = 0;
+        quint8 length = 0;      ///< Digits in the number; above kMaxDigits only the first are kept
+    };
+
+    enum Match {
+        Prefix,
+        Substring
+    };
+
+    /**
+     * @brief Copies the values (0-9) of the ASCII digits in phone to out
+     * Separators, spaces and '+' are skipped.
+     * @return Number of digits written, at most capacity
+     * Time Complexity: O(m)
+     */
+    static int extract(QStringView phone, char *out, int capacity);
+
+    /**
+     * @brief Packs digit values as produced by extract()
+     */
+    static Packed pack(const char *digits, int count);
+
+    /**
+     * @brief Packs all digits of a formatted number
+     */
+    static Packed pack(QStringView phone);
+
+    /**
+     * @brief Packs the national part of a number
+     * Numbers written with + or 00 lose their country code (see
+     * Facets::countryCode()); others lose one leading trunk 0, so
+     * "+91 98765 43210" and "098765 43210" both give 9876543210.
+     * @param countryCode Receives the country code, or 0 if the number has none
+     */
+    static Packed national(QStringView phone, int& countryCode);
+
+    /**
+     * @brief Sets hits[i] for every packed number that contains pattern
+     * @param column Packed digits, one per entry
+     * @param lengths Digits per entry, at most kMaxDigits; 0 never matches
+     * @param mode Prefix anchors the pattern at the first digit
+     * Entries already set in hits stay set.
+     * Time Complexity: O(count * alignments), four entries per step with AVX2
+     */
+    static void match(const quint64 *column, const quint8 *lengths, size_t count,
+                      Packed pattern, Match mode, quint8 *hits);
+
+    /**
+     * @brief Whether a query reads as a phone number
+     * True for text with at least one digit and otherwise only spaces and
+     * the separators + - ( ) . so "98765" or "+91 98765" qualify but
+     * "flat 4b" does not.
+     */
+    static bool isPhoneQuery(QStringView text);
+
+    /**
+     * @brief Whether extract() uses SIMD instructions on this build
+     */
+    static bool simdAccelerated();
+
+    /**
+     * @brief Whether match() uses the AVX2 kernel on this CPU
+     */
+    static bool matchAccelerated();
+};
+
+#endif // PHONEDIGITS_H
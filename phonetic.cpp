@@ -0,0 +1,96 @@
+/**
+ * @file phonetic.cpp
+ * @brief Implementation of the Soundex name keys
+ */
+
+#include "phonetic.h"
+
+namespace {
+
+// Soundex digit for a lower-case letter: '0' for vowels (they separate
+// repeated codes), 0 for 'h' and 'w' (they do not)
+char soundexDigit(char16_t ch) {
+    switch (ch) {
+    case u'b': case u'f': case u'p': case u'v':
+        return '1';
+    case u'c': case u'g': case u'j': case u'k':
+    case u'q': case u's': case u'x': case u'z':
+        return '2';
+    case u'd': case u't':
+        return '3';
+    case u'l':
+        return '4';
+    case u'm': case u'n':
+        return '5';
+    case u'r':
+        return '6';
+    case u'h': case u'w':
+        return 0;
+    default:
+        return '0';
+    }
+}
+
+inline char16_t asciiLower(char16_t ch) {
+    if (ch >= u'A' && ch <= u'Z') {
+        return ch - u'A' + u'a';
+    }
+    return (ch >= u'a' && ch <= u'z') ? ch : 0;
+}
+
+} // namespace
+
+QString Phonetic::soundex(QStringView word) {
+    QString code;
+    char previous = 0;
+
+    for (QChar qch : word) {
+        const char16_t ch = asciiLower(qch.unicode());
+        if (!ch) {
+            continue;
+        }
+
+        const char digit = soundexDigit(ch);
+        if (code.isEmpty()) {
+            code.append(QChar(ch - u'a' + u'A'));
+            previous = digit;
+            continue;
+        }
+
+        if (digit == 0) {
+            continue;
+        }
+        if (digit != '0' && digit != previous) {
+            code.append(QLatin1Char(digit));
+            if (code.size() == 4) {
+                return code;
+            }
+        }
+        previous = digit;
+    }
+
+    if (!code.isEmpty()) {
+        code = code.leftJustified(4, QLatin1Char('0'));
+    }
+    return code;
+}
+
+QStringList Phonetic::nameKeys(QStringView name) {
+    QStringList keys;
+    qsizetype start = 0;
+
+    for (qsizetype i = 0; i <= name.size(); ++i) {
+        if (i < name.size() && !name[i].isSpace() && name[i] != u'-') {
+            continue;
+        }
+        if (i > start) {
+            const QString key = soundex(name.mid(start, i - start));
+            if (!key.isEmpty() && !keys.contains(key)) {
+                keys.append(key);
+            }
+        }
+        start = i + 1;
+    }
+
+    return keys;
+}
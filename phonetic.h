@@ -0,0 +1,35 @@
+/**
+ * @file phonetic.h
+ * @brief Sound-alike keys for names
+ *
+ * Names are split into words and each word is reduced to its American
+ * Soundex code: the first letter followed by three digits for the consonant
+ * groups that follow it. Spellings that sound alike share a code, e.g.
+ * "Shreya"/"Sreya" (S600) and "Mohammed"/"Muhammad" (M530).
+ */
+
+#ifndef PHONETIC_H
+#define PHONETIC_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+
+class Phonetic {
+public:
+    /**
+     * @brief Soundex code of one word
+     * Non-letters are ignored. Returns an empty string if the word has no
+     * ASCII letters.
+     * Time Complexity: O(m)
+     */
+    static QString soundex(QStringView word);
+
+    /**
+     * @brief Distinct Soundex codes of every word in a name, in order
+     * Time Complexity: O(m)
+     */
+    static QStringList nameKeys(QStringView name);
+};
+
+#endif // PHONETIC_H
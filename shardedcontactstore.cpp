@@ -0,0 +1,284 @@
+/**
+ * @file shardedcontactstore.cpp
+ * @brief Implementation of the sharded multi-address-book store
+ */
+
+#include "shardedcontactstore.h"
+#include "crc32c.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+#include <QtConcurrent>
+#include <set>
+
+namespace {
+
+const char kShardSuffix[] = ".cmz";
+const char kLegacyShardSuffix[] = ".json";   ///< Shards saved before CompressedBlocks
+
+} // namespace
+
+ShardedContactStore::ShardedContactStore(const QString& directory, int hashShardCount)
+    : directory(directory),
+    hashShardCount(hashShardCount) {
+    QDir().mkpath(directory);
+}
+
+ShardedContactStore::~ShardedContactStore() {
+    saveAll();
+}
+
+QString ShardedContactStore::hashShardKey(const QString& phone, int shardCount) {
+    // qHash is seeded per process, so it cannot pick a shard file
+    const quint32 shard = Crc32c::compute(phone.toUtf8()) % static_cast<quint32>(std::max(1, shardCount));
+    return QString("shard-%1").arg(shard, 3, 10, QChar('0'));
+}
+
+QString ShardedContactStore::filePathFor(const QString& tenant, const char* suffix) const {
+    // Percent-encoding keeps any tenant name a valid, reversible file name
+    return QDir(directory).filePath(QString::fromLatin1(QUrl::toPercentEncoding(tenant)) + suffix);
+}
+
+ShardedContactStore::Shard& ShardedContactStore::shardFor(const QString& tenant) {
+    std::lock_guard<std::mutex> lock(shardsMutex);
+
+    std::unique_ptr<Shard>& shard = shards[tenant];
+    if (!shard) {
+        shard = std::make_unique<Shard>();
+        shard->filePath = filePathFor(tenant, kShardSuffix);
+        shard->legacyFilePath = filePathFor(tenant, kLegacyShardSuffix);
+    }
+    return *shard;
+}
+
+void ShardedContactStore::ensureLoaded(Shard& shard) {
+    if (shard.manager) {
+        return;
+    }
+
+    shard.manager = std::make_unique<ContactManager>();
+
+    // A shard from before the rename still holds JSON; loading reads either
+    if (!QFileInfo::exists(shard.filePath) && QFileInfo::exists(shard.legacyFilePath) &&
+        QFile::rename(shard.legacyFilePath, shard.filePath)) {
+        QFile::rename(ContactManager::textIndexPath(shard.legacyFilePath),
+                      ContactManager::textIndexPath(shard.filePath));
+    }
+    if (QFileInfo::exists(shard.filePath) && !shard.manager->loadFromFile(shard.filePath)) {
+        qDebug() << "Failed to load shard from:" << shard.filePath;
+    }
+}
+
+bool ShardedContactStore::saveShard(Shard& shard) {
+    if (!shard.manager || !shard.dirty) {
+        return true;
+    }
+    if (!shard.manager->saveToFile(shard.filePath, ContactManager::CompressedBlocks)) {
+        qDebug() << "Failed to save shard to:" << shard.filePath;
+        return false;
+    }
+    if (!shard.manager->saveTextIndex(ContactManager::textIndexPath(shard.filePath))) {
+        qDebug() << "Failed to save full-text index for shard:" << shard.filePath;
+    }
+    shard.dirty = false;
+    return true;
+}
+
+bool ShardedContactStore::addToShard(Shard& shard, Contact&& contact) {
+    // Loading the shard reserved its stored IDs, so a fresh ID is free here
+    if (shard.manager->getContactById(contact.getId())) {
+        contact.setId(Contact::allocateId());
+    }
+
+    bool added = shard.manager->addContact(std::move(contact));
+    shard.dirty |= added;
+    return added;
+}
+
+bool ShardedContactStore::addContact(const QString& tenant, const Contact& contact) {
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ensureLoaded(shard);
+    return addToShard(shard, Contact(contact));
+}
+
+bool ShardedContactStore::moveContact(Shard& from, Shard& to, int id,
+                                      const Contact& updatedContact) {
+    // std::lock orders the two locks, so concurrent opposite moves cannot deadlock
+    std::unique_lock<std::mutex> fromLock(from.mutex, std::defer_lock);
+    std::unique_lock<std::mutex> toLock(to.mutex, std::defer_lock);
+    std::lock(fromLock, toLock);
+    ensureLoaded(from);
+    ensureLoaded(to);
+
+    const Contact* existing = from.manager->getContactById(id);
+    if (!existing) {
+        return false;
+    }
+
+    Contact moved(updatedContact);
+    moved.setId(id);
+    moved.setCreated(existing->getCreated());
+    if (!addToShard(to, std::move(moved))) {
+        return false;
+    }
+    from.dirty |= from.manager->removeContact(id);
+    return true;
+}
+
+bool ShardedContactStore::updateContact(const QString& tenant, int id,
+                                        const Contact& updatedContact) {
+    if (hashShardCount > 0) {
+        const QString target = hashShardKey(updatedContact.getPhone(), hashShardCount);
+        if (target != tenant) {
+            return moveContact(shardFor(tenant), shardFor(target), id, updatedContact);
+        }
+    }
+
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ensureLoaded(shard);
+
+    bool updated = shard.manager->updateContact(id, updatedContact);
+    shard.dirty |= updated;
+    return updated;
+}
+
+bool ShardedContactStore::removeContact(const QString& tenant, int id) {
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ensureLoaded(shard);
+
+    bool removed = shard.manager->removeContact(id);
+    shard.dirty |= removed;
+    return removed;
+}
+
+std::vector<Contact> ShardedContactStore::search(const QString& tenant, const ContactQuery& query) {
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ensureLoaded(shard);
+    return shard.manager->search(query);
+}
+
+std::vector<Contact> ShardedContactStore::getAllContactsSorted(const QString& tenant) {
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ensureLoaded(shard);
+    return shard.manager->getAllContactsSorted();
+}
+
+int ShardedContactStore::getContactCount(const QString& tenant) {
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    ensureLoaded(shard);
+    return shard.manager->getContactCount();
+}
+
+std::vector<ShardedContactStore::ShardHit> ShardedContactStore::searchShard(const QString& tenant,
+                                                                         const ContactQuery& query) {
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const bool wasLoaded = shard.manager != nullptr;
+    ensureLoaded(shard);
+
+    std::vector<ShardHit> hits;
+    for (Contact& contact : shard.manager->search(query)) {
+        hits.push_back({tenant, std::move(contact)});
+    }
+
+    // A freshly loaded shard has no unsaved changes, so it can just go
+    if (!wasLoaded && !shard.dirty) {
+        shard.manager.reset();
+    }
+    return hits;
+}
+
+std::vector<ShardedContactStore::ShardHit> ShardedContactStore::searchAll(const ContactQuery& query) {
+    return fanOut(tenants(), query);
+}
+
+std::vector<ShardedContactStore::ShardHit> ShardedContactStore::searchAll(const ContactQuery& query,
+                                                                       const QStringList& tenantSubset) {
+    const std::set<QString> wanted(tenantSubset.begin(), tenantSubset.end());
+    QStringList tenantList;
+    for (const QString& tenant : tenants()) {
+        if (wanted.count(tenant)) {
+            tenantList.append(tenant);
+        }
+    }
+    return fanOut(tenantList, query);
+}
+
+std::vector<ShardedContactStore::ShardHit> ShardedContactStore::fanOut(const QStringList& tenantList,
+                                                                    const ContactQuery& query) {
+    // Each task locks only its own shard, so shards load and search concurrently
+    const QList<std::vector<ShardHit>> perShard =
+        QtConcurrent::blockingMapped<QList<std::vector<ShardHit>>>(
+            tenantList, [this, &query](const QString& tenant) {
+                return searchShard(tenant, query);
+            });
+
+    // Tenants are sorted and each shard returns IDs in order, so
+    // concatenating in tenant order is already a merge
+    std::vector<ShardHit> merged;
+    for (const auto& hits : perShard) {
+        merged.insert(merged.end(), hits.begin(), hits.end());
+    }
+    return merged;
+}
+
+QStringList ShardedContactStore::tenants() const {
+    std::set<QString> names;
+
+    for (const char* suffix : {kShardSuffix, kLegacyShardSuffix}) {
+        const QString pattern = QString("*") + suffix;
+        const QStringList files = QDir(directory).entryList({pattern}, QDir::Files);
+        for (const QString& file : files) {
+            QString encoded = file.chopped(pattern.size() - 1);
+            names.insert(QUrl::fromPercentEncoding(encoded.toLatin1()));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    for (const auto& entry : shards) {
+        names.insert(entry.first);
+    }
+
+    return QStringList(names.begin(), names.end());
+}
+
+int ShardedContactStore::loadedShardCount() const {
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    int loaded = 0;
+    for (const auto& entry : shards) {
+        std::lock_guard<std::mutex> shardLock(entry.second->mutex);
+        loaded += entry.second->manager ? 1 : 0;
+    }
+    return loaded;
+}
+
+bool ShardedContactStore::unload(const QString& tenant) {
+    Shard& shard = shardFor(tenant);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    if (!saveShard(shard)) {
+        return false;
+    }
+    shard.manager.reset();
+    return true;
+}
+
+bool ShardedContactStore::saveAll() {
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    bool ok = true;
+
+    for (auto& entry : shards) {
+        std::lock_guard<std::mutex> shardLock(entry.second->mutex);
+        ok = saveShard(*entry.second) && ok;
+    }
+    return ok;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file shardedcontactstore.h
+ * @brief Many independent address books, each in its own lazily loaded shard
+ *
+ * Every tenant (team, customer, ...) gets a shard: a ContactManager with its
+ * own indexes, persisted to its own file in the store directory. A shard is
+ * only read from disk the first time it is used, so memory and startup cost
+ * follow the books actually in use. Queries across all tenants fan out to
+ * the shards in parallel and the results are merged.
+ *
+ * A single very large book can be spread over N shards by opening the store
+ * with hashShardCount N and using hashShardKey(phone, N) as the tenant. The
+ * store then moves a contact to its new shard when its phone changes.
+ */
+
+#ifndef SHARDEDCONTACTSTORE_H
+#define SHARDEDCONTACTSTORE_H
+
+#include "contactmanager.h"
+#include <QString>
+#include <QStringList>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class ShardedContactStore {
+public:
+    /**
+     * @brief A contact found by a fan-out query, tagged with its tenant
+     */
+    struct ShardHit {
+        QString tenant;
+        Contact contact;
+    };
+
+    /**
+     * @brief Opens a store; no shard is loaded until it is used
+     * @param directory Folder holding one file per tenant
+     * @param hashShardCount Shards of a phone-hashed book, 0 if tenants are
+     *        named by the caller
+     */
+    explicit ShardedContactStore(const QString& directory, int hashShardCount = 0);
+
+    /**
+     * @brief Saves every modified shard
+     */
+    ~ShardedContactStore();
+
+    /**
+     * @brief Maps a phone number to one of shardCount hash shards
+     * Uses CRC-32C of the UTF-8 text, which is the same in every process
+     * and on every machine, so contacts stay in the shard files they were
+     * saved to.
+     */
+    static QString hashShardKey(const QString& phone, int shardCount);
+
+    /**
+     * @brief Adds a contact to a tenant's shard
+     * The contact may have been created before the shard was loaded; if its
+     * ID is already stored there it gets a fresh one.
+     */
+    bool addContact(const QString& tenant, const Contact& contact);
+
+    /**
+     * @brief Replaces a contact, keeping its ID and created date
+     * In a phone-hashed store a changed phone moves the contact to the shard
+     * hashShardKey() gives for the new number; it keeps its ID unless that
+     * ID is taken there.
+     */
+    bool updateContact(const QString& tenant, int id, const Contact& updatedContact);
+    bool removeContact(const QString& tenant, int id);
+
+    /**
+     * @brief Runs a query against one tenant's shard
+     * Time Complexity: as ContactManager::search, plus the first load
+     */
+    std::vector<Contact> search(const QString& tenant, const ContactQuery& query);
+
+    /**
+     * @brief Gets all contacts of one tenant sorted by name
+     */
+    std::vector<Contact> getAllContactsSorted(const QString& tenant);
+
+    int getContactCount(const QString& tenant);
+
+    /**
+     * @brief Runs a query against every tenant in parallel
+     * A shard that was not loaded before the call is dropped again once it
+     * has been searched, so a fan-out does not leave every book in memory.
+     * @return Hits ordered by tenant, then by contact ID
+     */
+    std::vector<ShardHit> searchAll(const ContactQuery& query);
+
+    /**
+     * @brief Runs a query against the given tenants in parallel
+     * Unknown tenants are skipped rather than created.
+     * @return Hits ordered by tenant, then by contact ID
+     */
+    std::vector<ShardHit> searchAll(const ContactQuery& query, const QStringList& tenantSubset);
+
+    /**
+     * @brief Lists every tenant, loaded or only on disk, in sorted order
+     */
+    QStringList tenants() const;
+
+    /**
+     * @brief Number of shards currently held in memory
+     */
+    int loadedShardCount() const;
+
+    /**
+     * @brief Saves a tenant's shard if modified and drops it from memory
+     * @return false if saving failed (the shard stays loaded)
+     */
+    bool unload(const QString& tenant);
+
+    /**
+     * @brief Writes every modified shard to its file
+     * @return true if all writes succeeded
+     */
+    bool saveAll();
+
+private:
+    struct Shard {
+        std::mutex mutex;                       ///< Serializes access to manager
+        std::unique_ptr<ContactManager> manager; ///< nullptr until first use
+        QString filePath;
+        QString legacyFilePath;                 ///< Name used before .cmz, renamed on load
+        bool dirty = false;
+    };
+
+    QString directory;
+    int hashShardCount;
+    mutable std::mutex shardsMutex;             ///< Guards the shards map only
+    std::map<QString, std::unique_ptr<Shard>> shards;
+
+    /**
+     * @brief Finds or creates the shard entry for a tenant
+     * The caller must lock Shard::mutex and call ensureLoaded() before use.
+     */
+    Shard& shardFor(const QString& tenant);
+
+    /**
+     * @brief Loads the shard's file on first access
+     * Must be called with Shard::mutex held.
+     */
+    static void ensureLoaded(Shard& shard);
+
+    static bool saveShard(Shard& shard);
+
+    /**
+     * @brief Searches one shard for searchAll()
+     * Unloads the shard again if this search is what loaded it.
+     */
+    std::vector<ShardHit> searchShard(const QString& tenant, const ContactQuery& query);
+
+    /**
+     * @brief Searches the tenants in parallel and merges the hits
+     * @param tenantList Tenants in sorted order
+     */
+    std::vector<ShardHit> fanOut(const QStringList& tenantList, const ContactQuery& query);
+
+    /**
+     * @brief Adds a contact under its own ID, or a fresh one if that is taken
+     * Must be called with Shard::mutex held on a loaded shard.
+     */
+    static bool addToShard(Shard& shard, Contact&& contact);
+
+    /**
+     * @brief Moves an updated contact between two hash shards
+     */
+    bool moveContact(Shard& from, Shard& to, int id, const Contact& updatedContact);
+
+    QString filePathFor(const QString& tenant, const char* suffix) const;
+};
+
+#endif // SHARDEDCONTACTSTORE_H
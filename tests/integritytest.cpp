@@ -0,0 +1,123 @@
+/**
+ * @file integritytest.cpp
+ * @brief Tests of the CRC-32C checksums and of damaged-file repair
+ */
+
+#include "contactmanager.h"
+#include "crc32c.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+#include <random>
+
+namespace {
+
+// Three full blocks of ContactManager's CompressedBlocks format
+const int kContacts = 3 * 1024;
+
+// File header: magic, version, block count; block header: marker, count,
+// payload size, checksum
+const qsizetype kFileHeaderSize = 12;
+const qsizetype kBlockHeaderSize = 16;
+
+} // namespace
+
+class IntegrityTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void crcCheckValue();
+    void crcPathsAgree();
+    void repairDropsOnlyTheDamagedBlock();
+
+private:
+    QTemporaryDir dir;
+};
+
+void IntegrityTest::crcCheckValue() {
+    // The standard CRC-32C check value
+    const QByteArray digits("123456789");
+    QCOMPARE(Crc32c::compute(digits), 0xE3069283u);
+    QCOMPARE(Crc32c::computePortable(digits.constData(), digits.size()), 0xE3069283u);
+    QCOMPARE(Crc32c::compute(QByteArray()), 0u);
+}
+
+void IntegrityTest::crcPathsAgree() {
+    qDebug() << "CPU CRC32 instruction:" << Crc32c::hardwareAccelerated();
+
+    QByteArray data(1000, Qt::Uninitialized);
+    std::mt19937 random(5);
+    for (char& byte : data) {
+        byte = static_cast<char>(random());
+    }
+
+    // Every length covers the 8-byte loops and the byte tails; checksums
+    // continued in two pieces must match the whole
+    for (qsizetype size = 0; size <= data.size(); ++size) {
+        const quint32 whole = Crc32c::compute(data.constData(), size);
+        QCOMPARE(Crc32c::computePortable(data.constData(), size), whole);
+
+        const qsizetype half = size / 2;
+        QCOMPARE(Crc32c::compute(data.constData() + half, size - half,
+                                 Crc32c::compute(data.constData(), half)), whole);
+        QCOMPARE(Crc32c::computePortable(data.constData() + half, size - half,
+                                         Crc32c::computePortable(data.constData(), half)), whole);
+    }
+}
+
+void IntegrityTest::repairDropsOnlyTheDamagedBlock() {
+    const QString path = dir.filePath("damaged.cmz");
+    const QString repairedPath = dir.filePath("repaired.cmz");
+    {
+        ContactManager manager;
+        for (int i = 0; i < kContacts; ++i) {
+            QVERIFY(manager.addContact(Contact(QString("Contact %1").arg(i),
+                                               QString("+91 98%1").arg(i, 8, 10, QChar('0')),
+                                               QString("contact%1@example.org").arg(i),
+                                               "MG Road, Pune", QString())));
+        }
+        QVERIFY(manager.saveToFile(path, ContactManager::CompressedBlocks));
+    }
+
+    QVERIFY(ContactManager::verifyFile(path).isIntact());
+
+    // Flip a byte in the middle of the second block's payload
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray data = file.readAll();
+    const qsizetype firstSize = qFromBigEndian<quint32>(data.constData() + kFileHeaderSize + 8);
+    const qsizetype second = kFileHeaderSize + kBlockHeaderSize + firstSize;
+    const qsizetype secondSize = qFromBigEndian<quint32>(data.constData() + second + 8);
+    QVERIFY(second + kBlockHeaderSize + secondSize < data.size());
+    char& byte = data[second + kBlockHeaderSize + secondSize / 2];
+    byte = static_cast<char>(~byte);
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(data), qint64(data.size()));
+    file.close();
+
+    const ContactManager::IntegrityReport damaged = ContactManager::verifyFile(path);
+    QVERIFY(damaged.readable);
+    QVERIFY(!damaged.isIntact());
+    QCOMPARE(damaged.blocks, 3);
+    QCOMPARE(damaged.intactBlocks, 2);
+
+    ContactManager refused;
+    QVERIFY(!refused.loadFromFile(path));
+
+    const ContactManager::IntegrityReport repaired = ContactManager::repairFile(path, repairedPath);
+    QCOMPARE(repaired.intactBlocks, 2);
+    QCOMPARE(repaired.contacts, 2 * 1024);
+    QVERIFY(ContactManager::verifyFile(repairedPath).isIntact());
+
+    // The first and last blocks survive; the second block's contacts are gone
+    ContactManager recovered;
+    QVERIFY(recovered.loadFromFile(repairedPath));
+    QCOMPARE(recovered.getContactCount(), 2 * 1024);
+    QVERIFY(!recovered.search(ContactQuery::parse("name=\"contact 0\"")).empty());
+    QVERIFY(recovered.search(ContactQuery::parse("name=\"contact 1500\"")).empty());
+    QVERIFY(!recovered.search(ContactQuery::parse(QString("name=\"contact %1\"").arg(kContacts - 1))).empty());
+}
+
+QTEST_GUILESS_MAIN(IntegrityTest)
+#include "integritytest.moc"
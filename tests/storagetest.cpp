@@ -0,0 +1,217 @@
+/**
+ * @file storagetest.cpp
+ * @brief Tests of the page cache and the disk-resident B+tree
+ *
+ * Every test works on its own file in a temporary directory. The trees
+ * are large enough to split leaves and internal nodes, and the caches use
+ * the smallest budget, so modified pages have to be evicted.
+ */
+
+#include "bplustree.h"
+#include "pagecache.h"
+#include <QTemporaryDir>
+#include <QtTest>
+#include <algorithm>
+#include <random>
+
+namespace {
+
+// Enough entries to split leaves and then internal nodes of 4 KiB
+const int kEntries = 40000;
+
+QByteArray keyOf(int i) {
+    return QByteArray("key-") + QByteArray::number(i).rightJustified(6, '0');
+}
+
+QByteArray valueOf(int i) {
+    return QByteArray("value-") + QByteArray::number(i);
+}
+
+/**
+ * @brief Inserts keyOf(i) -> valueOf(i) for every i < count in random order
+ */
+bool insertShuffled(BPlusTree& tree, int count) {
+    std::vector<int> order(count);
+    for (int i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+
+    for (int i : order) {
+        if (!tree.insert(keyOf(i), valueOf(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Collects the keys of a scan starting at from
+ */
+QList<QByteArray> scanKeys(const BPlusTree& tree, const QByteArray& from) {
+    QList<QByteArray> keys;
+    tree.scan(from, [&keys](const QByteArray& key, const QByteArray&) {
+        keys.append(key);
+        return true;
+    });
+    return keys;
+}
+
+} // namespace
+
+class StorageTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void pageCacheWritesBackEvictedPages();
+    void treeInsertSplitsAndFinds();
+    void treeScanCrossesLeaves();
+    void treeRemove();
+    void treeReopens();
+
+private:
+    QTemporaryDir dir;
+};
+
+void StorageTest::pageCacheWritesBackEvictedPages() {
+    const QString path = dir.filePath("evict.pages");
+    const quint32 pageCount = 64;
+    {
+        // The smallest budget, far fewer pages than are written
+        PageCache cache(0);
+        QVERIFY(cache.open(path));
+        QCOMPARE(cache.allocate(pageCount), 0u);
+        for (quint32 page = 0; page < pageCount; ++page) {
+            PageCache::Page data = cache.modify(page);
+            QVERIFY(data);
+            data->fill(static_cast<char>('a' + page % 26));
+        }
+
+        const PageCache::Stats stats = cache.getStats();
+        QVERIFY(stats.evictions > 0);
+        QVERIFY(stats.writes > 0);
+        QVERIFY(stats.residentPages <= stats.budgetPages);
+
+        // Evicted pages come back from the file with what was written
+        for (quint32 page = 0; page < pageCount; ++page) {
+            PageCache::Page data = cache.read(page);
+            QVERIFY(data);
+            QCOMPARE(data->count(static_cast<char>('a' + page % 26)), qsizetype(PageCache::kPageSize));
+        }
+    }
+
+    PageCache reopened(0);
+    QVERIFY(reopened.open(path));
+    QCOMPARE(reopened.pageCount(), pageCount);
+    for (quint32 page = 0; page < pageCount; ++page) {
+        PageCache::Page data = reopened.read(page);
+        QVERIFY(data);
+        QCOMPARE(data->count(static_cast<char>('a' + page % 26)), qsizetype(PageCache::kPageSize));
+    }
+}
+
+void StorageTest::treeInsertSplitsAndFinds() {
+    PageCache cache(0);
+    QVERIFY(cache.open(dir.filePath("insert.tree")));
+    cache.allocate();   // Page 0 belongs to the owner of the file
+
+    BPlusTree tree(cache);
+    QVERIFY(insertShuffled(tree, kEntries));
+    QVERIFY(tree.root() != 0);
+    QVERIFY(cache.pageCount() > 10);
+
+    for (int i = 0; i < kEntries; ++i) {
+        QByteArray value;
+        QVERIFY(tree.find(keyOf(i), value));
+        QCOMPARE(value, valueOf(i));
+    }
+    QByteArray value;
+    QVERIFY(!tree.find("missing", value));
+
+    // Inserting an existing key replaces its value
+    QVERIFY(tree.insert(keyOf(42), "replaced"));
+    QVERIFY(tree.find(keyOf(42), value));
+    QCOMPARE(value, QByteArray("replaced"));
+
+    QVERIFY(!tree.insert(QByteArray(BPlusTree::kMaxKeySize + 1, 'k'), "v"));
+}
+
+void StorageTest::treeScanCrossesLeaves() {
+    PageCache cache(0);
+    QVERIFY(cache.open(dir.filePath("scan.tree")));
+    cache.allocate();
+
+    BPlusTree tree(cache);
+    QVERIFY(insertShuffled(tree, kEntries));
+
+    const QList<QByteArray> all = scanKeys(tree, QByteArray());
+    QCOMPARE(all.size(), qsizetype(kEntries));
+    for (int i = 0; i < kEntries; ++i) {
+        QCOMPARE(all[i], keyOf(i));
+    }
+
+    const QList<QByteArray> tail = scanKeys(tree, keyOf(kEntries - 100));
+    QCOMPARE(tail.size(), qsizetype(100));
+    QCOMPARE(tail.first(), keyOf(kEntries - 100));
+
+    // A visitor returning false stops the scan
+    int visited = 0;
+    tree.scan(keyOf(10), [&visited](const QByteArray&, const QByteArray&) {
+        return ++visited < 3;
+    });
+    QCOMPARE(visited, 3);
+}
+
+void StorageTest::treeRemove() {
+    PageCache cache(0);
+    QVERIFY(cache.open(dir.filePath("remove.tree")));
+    cache.allocate();
+
+    BPlusTree tree(cache);
+    QVERIFY(insertShuffled(tree, kEntries));
+
+    for (int i = 0; i < kEntries; i += 2) {
+        QVERIFY(tree.remove(keyOf(i)));
+    }
+    QVERIFY(!tree.remove(keyOf(0)));
+
+    const QList<QByteArray> left = scanKeys(tree, QByteArray());
+    QCOMPARE(left.size(), qsizetype(kEntries / 2));
+    for (int i = 0; i < left.size(); ++i) {
+        QCOMPARE(left[i], keyOf(2 * i + 1));
+    }
+
+    QByteArray value;
+    QVERIFY(!tree.find(keyOf(100), value));
+    QVERIFY(tree.find(keyOf(101), value));
+    QCOMPARE(value, valueOf(101));
+}
+
+void StorageTest::treeReopens() {
+    const QString path = dir.filePath("reopen.tree");
+    quint32 root = 0;
+    {
+        PageCache cache(0);
+        QVERIFY(cache.open(path));
+        cache.allocate();
+
+        BPlusTree tree(cache);
+        QVERIFY(insertShuffled(tree, kEntries));
+        QVERIFY(tree.remove(keyOf(7)));
+        root = tree.root();
+        QVERIFY(cache.flush());
+    }
+
+    PageCache cache(0);
+    QVERIFY(cache.open(path));
+    BPlusTree tree(cache, root);
+
+    QByteArray value;
+    QVERIFY(!tree.find(keyOf(7), value));
+    QVERIFY(tree.find(keyOf(kEntries - 1), value));
+    QCOMPARE(value, valueOf(kEntries - 1));
+    QCOMPARE(scanKeys(tree, QByteArray()).size(), qsizetype(kEntries - 1));
+}
+
+QTEST_GUILESS_MAIN(StorageTest)
+#include "storagetest.moc"
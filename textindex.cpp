@@ -0,0 +1,365 @@
+/**
+ * @file textindex.cpp
+ * @brief Implementation of the BM25 full-text index
+ */
+
+#include "textindex.h"
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+// BM25 parameters: term frequency saturation and length normalization
+const double kBm25K1 = 1.2;
+const double kBm25B = 0.75;
+
+// File header: "CMFT" | version | snapshot version | document count |
+//   { ID | length }* | term count | { term | last ID | doc freq | postings }*
+const char kTextIndexMagic[4] = {'C', 'M', 'F', 'T'};
+const quint32 kTextIndexFormatVersion = 1;
+
+inline bool readVarint(const char*& pos, const char* end, quint32& value) {
+    value = 0;
+    for (int shift = 0; pos < end && shift < 35; shift += 7) {
+        const quint8 byte = static_cast<quint8>(*pos++);
+        value |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::map<QString, int> termFrequencies(QStringView text) {
+    std::map<QString, int> frequencies;
+    for (const QString& word : TextIndex::tokenize(text)) {
+        ++frequencies[word];
+    }
+    return frequencies;
+}
+
+} // namespace
+
+QStringList TextIndex::tokenize(QStringView text) {
+    QStringList words;
+    qsizetype start = -1;
+
+    for (qsizetype i = 0; i <= text.size(); ++i) {
+        const bool inWord = i < text.size() && text[i].isLetterOrNumber();
+        if (inWord && start < 0) {
+            start = i;
+        } else if (!inWord && start >= 0) {
+            if (i - start >= 2) {
+                words.append(text.mid(start, i - start).toString().toLower());
+            }
+            start = -1;
+        }
+    }
+
+    return words;
+}
+
+void TextIndex::appendVarint(QByteArray& data, quint32 value) {
+    while (value >= 0x80) {
+        data.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.append(static_cast<char>(value));
+}
+
+std::vector<std::pair<int, int>> TextIndex::decode(const Postings& postings) {
+    std::vector<std::pair<int, int>> entries;
+    entries.reserve(postings.docFreq);
+
+    const char* pos = postings.data.constData();
+    const char* end = pos + postings.data.size();
+    int id = 0;
+    quint32 delta, frequency;
+    while (readVarint(pos, end, delta) && readVarint(pos, end, frequency)) {
+        id += static_cast<int>(delta);
+        entries.emplace_back(id, static_cast<int>(frequency));
+    }
+    return entries;
+}
+
+void TextIndex::encode(Postings& postings, const std::vector<std::pair<int, int>>& entries) {
+    postings.data.clear();
+    postings.lastId = 0;
+    for (const auto& entry : entries) {
+        appendVarint(postings.data, static_cast<quint32>(entry.first - postings.lastId));
+        appendVarint(postings.data, static_cast<quint32>(entry.second));
+        postings.lastId = entry.first;
+    }
+    postings.docFreq = static_cast<int>(entries.size());
+}
+
+void TextIndex::addDocument(int id, QStringView text) {
+    const std::map<QString, int> frequencies = termFrequencies(text);
+    if (frequencies.empty() || id <= 0) {
+        return;
+    }
+
+    int length = 0;
+    for (const auto& entry : frequencies) {
+        Postings& postings = terms[entry.first];
+        length += entry.second;
+
+        if (id > postings.lastId) {
+            // Common case: new contacts get increasing IDs, so just append
+            appendVarint(postings.data, static_cast<quint32>(id - postings.lastId));
+            appendVarint(postings.data, static_cast<quint32>(entry.second));
+            postings.lastId = id;
+            ++postings.docFreq;
+        } else {
+            std::vector<std::pair<int, int>> entries = decode(postings);
+            auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(id, 0));
+            if (it != entries.end() && it->first == id) {
+                it->second = entry.second;
+            } else {
+                entries.insert(it, {id, entry.second});
+            }
+            encode(postings, entries);
+        }
+    }
+
+    auto doc = docLengths.find(id);
+    if (doc != docLengths.end()) {
+        totalLength -= doc->second;
+    }
+    docLengths[id] = length;
+    totalLength += length;
+}
+
+void TextIndex::removeDocument(int id, QStringView text) {
+    for (const auto& entry : termFrequencies(text)) {
+        auto it = terms.find(entry.first);
+        if (it == terms.end()) {
+            continue;
+        }
+
+        std::vector<std::pair<int, int>> entries = decode(it->second);
+        auto pos = std::lower_bound(entries.begin(), entries.end(), std::make_pair(id, 0));
+        if (pos == entries.end() || pos->first != id) {
+            continue;
+        }
+        entries.erase(pos);
+
+        if (entries.empty()) {
+            terms.erase(it);
+        } else {
+            encode(it->second, entries);
+        }
+    }
+
+    auto doc = docLengths.find(id);
+    if (doc != docLengths.end()) {
+        totalLength -= doc->second;
+        docLengths.erase(doc);
+    }
+}
+
+void TextIndex::removeDocuments(const std::set<int>& ids) {
+    if (ids.empty()) {
+        return;
+    }
+
+    for (auto it = terms.begin(); it != terms.end();) {
+        Postings& postings = it->second;
+        if (postings.lastId < *ids.begin()) {
+            ++it;
+            continue;
+        }
+
+        std::vector<std::pair<int, int>> entries = decode(postings);
+        const auto kept = std::remove_if(entries.begin(), entries.end(),
+                                         [&ids](const std::pair<int, int>& entry) {
+                                             return ids.count(entry.first) > 0;
+                                         });
+        if (kept == entries.end()) {
+            ++it;
+            continue;
+        }
+        entries.erase(kept, entries.end());
+
+        if (entries.empty()) {
+            it = terms.erase(it);
+        } else {
+            encode(postings, entries);
+            ++it;
+        }
+    }
+
+    for (int id : ids) {
+        auto doc = docLengths.find(id);
+        if (doc != docLengths.end()) {
+            totalLength -= doc->second;
+            docLengths.erase(doc);
+        }
+    }
+}
+
+std::vector<TextIndex::Hit> TextIndex::search(const QString& query, size_t limit) const {
+    std::vector<Hit> hits;
+    if (limit == 0 || docLengths.empty()) {
+        return hits;
+    }
+
+    const double documents = static_cast<double>(docLengths.size());
+    const double averageLength = static_cast<double>(totalLength) / documents;
+
+    // Accumulate BM25 contributions term by term straight from the
+    // compressed lists
+    std::unordered_map<int, double> scores;
+    for (const auto& entry : termFrequencies(query)) {
+        auto it = terms.find(entry.first);
+        if (it == terms.end()) {
+            continue;
+        }
+
+        const Postings& postings = it->second;
+        const double idf = std::log(1.0 + (documents - postings.docFreq + 0.5) /
+                                              (postings.docFreq + 0.5));
+
+        const char* pos = postings.data.constData();
+        const char* end = pos + postings.data.size();
+        int id = 0;
+        quint32 delta, frequency;
+        while (readVarint(pos, end, delta) && readVarint(pos, end, frequency)) {
+            id += static_cast<int>(delta);
+            const double tf = frequency;
+            const double length = docLengths.at(id);
+            scores[id] += idf * tf * (kBm25K1 + 1.0) /
+                          (tf + kBm25K1 * (1.0 - kBm25B + kBm25B * length / averageLength));
+        }
+    }
+
+    // Min-heap of the best k: the root is the weakest hit kept so far
+    auto better = [](const Hit& a, const Hit& b) {
+        return a.score > b.score || (a.score == b.score && a.id < b.id);
+    };
+    std::priority_queue<Hit, std::vector<Hit>, decltype(better)> best(better);
+
+    for (const auto& score : scores) {
+        const Hit hit{score.first, score.second};
+        if (best.size() < limit) {
+            best.push(hit);
+        } else if (better(hit, best.top())) {
+            best.pop();
+            best.push(hit);
+        }
+    }
+
+    hits.resize(best.size());
+    for (size_t i = hits.size(); i-- > 0;) {
+        hits[i] = best.top();
+        best.pop();
+    }
+    return hits;
+}
+
+size_t TextIndex::postingBytes() const {
+    size_t bytes = 0;
+    for (const auto& entry : terms) {
+        bytes += static_cast<size_t>(entry.second.data.size());
+    }
+    return bytes;
+}
+
+std::vector<int> TextIndex::documentIds() const {
+    std::vector<int> ids;
+    ids.reserve(docLengths.size());
+    for (const auto& entry : docLengths) {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+void TextIndex::clear() {
+    terms.clear();
+    docLengths.clear();
+    totalLength = 0;
+}
+
+bool TextIndex::saveToFile(const QString& filename, quint64 version) const {
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out.writeRawData(kTextIndexMagic, sizeof(kTextIndexMagic));
+    out << kTextIndexFormatVersion << version << static_cast<quint32>(docLengths.size());
+    for (const auto& doc : docLengths) {
+        out << static_cast<qint32>(doc.first) << static_cast<quint32>(doc.second);
+    }
+
+    out << static_cast<quint32>(terms.size());
+    for (const auto& entry : terms) {
+        out << entry.first << static_cast<qint32>(entry.second.lastId)
+            << static_cast<quint32>(entry.second.docFreq) << entry.second.data;
+    }
+
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool TextIndex::loadFromFile(const QString& filename, quint64 version) {
+    clear();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    char magic[sizeof(kTextIndexMagic)];
+    quint32 formatVersion = 0, docCount = 0, termCount = 0;
+    quint64 storedVersion = 0;
+
+    if (in.readRawData(magic, sizeof(magic)) != static_cast<int>(sizeof(magic)) ||
+        std::memcmp(magic, kTextIndexMagic, sizeof(magic)) != 0) {
+        return false;
+    }
+    in >> formatVersion >> storedVersion >> docCount;
+    if (formatVersion != kTextIndexFormatVersion || storedVersion != version) {
+        return false;
+    }
+
+    for (quint32 i = 0; i < docCount && in.status() == QDataStream::Ok; ++i) {
+        qint32 id;
+        quint32 length;
+        in >> id >> length;
+        docLengths[id] = static_cast<int>(length);
+        totalLength += length;
+    }
+
+    in >> termCount;
+    for (quint32 i = 0; i < termCount && in.status() == QDataStream::Ok; ++i) {
+        QString term;
+        qint32 lastId;
+        quint32 docFreq;
+        Postings postings;
+        in >> term >> lastId >> docFreq >> postings.data;
+        postings.lastId = lastId;
+        postings.docFreq = static_cast<int>(docFreq);
+        terms[term] = std::move(postings);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file textindex.h
+ * @brief Ranked full-text index over contact notes and addresses
+ *
+ * An inverted index from lower-cased words to the contacts that contain
+ * them. Each posting list is stored compressed as varint pairs of
+ * (ID delta, term frequency), so a list of sequential IDs costs about two
+ * bytes per entry. Queries are scored with BM25 and the best k hits are
+ * kept in a min-heap, so ranking costs O(p log k) for p postings read.
+ */
+
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+class TextIndex {
+public:
+    /**
+     * @brief A ranked search result
+     */
+    struct Hit {
+        int id;
+        double score;
+    };
+
+    /**
+     * @brief Splits text into lower-cased words of two or more letters/digits
+     * Time Complexity: O(m)
+     */
+    static QStringList tokenize(QStringView text);
+
+    /**
+     * @brief Indexes a document under an ID
+     * Appending is O(t) for t words when id is above every indexed ID, as
+     * it is for new contacts; otherwise touched lists are re-encoded.
+     */
+    void addDocument(int id, QStringView text);
+
+    /**
+     * @brief Removes a document; text must be what was indexed for id
+     * Time Complexity: O(total postings of the document's words)
+     */
+    void removeDocument(int id, QStringView text);
+
+    /**
+     * @brief Removes many documents in one pass over the posting lists
+     * Each list holding any of the IDs is rewritten once, so the cost does
+     * not grow with the batch size the way repeated removeDocument() does.
+     * Time Complexity: O(p log b) for p postings and b IDs
+     */
+    void removeDocuments(const std::set<int>& ids);
+
+    /**
+     * @brief Returns the k best BM25 matches for any of the query words
+     * @param query Free text; words are matched exactly after tokenize()
+     * @param limit Maximum number of hits (k)
+     * @return Hits by descending score, ties by ascending ID
+     * Time Complexity: O(p log k) for p postings of the query words
+     */
+    std::vector<Hit> search(const QString& query, size_t limit) const;
+
+    int documentCount() const { return static_cast<int>(docLengths.size()); }
+    size_t termCount() const { return terms.size(); }
+
+    /**
+     * @brief Bytes used by the compressed posting lists
+     */
+    size_t postingBytes() const;
+
+    /**
+     * @brief IDs of every indexed document, ascending
+     */
+    std::vector<int> documentIds() const;
+
+    void clear();
+
+    /**
+     * @brief Writes the index, tagged with the version of the snapshot it covers
+     * @return true if the file was written
+     */
+    bool saveToFile(const QString& filename, quint64 version) const;
+
+    /**
+     * @brief Reads an index written by saveToFile()
+     * @param version Snapshot version the caller expects
+     * @return false (index left empty) if the file is missing, corrupt or
+     *         belongs to a different snapshot version
+     */
+    bool loadFromFile(const QString& filename, quint64 version);
+
+private:
+    struct Postings {
+        QByteArray data;        ///< varint (ID delta, term frequency) pairs
+        int lastId = 0;         ///< Largest ID in data, base for appends
+        int docFreq = 0;
+    };
+
+    std::map<QString, Postings> terms;
+    std::map<int, int> docLengths;      ///< ID -> number of words
+    qint64 totalLength = 0;
+
+    static void appendVarint(QByteArray& data, quint32 value);
+    static std::vector<std::pair<int, int>> decode(const Postings& postings);
+    static void encode(Postings& postings, const std::vector<std::pair<int, int>>& entries);
+};
+
+#endif // TEXTINDEX_H
@@ -0,0 +1,134 @@
+/**
+ * @file timestamp.cpp
+ * @brief Implementation of the epoch timestamp helpers
+ */
+
+#include "timestamp.h"
+
+thread_local qint64 Timestamp::batchTime = Timestamp::kInvalid;
+
+namespace {
+
+const qint64 kMsecsPerDay = 24 * 60 * 60 * 1000;
+
+// Days since 1970-01-01 <-> proleptic Gregorian date, after Howard
+// Hinnant's days_from_civil / civil_from_days
+
+qint64 daysFromCivil(int year, int month, int day) {
+    year -= month <= 2 ? 1 : 0;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const int yearOfEra = static_cast<int>(year - era * 400);
+    const int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+void civilFromDays(qint64 days, int& year, int& month, int& day) {
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const int dayOfEra = static_cast<int>(days - era * 146097);
+    const int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int monthIndex = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year = static_cast<int>(yearOfEra + era * 400) + (month <= 2 ? 1 : 0);
+}
+
+int daysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+char16_t* writeDigits(char16_t* out, int value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char16_t>(u'0' + value % 10);
+        value /= 10;
+    }
+    return out + width;
+}
+
+// Reads width digits at pos; false if any is not a digit
+bool readDigits(QStringView text, qsizetype pos, int width, int& value) {
+    value = 0;
+    for (int i = 0; i < width; ++i) {
+        const char16_t ch = text[pos + i].unicode();
+        if (ch < u'0' || ch > u'9') {
+            return false;
+        }
+        value = value * 10 + (ch - u'0');
+    }
+    return true;
+}
+
+} // namespace
+
+Timestamp::Batch::Batch()
+    : owner(batchTime == kInvalid) {
+    if (owner) {
+        batchTime = QDateTime::currentMSecsSinceEpoch();
+    }
+}
+
+Timestamp::Batch::~Batch() {
+    if (owner) {
+        batchTime = kInvalid;
+    }
+}
+
+QString Timestamp::toIso(qint64 msecs) {
+    qint64 days = msecs / kMsecsPerDay;
+    qint64 rest = msecs % kMsecsPerDay;
+    if (rest < 0) {
+        rest += kMsecsPerDay;
+        --days;
+    }
+
+    int year, month, day;
+    civilFromDays(days, year, month, day);
+    if (year < 0 || year > 9999) {
+        return toDateTime(msecs).toUTC().toString(Qt::ISODateWithMs);
+    }
+
+    const int ms = static_cast<int>(rest);
+    char16_t buffer[24];
+    char16_t* out = buffer;
+    out = writeDigits(out, year, 4);
+    *out++ = u'-';
+    out = writeDigits(out, month, 2);
+    *out++ = u'-';
+    out = writeDigits(out, day, 2);
+    *out++ = u'T';
+    out = writeDigits(out, ms / 3600000, 2);
+    *out++ = u':';
+    out = writeDigits(out, ms / 60000 % 60, 2);
+    *out++ = u':';
+    out = writeDigits(out, ms / 1000 % 60, 2);
+    *out++ = u'.';
+    out = writeDigits(out, ms % 1000, 3);
+    *out++ = u'Z';
+    return QString(reinterpret_cast<const QChar*>(buffer), out - buffer);
+}
+
+qint64 Timestamp::fromIso(QStringView text) {
+    // Fast path: "YYYY-MM-DDTHH:MM:SSZ" or "YYYY-MM-DDTHH:MM:SS.zzzZ"
+    const qsizetype size = text.size();
+    if ((size == 20 || size == 24) && text[size - 1] == u'Z' &&
+        text[4] == u'-' && text[7] == u'-' && text[10] == u'T' &&
+        text[13] == u':' && text[16] == u':' && (size == 20 || text[19] == u'.')) {
+        int year, month, day, hour, minute, second, ms = 0;
+        if (readDigits(text, 0, 4, year) && readDigits(text, 5, 2, month) &&
+            readDigits(text, 8, 2, day) && readDigits(text, 11, 2, hour) &&
+            readDigits(text, 14, 2, minute) && readDigits(text, 17, 2, second) &&
+            (size == 20 || readDigits(text, 20, 3, ms)) &&
+            month >= 1 && month <= 12 && day >= 1 && day <= daysInMonth(year, month) &&
+            hour < 24 && minute < 60 && second < 60) {
+            return daysFromCivil(year, month, day) * kMsecsPerDay +
+                   ((hour * 60 + minute) * 60 + second) * 1000LL + ms;
+        }
+    }
+
+    const QDateTime date = QDateTime::fromString(text.toString(), Qt::ISODate);
+    return date.isValid() ? date.toMSecsSinceEpoch() : kInvalid;
+}
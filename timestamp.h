@@ -0,0 +1,75 @@
+/**
+ * @file timestamp.h
+ * @brief Contact timestamps as UTC milliseconds since the epoch
+ *
+ * Created and modified dates are stored as plain qint64 values. Reading
+ * the clock is a single system call with no time zone work, and comparing
+ * or indexing a timestamp is an integer operation. QDateTime is only built
+ * when a date is shown to the user; files store UTC ISO 8601 text that is
+ * formatted and parsed without QDateTime.
+ *
+ * A Batch pins the clock for a bulk operation, so every record it touches
+ * gets the same stamp from one clock read:
+ *
+ *     Timestamp::Batch batch;
+ *     for (...) { contact.setNotes(...); }   // all share one modified time
+ */
+
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <QDateTime>
+#include <QString>
+#include <QStringView>
+#include <limits>
+
+class Timestamp {
+public:
+    /// Marks a missing or unparsable timestamp
+    static constexpr qint64 kInvalid = std::numeric_limits<qint64>::min();
+
+    /**
+     * @brief Current time, or the pinned time inside a Batch
+     */
+    static qint64 now() {
+        return batchTime != kInvalid ? batchTime : QDateTime::currentMSecsSinceEpoch();
+    }
+
+    /**
+     * @brief Pins now() for the lifetime of the outermost Batch on this thread
+     */
+    class Batch {
+    public:
+        Batch();
+        ~Batch();
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+    private:
+        bool owner;
+    };
+
+    /**
+     * @brief Formats as "YYYY-MM-DDTHH:MM:SS.zzzZ" in UTC
+     * Time Complexity: O(1), no QDateTime or locale involved
+     */
+    static QString toIso(qint64 msecs);
+
+    /**
+     * @brief Parses ISO 8601 text
+     * UTC text as written by toIso() is parsed directly; other forms (local
+     * time, offsets) go through QDateTime.
+     * @return Milliseconds since the epoch, or kInvalid
+     */
+    static qint64 fromIso(QStringView text);
+
+    /**
+     * @brief Converts to a local QDateTime for display
+     */
+    static QDateTime toDateTime(qint64 msecs) { return QDateTime::fromMSecsSinceEpoch(msecs); }
+
+private:
+    static thread_local qint64 batchTime;
+};
+
+#endif // TIMESTAMP_H